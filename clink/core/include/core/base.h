@@ -9,6 +9,8 @@
 
 #if defined(_WIN32)
 #   define PLATFORM_WINDOWS
+#elif defined(__unix__) || defined(__APPLE__)
+#   define PLATFORM_POSIX
 #else
 #   error Unsupported platform.
 #endif
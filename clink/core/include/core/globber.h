@@ -5,13 +5,29 @@
 
 #include "str.h"
 
-#include <Windows.h>
+//------------------------------------------------------------------------------
+// Supplies the entries of a directory to a globber.  Attributes are Win32
+// FILE_ATTRIBUTE_* values on every platform.
+class glob_source
+{
+public:
+    virtual             ~glob_source() = default;
+
+    // Sets NAME to the next entry's UTF-8 name, which remains valid until the
+    // next call.  Returns false once there are no more entries.
+    virtual bool        next(const char*& name, int& attr) = 0;
+};
+
+// Returns the platform's source for the entries that match PATTERN, or null if
+// nothing can match.
+glob_source*            new_glob_source(const char* pattern);
 
 //------------------------------------------------------------------------------
 class globber
 {
 public:
                         globber(const char* pattern);
+                        globber(glob_source* source, const char* root);
                         ~globber();
     void                files(bool state)       { m_files = state; }
     void                directories(bool state) { m_directories = state; }
@@ -24,9 +40,7 @@ public:
 private:
                         globber(const globber&) = delete;
     void                operator = (const globber&) = delete;
-    void                next_file();
-    WIN32_FIND_DATAW    m_data;
-    HANDLE              m_handle;
+    glob_source*        m_source;
     str<280>            m_root;
     bool                m_files;
     bool                m_directories;
@@ -7,6 +7,8 @@
 #include <core/str_compare.h>
 #include <core/str_iter.h>
 
+#include <vector>
+
 class str_base;
 
 namespace path
@@ -18,8 +20,8 @@ bool match_char_impl(int pc, int fc)
 {
     if (MODE > 0)
     {
-        pc = (pc > 0xffff) ? pc : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(pc)))));
-        fc = (fc > 0xffff) ? fc : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(fc)))));
+        pc = fold_case(pc);
+        fc = fold_case(fc);
     }
 
     if (MODE > 1)
@@ -45,20 +47,179 @@ bool match_char_impl(int pc, int fc)
 }
 
 //------------------------------------------------------------------------------
-template <class T, int MODE, bool fuzzy_accents>
-bool match_wild_impl(const str_iter_impl<T>& _pattern, const str_iter_impl<T>& _file, bool star_matches_everything=false)
+// A wildcard pattern that is analysed once, so it can be matched against many
+// files without re-examining the pattern each time.  Patterns that are a
+// literal followed by a trailing star (the usual shape when completing) are
+// matched directly without any backtracking.
+template <class T>
+class wild_matcher
+{
+public:
+    explicit                wild_matcher(const str_iter_impl<T>& pattern);
+    bool                    match(const str_iter_impl<T>& file, bool star_matches_everything=false);
+
+private:
+    struct frame
+    {
+        const T*            pattern;
+        const T*            file;
+        bool                start_of_path_component;
+    };
+
+    template <int MODE, bool fuzzy_accents> bool match_impl(const str_iter_impl<T>& file, bool star_matches_everything);
+    template <int MODE, bool fuzzy_accents> bool match_trailing_star(const str_iter_impl<T>& file, bool star_matches_everything) const;
+    static const T*         get_final_component(const str_iter_impl<T>& iter);
+    str_iter_impl<T>        m_pattern;
+    const T*                m_final_component;
+    const T*                m_trailing_star = nullptr;
+    bool                    m_final_wildcard = false;
+    std::vector<frame>      m_stack;
+};
+
+//------------------------------------------------------------------------------
+template <class T>
+wild_matcher<T>::wild_matcher(const str_iter_impl<T>& pattern)
+: m_pattern(pattern)
+, m_final_component(pattern.get_pointer())
+{
+    const T* first_wildcard = nullptr;
+
+    int c;
+    for (str_iter_impl<T> tmp(pattern); c = tmp.peek(); tmp.next())
+    {
+        if (path::is_separator(c))
+        {
+            m_final_component = tmp.get_pointer() + 1;
+            m_final_wildcard = false;
+        }
+        else if (c == '?' || c == '*')
+        {
+            m_final_wildcard = true;
+            if (!first_wildcard)
+                first_wildcard = tmp.get_pointer();
+        }
+    }
+
+    // Is it a literal followed only by wildcards, starting with a star?
+    if (first_wildcard && *first_wildcard == '*')
+    {
+        str_iter_impl<T> tmp(pattern);
+        tmp.reset_pointer(first_wildcard);
+        while ((c = tmp.peek()) == '*' || c == '?')
+            tmp.next();
+        if (!c)
+            m_trailing_star = first_wildcard;
+    }
+}
+
+//------------------------------------------------------------------------------
+template <class T>
+const T* wild_matcher<T>::get_final_component(const str_iter_impl<T>& iter)
 {
-    str_iter_impl<T> pattern(_pattern);
+    const T* final_component = iter.get_pointer();
+
+    int c;
+    for (str_iter_impl<T> tmp(iter); c = tmp.peek(); tmp.next())
+        if (path::is_separator(c))
+            final_component = tmp.get_pointer() + 1;
+
+    return final_component;
+}
+
+//------------------------------------------------------------------------------
+template <class T>
+bool wild_matcher<T>::match(const str_iter_impl<T>& file, bool star_matches_everything)
+{
+    bool fuzzy_accents = str_compare_scope::current_fuzzy_accents();
+    switch (str_compare_scope::current())
+    {
+    case str_compare_scope::relaxed:
+        if (fuzzy_accents)  return match_impl<2, true>(file, star_matches_everything);
+        else                return match_impl<2, false>(file, star_matches_everything);
+    case str_compare_scope::caseless:
+        if (fuzzy_accents)  return match_impl<1, true>(file, star_matches_everything);
+        else                return match_impl<1, false>(file, star_matches_everything);
+    default:
+        if (fuzzy_accents)  return match_impl<0, true>(file, star_matches_everything);
+        else                return match_impl<0, false>(file, star_matches_everything);
+    }
+}
+
+//------------------------------------------------------------------------------
+template <class T>
+template <int MODE, bool fuzzy_accents>
+bool wild_matcher<T>::match_trailing_star(const str_iter_impl<T>& _file, bool star_matches_everything) const
+{
+    str_iter_impl<T> pattern(m_pattern);
     str_iter_impl<T> file(_file);
 
-    unsigned depth = 0;
-    const T* pattern_stack[10];
-    const T* file_stack[10];
-    bool path_component_stack[10];
+    const T* final_file_component = nullptr;
+
+    // Match the literal part.
+    while (pattern.get_pointer() != m_trailing_star)
+    {
+        int c = pattern.peek();
+        int d = file.peek();
+        if (!d)
+            return false;
+
+        if (d == '.' && c != '.' && pattern.get_pointer() == m_final_component)
+        {
+            // Leading dots in the final component are skipped when the final
+            // component of the pattern has wildcards (which it does here).
+            if (!final_file_component)
+                final_file_component = get_final_component(_file);
+            if (file.get_pointer() == final_file_component)
+            {
+                while (d == '.')
+                {
+                    file.next();
+                    d = file.peek();
+                }
+            }
+        }
+
+        if (!match_char_impl<T,MODE,fuzzy_accents>(d, c))
+            return false;
+
+        pattern.next();
+        file.next();
+
+        // Advance past path separators (consider "\\\\" and "\" equal).
+        if (path::is_separator(c))
+        {
+            while (path::is_separator(pattern.peek()))
+                pattern.next();
+            while (path::is_separator(file.peek()))
+                file.next();
+        }
+    }
+
+    if (star_matches_everything)
+        return true;
+
+    // Stars don't match past a path separator.
+    while (int d = file.next())
+        if (path::is_separator(d))
+            return false;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+template <class T>
+template <int MODE, bool fuzzy_accents>
+bool wild_matcher<T>::match_impl(const str_iter_impl<T>& _file, bool star_matches_everything)
+{
+    if (m_trailing_star)
+        return match_trailing_star<MODE, fuzzy_accents>(_file, star_matches_everything);
+
+    str_iter_impl<T> pattern(m_pattern);
+    str_iter_impl<T> file(_file);
+
+    m_stack.clear();
 
-    const T* final_pattern_component = nullptr;
     const T* final_file_component = nullptr;
-    bool has_final_wildcard = false;
 
     bool start_of_path_component = true;
 
@@ -66,16 +227,15 @@ bool match_wild_impl(const str_iter_impl<T>& _pattern, const str_iter_impl<T>& _
     {
         int c = pattern.peek();
         int d = file.peek();
+
+        bool symbol_matched = false;
         if (!c)
         {
             // Consumed pattern, so it's a match iff file was consumed.
             if (!d)
                 return true;
-            goto back_track;
         }
-
-        bool symbol_matched = false;
-        switch (c)
+        else switch (c)
         {
         case '?':
             // Any 1 character (or missing character), except slashes.
@@ -118,16 +278,11 @@ bool match_wild_impl(const str_iter_impl<T>& _pattern, const str_iter_impl<T>& _
             if (!star_matches_everything && path::is_separator(d))
             {
                 // Wildcards don't match past a path separator.
-                depth = 0;
+                m_stack.clear();
             }
             else
             {
-                if (depth == _countof(pattern_stack))
-                    return false; // Stack overflow.
-                pattern_stack[depth] = push_pattern;
-                file_stack[depth] = file.get_pointer();
-                path_component_stack[depth] = start_of_path_component;
-                depth++;
+                m_stack.push_back({ push_pattern, file.get_pointer(), start_of_path_component });
             }
             symbol_matched = true;
             break; }
@@ -140,29 +295,10 @@ bool match_wild_impl(const str_iter_impl<T>& _pattern, const str_iter_impl<T>& _
             else if (d == '.' && start_of_path_component)
             {
                 if (!final_file_component)
-                {
-                    int x;
-                    for (str_iter tmp(_pattern); x = tmp.peek(); tmp.next())
-                        if (path::is_separator(x))
-                        {
-                            final_pattern_component = tmp.get_pointer() + 1;
-                            has_final_wildcard = false;
-                        }
-                        else if (x == '?' || x == '*')
-                        {
-                            has_final_wildcard = true;
-                        }
-                    for (str_iter tmp(_file); x = tmp.peek(); tmp.next())
-                        if (path::is_separator(x))
-                            final_file_component = tmp.get_pointer() + 1;
-                    if (!final_pattern_component)
-                        final_pattern_component = _pattern.get_pointer();
-                    if (!final_file_component)
-                        final_file_component = _file.get_pointer();
-                }
-                if (has_final_wildcard &&
+                    final_file_component = get_final_component(_file);
+                if (m_final_wildcard &&
                     file.get_pointer() == final_file_component &&
-                    pattern.get_pointer() == final_pattern_component &&
+                    pattern.get_pointer() == m_final_component &&
                     c != '.')
                 {
                     while (d == '.')
@@ -191,17 +327,15 @@ bool match_wild_impl(const str_iter_impl<T>& _pattern, const str_iter_impl<T>& _
 
         if (!symbol_matched)
         {
-back_track:
-            if (depth)
-            {
-                // Backtrack.
-                depth--;
-                pattern.reset_pointer(pattern_stack[depth]);
-                file.reset_pointer(file_stack[depth]);
-                start_of_path_component = path_component_stack[depth];
-                continue;
-            }
-            return false;
+            if (m_stack.empty())
+                return false;
+
+            // Backtrack.
+            const frame& top = m_stack.back();
+            pattern.reset_pointer(top.pattern);
+            file.reset_pointer(top.file);
+            start_of_path_component = top.start_of_path_component;
+            m_stack.pop_back();
         }
     }
 }
@@ -210,19 +344,8 @@ back_track:
 template <class T>
 bool match_wild(const str_iter_impl<T>& pattern, const str_iter_impl<T>& file, bool star_matches_everything=false)
 {
-    bool fuzzy_accents = str_compare_scope::current_fuzzy_accents();
-    switch (str_compare_scope::current())
-    {
-    case str_compare_scope::relaxed:
-        if (fuzzy_accents)  return match_wild_impl<T, 2, true>(pattern, file, star_matches_everything);
-        else                return match_wild_impl<T, 2, false>(pattern, file, star_matches_everything);
-    case str_compare_scope::caseless:
-        if (fuzzy_accents)  return match_wild_impl<T, 1, true>(pattern, file, star_matches_everything);
-        else                return match_wild_impl<T, 1, false>(pattern, file, star_matches_everything);
-    default:
-        if (fuzzy_accents)  return match_wild_impl<T, 0, true>(pattern, file, star_matches_everything);
-        else                return match_wild_impl<T, 0, false>(pattern, file, star_matches_everything);
-    }
+    wild_matcher<T> matcher(pattern);
+    return matcher.match(file, star_matches_everything);
 }
 
 //------------------------------------------------------------------------------
@@ -17,6 +17,8 @@ enum {
 
 int     get_path_type(const char* path);
 int     get_file_size(const char* path);
+bool    get_modified_time(const char* path, unsigned long long& out);
+unsigned long long get_current_time();
 bool    is_hidden(const char* path);
 void    get_current_dir(str_base& out);
 bool    set_current_dir(const char* dir);
@@ -0,0 +1,19 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+//------------------------------------------------------------------------------
+// Simple case folding, as a two level table.  The top bits of a codepoint pick
+// a block of deltas, and the low eight bits index into it.
+extern const unsigned char  g_case_fold_index[0x1100];
+extern const int            g_case_fold_blocks[][0x100];
+
+//------------------------------------------------------------------------------
+inline int fold_case(int c)
+{
+    if (unsigned(c) >= 0x110000)
+        return c;
+
+    return c + g_case_fold_blocks[g_case_fold_index[c >> 8]][c & 0xff];
+}
@@ -5,6 +5,7 @@
 
 #include "base.h"
 #include "path.h"
+#include "str_case_fold.h"
 #include "str_iter.h"
 
 #include <Windows.h>
@@ -41,6 +42,19 @@ private:
 //------------------------------------------------------------------------------
 int normalize_accent(int c);
 
+//------------------------------------------------------------------------------
+template <int MODE>
+inline unsigned int str_compare_fold_ascii(unsigned int c)
+{
+    if (MODE > 0 && c - 'A' <= 'Z' - 'A')
+        c += 'a' - 'A';
+
+    if (MODE > 1 && c == '-')
+        c = '_';
+
+    return (c == '\\') ? '/' : c;
+}
+
 //------------------------------------------------------------------------------
 // Returns how many characters match at the beginning of the strings, or -1 if
 // the entire strings match.
@@ -49,6 +63,42 @@ int str_compare_impl(str_iter_impl<T>& lhs, str_iter_impl<T>& rhs)
 {
     const T* start = lhs.get_pointer();
 
+    // Fast path for ASCII, which needs neither decoding nor fold_case().  It
+    // stops short of anything that isn't a match of two ASCII characters and
+    // leaves that to the loop below.
+    while (lhs.more() && rhs.more())
+    {
+        const T* l = lhs.get_pointer();
+        const T* r = rhs.get_pointer();
+
+        unsigned int c = (unsigned int)*l;
+        unsigned int d = (unsigned int)*r;
+        if (sizeof(T) == 1)
+        {
+            c &= 0xff;
+            d &= 0xff;
+        }
+
+        if ((c | d) >= 0x80)
+            break;
+
+        c = str_compare_fold_ascii<MODE>(c);
+        d = str_compare_fold_ascii<MODE>(d);
+        if (c != d)
+            break;
+
+        lhs.reset_pointer(++l);
+        rhs.reset_pointer(++r);
+
+        if (c == '/')
+        {
+            while (lhs.more() && path::is_separator(*l))
+                lhs.reset_pointer(++l);
+            while (rhs.more() && path::is_separator(*r))
+                rhs.reset_pointer(++r);
+        }
+    }
+
     while (1)
     {
         int c = lhs.peek();
@@ -58,8 +108,8 @@ int str_compare_impl(str_iter_impl<T>& lhs, str_iter_impl<T>& rhs)
 
         if (MODE > 0)
         {
-            c = (c > 0xffff) ? c : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(c)))));
-            d = (d > 0xffff) ? d : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(d)))));
+            c = fold_case(c);
+            d = fold_case(d);
         }
 
         if (MODE > 1)
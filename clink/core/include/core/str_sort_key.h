@@ -0,0 +1,15 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Appends a sort key for the first 'len' bytes of the UTF-8 string 'in' to
+// 'out' (len < 0 means the whole string).  Comparing two keys with strcmp()
+// orders the strings case insensitively, with runs of digits compared by their
+// numeric value (so "file2" sorts before "file10").  Keys never contain a nul
+// byte, and no key byte is lower than 0x02, so callers can append their own
+// separators and tie breakers and store many keys back to back in one buffer.
+void append_sort_key(const char* in, int len, std::vector<char>& out);
@@ -9,9 +9,23 @@
 
 #include <sys/stat.h>
 
+#if !defined(FILE_ATTRIBUTE_HIDDEN)
+#   define FILE_ATTRIBUTE_HIDDEN        0x0002
+#   define FILE_ATTRIBUTE_SYSTEM        0x0004
+#   define FILE_ATTRIBUTE_DIRECTORY     0x0010
+#   define FILE_ATTRIBUTE_REPARSE_POINT 0x0400
+#endif
+
+#if !defined(_S_IFDIR)
+#   define _S_IFDIR                     S_IFDIR
+#   define _S_IFREG                     S_IFREG
+#   define _S_IFLNK                     S_IFLNK
+#endif
+
 //------------------------------------------------------------------------------
 globber::globber(const char* pattern)
-: m_files(true)
+: m_source(nullptr)
+, m_files(true)
 , m_directories(true)
 , m_dir_suffix(true)
 , m_hidden(false)
@@ -25,11 +39,9 @@ globber::globber(const char* pattern)
     // Don't bother trying to complete a UNC path that doesn't have at least
     // both a server and share component.
     if (path::is_incomplete_unc(pattern))
-    {
-        m_handle = nullptr;
         return;
-    }
 
+#if defined(PLATFORM_WINDOWS)
     // Windows: Expand if the path to complete is drive relative (e.g. 'c:foobar')
     // Drive X's current path is stored in the environment variable "=X:"
     str<288> rooted;
@@ -43,43 +55,54 @@ globber::globber(const char* pattern)
             pattern = rooted.c_str();
         }
     }
+#endif
 
-    wstr<280> wglob(pattern);
-    m_handle = FindFirstFileW(wglob.c_str(), &m_data);
-    if (m_handle == INVALID_HANDLE_VALUE)
-        m_handle = nullptr;
+    m_source = new_glob_source(pattern);
 
     path::get_directory(pattern, m_root);
     path::normalise_separators(m_root.data());
 }
 
+//------------------------------------------------------------------------------
+globber::globber(glob_source* source, const char* root)
+: m_source(source)
+, m_files(true)
+, m_directories(true)
+, m_dir_suffix(true)
+, m_hidden(false)
+, m_system(false)
+, m_dots(false)
+{
+    m_root = root;
+}
+
 //------------------------------------------------------------------------------
 globber::~globber()
 {
-    if (m_handle != nullptr)
-        FindClose(m_handle);
+    delete m_source;
 }
 
 //------------------------------------------------------------------------------
 bool globber::next(str_base& out, bool rooted, int* st_mode, int* pattr)
 {
-    if (m_handle == nullptr)
+    if (m_source == nullptr)
         return false;
 
-    str<280> file_name;
+    const char* file_name;
     int attr;
 
     while (true)
     {
-        if (m_handle == nullptr)
+        if (!m_source->next(file_name, attr))
+        {
+            delete m_source;
+            m_source = nullptr;
             return false;
-
-        file_name = m_data.cFileName;
-        attr = m_data.dwFileAttributes;
+        }
 
         bool again = false;
 
-        const wchar_t* c = m_data.cFileName;
+        const char* c = file_name;
         again |= (c[0] == '.' && (!c[1] || (c[1] == '.' && !c[2])) && !m_dots);
 
         again |= (attr & FILE_ATTRIBUTE_SYSTEM) && !m_system;
@@ -87,8 +110,6 @@ bool globber::next(str_base& out, bool rooted, int* st_mode, int* pattr)
         again |= (attr & FILE_ATTRIBUTE_DIRECTORY) && !m_directories;
         again |= !(attr & FILE_ATTRIBUTE_DIRECTORY) && !m_files;
 
-        next_file();
-
         if (!again)
             break;
     }
@@ -97,7 +118,7 @@ bool globber::next(str_base& out, bool rooted, int* st_mode, int* pattr)
     if (rooted)
         out << m_root;
 
-    path::append(out, file_name.c_str());
+    path::append(out, file_name);
 
     if (attr & FILE_ATTRIBUTE_DIRECTORY && m_dir_suffix)
         out << PATH_SEP;
@@ -121,13 +142,3 @@ bool globber::next(str_base& out, bool rooted, int* st_mode, int* pattr)
 
     return true;
 }
-
-//------------------------------------------------------------------------------
-void globber::next_file()
-{
-    if (FindNextFileW(m_handle, &m_data))
-        return;
-
-    FindClose(m_handle);
-    m_handle = nullptr;
-}
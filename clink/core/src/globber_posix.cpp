@@ -0,0 +1,186 @@
+// Copyright (c) 2015 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "globber.h"
+#include "match_wild.h"
+#include "path.h"
+#include "str.h"
+
+#if defined(PLATFORM_POSIX)
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#   include <sys/syscall.h>
+#endif
+
+#define FILE_ATTRIBUTE_HIDDEN           0x0002
+#define FILE_ATTRIBUTE_DIRECTORY        0x0010
+#define FILE_ATTRIBUTE_REPARSE_POINT    0x0400
+
+//------------------------------------------------------------------------------
+// Reads directory entries in batches with getdents64 where it's available, so
+// there's one system call per buffer full of entries rather than one per
+// entry.  The entry types come from d_type, so files only need to be stat'd
+// when the file system doesn't say (or to see where a symlink points).
+class posix_glob_source
+    : public glob_source
+{
+public:
+                        posix_glob_source(int fd, const char* wild);
+                        ~posix_glob_source();
+    virtual bool        next(const char*& name, int& attr) override;
+
+private:
+    bool                next_entry(const char*& name, unsigned char& type);
+    int                 get_attributes(const char* name, unsigned char type) const;
+    int                 m_fd;
+    str<64>             m_wild;
+#if defined(__linux__)
+    struct linux_dirent64
+    {
+        unsigned long long  d_ino;
+        long long           d_off;
+        unsigned short      d_reclen;
+        unsigned char       d_type;
+        char                d_name[1];
+    };
+
+    alignas(8) char     m_buffer[32768];
+    int                 m_used;
+    int                 m_pos;
+#else
+    DIR*                m_dir;
+#endif
+};
+
+//------------------------------------------------------------------------------
+posix_glob_source::posix_glob_source(int fd, const char* wild)
+: m_fd(fd)
+#if defined(__linux__)
+, m_used(0)
+, m_pos(0)
+#else
+, m_dir(fdopendir(fd))
+#endif
+{
+    m_wild = wild;
+}
+
+//------------------------------------------------------------------------------
+posix_glob_source::~posix_glob_source()
+{
+#if defined(__linux__)
+    close(m_fd);
+#else
+    if (m_dir)
+        closedir(m_dir);
+    else
+        close(m_fd);
+#endif
+}
+
+//------------------------------------------------------------------------------
+bool posix_glob_source::next_entry(const char*& name, unsigned char& type)
+{
+#if defined(__linux__)
+    if (m_pos >= m_used)
+    {
+        m_used = int(syscall(SYS_getdents64, m_fd, m_buffer, sizeof(m_buffer)));
+        m_pos = 0;
+        if (m_used <= 0)
+            return false;
+    }
+
+    const linux_dirent64* entry = (const linux_dirent64*)(m_buffer + m_pos);
+    m_pos += entry->d_reclen;
+    name = entry->d_name;
+    type = entry->d_type;
+    return true;
+#else
+    const struct dirent* entry = m_dir ? readdir(m_dir) : nullptr;
+    if (!entry)
+        return false;
+
+    name = entry->d_name;
+#   if defined(DT_UNKNOWN)
+    type = entry->d_type;
+#   else
+    type = 0;
+#   endif
+    return true;
+#endif
+}
+
+//------------------------------------------------------------------------------
+int posix_glob_source::get_attributes(const char* name, unsigned char type) const
+{
+    int attr = (name[0] == '.') ? FILE_ATTRIBUTE_HIDDEN : 0;
+
+    struct stat st;
+    switch (type)
+    {
+    case DT_DIR:
+        return attr | FILE_ATTRIBUTE_DIRECTORY;
+
+    case DT_REG:
+        return attr;
+
+    case DT_LNK:
+        // Like Windows' directory symlinks, links to directories are both.
+        attr |= FILE_ATTRIBUTE_REPARSE_POINT;
+        if (fstatat(m_fd, name, &st, 0) == 0 && S_ISDIR(st.st_mode))
+            attr |= FILE_ATTRIBUTE_DIRECTORY;
+        return attr;
+
+    case DT_UNKNOWN:
+        if (fstatat(m_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            return attr;
+        if (S_ISLNK(st.st_mode))
+            return get_attributes(name, DT_LNK);
+        return S_ISDIR(st.st_mode) ? (attr | FILE_ATTRIBUTE_DIRECTORY) : attr;
+
+    default:
+        return attr;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool posix_glob_source::next(const char*& name, int& attr)
+{
+    unsigned char type;
+    while (next_entry(name, type))
+    {
+        if (!path::match_wild(m_wild.c_str(), name))
+            continue;
+
+        attr = get_attributes(name, type);
+        return true;
+    }
+
+    return false;
+}
+
+
+
+//------------------------------------------------------------------------------
+glob_source* new_glob_source(const char* pattern)
+{
+    str<280> dir;
+    path::get_directory(pattern, dir);
+    if (dir.empty())
+        dir = ".";
+
+    int fd = open(dir.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+
+    str<64> wild;
+    path::get_name(pattern, wild);
+    return new posix_glob_source(fd, wild.c_str());
+}
+
+#endif // PLATFORM_POSIX
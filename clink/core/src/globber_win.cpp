@@ -0,0 +1,72 @@
+// Copyright (c) 2015 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "globber.h"
+#include "str.h"
+
+#if defined(PLATFORM_WINDOWS)
+
+//------------------------------------------------------------------------------
+class win_glob_source
+    : public glob_source
+{
+public:
+                        win_glob_source(HANDLE handle, const WIN32_FIND_DATAW& data);
+                        ~win_glob_source();
+    virtual bool        next(const char*& name, int& attr) override;
+
+private:
+    WIN32_FIND_DATAW    m_data;
+    HANDLE              m_handle;
+    bool                m_first;
+    str<280>            m_name;
+};
+
+//------------------------------------------------------------------------------
+win_glob_source::win_glob_source(HANDLE handle, const WIN32_FIND_DATAW& data)
+: m_data(data)
+, m_handle(handle)
+, m_first(true)
+{
+}
+
+//------------------------------------------------------------------------------
+win_glob_source::~win_glob_source()
+{
+    FindClose(m_handle);
+}
+
+//------------------------------------------------------------------------------
+bool win_glob_source::next(const char*& name, int& attr)
+{
+    if (!m_first && !FindNextFileW(m_handle, &m_data))
+        return false;
+
+    m_first = false;
+
+    // Convert straight into the name buffer; the caller copies it only if the
+    // entry makes it through its filters.
+    m_name.from_utf16(m_data.cFileName);
+
+    name = m_name.c_str();
+    attr = m_data.dwFileAttributes;
+    return true;
+}
+
+
+
+//------------------------------------------------------------------------------
+glob_source* new_glob_source(const char* pattern)
+{
+    wstr<280> wglob(pattern);
+
+    WIN32_FIND_DATAW data;
+    HANDLE handle = FindFirstFileW(wglob.c_str(), &data);
+    if (handle == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    return new win_glob_source(handle, data);
+}
+
+#endif // PLATFORM_WINDOWS
@@ -78,6 +78,28 @@ int get_file_size(const char* path)
     return ret;
 }
 
+//------------------------------------------------------------------------------
+// Times are in 100ns units, and are only comparable with get_current_time().
+bool get_modified_time(const char* path, unsigned long long& out)
+{
+    wstr<280> wpath(path);
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(wpath.c_str(), GetFileExInfoStandard, &data))
+        return false;
+
+    out = (static_cast<unsigned long long>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+          data.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+unsigned long long get_current_time()
+{
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    return (static_cast<unsigned long long>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+}
+
 //------------------------------------------------------------------------------
 void get_current_dir(str_base& out)
 {
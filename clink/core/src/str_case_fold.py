@@ -0,0 +1,133 @@
+# Copyright (c) 2016 Martin Ridgers
+# License: http://opensource.org/licenses/MIT
+#
+# Generates str_case_fold.cpp, the two level table used by fold_case(), or
+# with --test the list of fold pairs that the tests check it against.
+#
+#   python str_case_fold.py [ucd_dir] > str_case_fold.cpp
+#   python str_case_fold.py --test [ucd_dir] > ../test/str_case_fold_data.h
+#
+# With a directory it reads the C and S (simple) mappings from the UCD's
+# CaseFolding.txt. Without one it derives the same mappings from the data
+# built into Python.
+
+import re
+import sys
+import unicodedata
+
+MAX_CODEPOINT = 0x110000
+BLOCK_SHIFT = 8
+
+#-------------------------------------------------------------------------------
+def load_case_folding(ucd_dir):
+    folds = {}
+    with open(ucd_dir + "/CaseFolding.txt", encoding="utf-8") as f:
+        version = re.search(r"-([\d.]+)\.txt", f.readline()).group(1)
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+
+            code, status, mapping = [x.strip() for x in line.split(";")[:3]]
+            if status in ("C", "S"):
+                folds[int(code, 16)] = int(mapping, 16)
+    return version, folds
+
+#-------------------------------------------------------------------------------
+def derive_case_folding():
+    # casefold() is full folding (C and F). Where that gives more than one
+    # codepoint the simple (S) fold, if there is one, is the lower case.
+    folds = {}
+    for c in range(MAX_CODEPOINT):
+        ch = chr(c)
+        folded = ch.casefold()
+        if len(folded) != 1:
+            folded = ch.lower()
+        if len(folded) == 1 and folded != ch:
+            folds[c] = ord(folded)
+    return unicodedata.unidata_version, folds
+
+#-------------------------------------------------------------------------------
+def build_tables(folds):
+    size = 1 << BLOCK_SHIFT
+    blocks = {}
+    index = []
+    for base in range(0, MAX_CODEPOINT, size):
+        block = tuple(folds.get(c, c) - c for c in range(base, base + size))
+        index.append(blocks.setdefault(block, len(blocks)))
+    return index, sorted(blocks, key=blocks.get)
+
+#-------------------------------------------------------------------------------
+def write_rows(out, indent, values, per_row):
+    for i in range(0, len(values), per_row):
+        out.write(indent + ", ".join(str(v) for v in values[i:i + per_row]) + ",\n")
+
+#-------------------------------------------------------------------------------
+def write_header(out):
+    out.write("// Copyright (c) 2016 Martin Ridgers\n")
+    out.write("// License: http://opensource.org/licenses/MIT\n")
+    out.write("\n")
+
+#-------------------------------------------------------------------------------
+def write_table(out, version, folds):
+    index, blocks = build_tables(folds)
+    if len(blocks) > 0x100:
+        raise SystemExit("Too many blocks for g_case_fold_index's entries")
+
+    write_header(out)
+    out.write("#include \"pch.h\"\n")
+    out.write("#include \"str_case_fold.h\"\n")
+    out.write("\n")
+    out.write("// Generated by str_case_fold.py from Unicode %s's CaseFolding.txt. Do not edit.\n" % version)
+    out.write("//\n")
+    out.write("// Only the C and S (simple) mappings are used.  Each block holds the deltas to\n")
+    out.write("// add to the codepoints in a 256 codepoint range; ranges with identical deltas\n")
+    out.write("// share a block.\n")
+    out.write("\n")
+    out.write("//------------------------------------------------------------------------------\n")
+    out.write("const unsigned char g_case_fold_index[0x%x] = {\n" % len(index))
+    write_rows(out, "    ", index, 24)
+    out.write("};\n")
+    out.write("\n")
+    out.write("//------------------------------------------------------------------------------\n")
+    out.write("const int g_case_fold_blocks[%d][0x%x] = {\n" % (len(blocks), 1 << BLOCK_SHIFT))
+    for i, block in enumerate(blocks):
+        out.write("    { // %d\n" % i)
+        write_rows(out, "        ", block, 16)
+        out.write("    },\n")
+    out.write("};\n")
+
+#-------------------------------------------------------------------------------
+def write_test_data(out, version, folds):
+    pairs = ["{ 0x%04x, 0x%04x }," % (c, folds[c]) for c in sorted(folds)]
+
+    write_header(out)
+    out.write("// Generated by str_case_fold.py from Unicode %s's CaseFolding.txt. Do not edit.\n" % version)
+    out.write("\n")
+    out.write("#pragma once\n")
+    out.write("\n")
+    out.write("// The C and S (simple) mappings, in codepoint order.\n")
+    out.write("static const struct { int from; int to; } s_case_folding[%d] = {\n" % len(pairs))
+    for i in range(0, len(pairs), 6):
+        out.write("    " + " ".join(pairs[i:i + 6]) + "\n")
+    out.write("};\n")
+
+#-------------------------------------------------------------------------------
+def main():
+    args = sys.argv[1:]
+    test = "--test" in args
+    if test:
+        args.remove("--test")
+
+    if args:
+        version, folds = load_case_folding(args[0])
+    else:
+        version, folds = derive_case_folding()
+
+    if test:
+        write_test_data(sys.stdout, version, folds)
+    else:
+        write_table(sys.stdout, version, folds)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,72 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "str_case_fold.h"
+#include "str_iter.h"
+#include "str_sort_key.h"
+
+//------------------------------------------------------------------------------
+static void append_utf8(int c, std::vector<char>& out)
+{
+    if (c < 0x80)
+    {
+        out.push_back(char(c));
+        return;
+    }
+
+    if (c < 0x800)
+    {
+        out.push_back(char(0xc0 | (c >> 6)));
+    }
+    else
+    {
+        if (c < 0x10000)
+        {
+            out.push_back(char(0xe0 | (c >> 12)));
+        }
+        else
+        {
+            out.push_back(char(0xf0 | (c >> 18)));
+            out.push_back(char(0x80 | ((c >> 12) & 0x3f)));
+        }
+        out.push_back(char(0x80 | ((c >> 6) & 0x3f)));
+    }
+    out.push_back(char(0x80 | (c & 0x3f)));
+}
+
+//------------------------------------------------------------------------------
+void append_sort_key(const char* in, int len, std::vector<char>& out)
+{
+    str_iter iter(in, len);
+    while (iter.more())
+    {
+        const char* ptr = iter.get_pointer();
+        if (*ptr < '0' || *ptr > '9')
+        {
+            int c = iter.next();
+            if (c < 0x02)
+                c = 0x02;
+            append_utf8(fold_case(c), out);
+            continue;
+        }
+
+        // A run of digits is encoded as '0' followed by the count of
+        // significant digits (offset to stay clear of separator bytes) and
+        // then the digits themselves, so that longer numbers sort after
+        // shorter ones.  '0' can't otherwise occur in a key
+        // because digits are always consumed as a run.
+        while (iter.more() && unsigned(*iter.get_pointer() - '0') <= 9)
+            iter.next();
+
+        const char* end = iter.get_pointer();
+
+        while (ptr + 1 < end && *ptr == '0')
+            ++ptr;
+
+        int digits = int(end - ptr);
+        out.push_back('0');
+        out.push_back(char(min(digits + 1, 0xff)));
+        out.insert(out.end(), ptr, end);
+    }
+}
@@ -0,0 +1,277 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include <core/base.h>
+#include <core/globber.h>
+#include <core/os.h>
+#include <core/path.h>
+#include <core/str.h>
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <vector>
+
+#if !defined(FILE_ATTRIBUTE_HIDDEN)
+#   define FILE_ATTRIBUTE_HIDDEN        0x0002
+#   define FILE_ATTRIBUTE_SYSTEM        0x0004
+#   define FILE_ATTRIBUTE_DIRECTORY     0x0010
+#   define FILE_ATTRIBUTE_REPARSE_POINT 0x0400
+#endif
+
+#if !defined(_S_IFDIR)
+#   define _S_IFDIR                     S_IFDIR
+#   define _S_IFREG                     S_IFREG
+#endif
+
+//------------------------------------------------------------------------------
+// Hands out a fixed list of entries, so globber's filtering can be tested
+// without a file system behind it.
+class test_glob_source
+    : public glob_source
+{
+public:
+    struct entry
+    {
+        const char*     name;
+        int             attr;
+    };
+
+                        test_glob_source(const entry* entries, int count) : m_entries(entries), m_count(count) {}
+    virtual bool        next(const char*& name, int& attr) override;
+
+private:
+    const entry*        m_entries;
+    int                 m_count;
+    int                 m_index = 0;
+};
+
+//------------------------------------------------------------------------------
+bool test_glob_source::next(const char*& name, int& attr)
+{
+    if (m_index >= m_count)
+        return false;
+
+    name = m_entries[m_index].name;
+    attr = m_entries[m_index].attr;
+    ++m_index;
+    return true;
+}
+
+
+
+//------------------------------------------------------------------------------
+static const test_glob_source::entry c_entries[] = {
+    { ".",              FILE_ATTRIBUTE_DIRECTORY },
+    { "..",             FILE_ATTRIBUTE_DIRECTORY },
+    { ".config",        0 },
+    { "file",           0 },
+    { "dir",            FILE_ATTRIBUTE_DIRECTORY },
+    { "hidden",         FILE_ATTRIBUTE_HIDDEN },
+    { "system",         FILE_ATTRIBUTE_SYSTEM },
+    { "hidden_dir",     FILE_ATTRIBUTE_DIRECTORY|FILE_ATTRIBUTE_HIDDEN },
+};
+
+//------------------------------------------------------------------------------
+static globber* new_test_globber()
+{
+    return new globber(new test_glob_source(c_entries, sizeof_array(c_entries)), "root" PATH_SEP);
+}
+
+//------------------------------------------------------------------------------
+static void glob_names(globber& glob, str_base& out)
+{
+    out.clear();
+
+    str<> name;
+    while (glob.next(name, false))
+    {
+        if (out.length())
+            out << " ";
+        out << name;
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Globber")
+{
+    globber* glob = new_test_globber();
+    str<> names;
+
+    SECTION("Defaults")
+    {
+        glob_names(*glob, names);
+        REQUIRE(names.equals(".config file dir" PATH_SEP));
+    }
+
+    SECTION("Dots")
+    {
+        glob->dots(true);
+        glob_names(*glob, names);
+        REQUIRE(names.equals("." PATH_SEP " .." PATH_SEP " .config file dir" PATH_SEP));
+    }
+
+    SECTION("Hidden")
+    {
+        glob->hidden(true);
+        glob_names(*glob, names);
+        REQUIRE(names.equals(".config file dir" PATH_SEP " hidden hidden_dir" PATH_SEP));
+    }
+
+    SECTION("System")
+    {
+        glob->system(true);
+        glob_names(*glob, names);
+        REQUIRE(names.equals(".config file dir" PATH_SEP " system"));
+    }
+
+    SECTION("Files only")
+    {
+        glob->directories(false);
+        glob_names(*glob, names);
+        REQUIRE(names.equals(".config file"));
+    }
+
+    SECTION("Directories only")
+    {
+        glob->files(false);
+        glob->hidden(true);
+        glob_names(*glob, names);
+        REQUIRE(names.equals("dir" PATH_SEP " hidden_dir" PATH_SEP));
+    }
+
+    SECTION("No directory suffix")
+    {
+        glob->suffix_dirs(false);
+        glob_names(*glob, names);
+        REQUIRE(names.equals(".config file dir"));
+    }
+
+    SECTION("Rooted")
+    {
+        str<> name;
+        REQUIRE(glob->next(name));
+        REQUIRE(name.equals("root" PATH_SEP ".config"));
+        REQUIRE(glob->next(name));
+        REQUIRE(name.equals("root" PATH_SEP "file"));
+    }
+
+    delete glob;
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Globber st_mode")
+{
+    static const test_glob_source::entry entries[] = {
+        { "file",           0 },
+        { "dir",            FILE_ATTRIBUTE_DIRECTORY },
+        { "file_link",      FILE_ATTRIBUTE_REPARSE_POINT },
+        { "dir_link",       FILE_ATTRIBUTE_DIRECTORY|FILE_ATTRIBUTE_REPARSE_POINT },
+    };
+
+    globber glob(new test_glob_source(entries, sizeof_array(entries)), "");
+
+    str<> name;
+    int mode;
+    int attr;
+
+    REQUIRE(glob.next(name, false, &mode, &attr));
+    REQUIRE(mode == _S_IFREG);
+    REQUIRE(attr == 0);
+
+    REQUIRE(glob.next(name, false, &mode, &attr));
+    REQUIRE(mode == _S_IFDIR);
+    REQUIRE(attr == FILE_ATTRIBUTE_DIRECTORY);
+
+    // Reparse points are only reported as links where the CRT has them.
+    REQUIRE(glob.next(name, false, &mode, &attr));
+    REQUIRE(attr == FILE_ATTRIBUTE_REPARSE_POINT);
+#ifdef S_ISLNK
+    REQUIRE(mode == S_IFLNK);
+#else
+    REQUIRE(mode == _S_IFREG);
+#endif
+
+    REQUIRE(glob.next(name, false, &mode, &attr));
+#ifdef S_ISLNK
+    REQUIRE(mode == (_S_IFDIR|S_IFLNK));
+#else
+    REQUIRE(mode == _S_IFDIR);
+#endif
+
+    REQUIRE(!glob.next(name));
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Globber benchmark", "[.benchmark]")
+{
+    static const int file_count = 50000;
+    static const int passes = 20;
+
+    typedef std::chrono::steady_clock clock;
+    auto to_ms = [] (clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+
+    // Filtering and st_mode mapping on their own, from a source in memory.
+    std::vector<str_moveable> names;
+    std::vector<test_glob_source::entry> entries;
+    names.reserve(file_count);
+    for (int i = 0; i < file_count; ++i)
+    {
+        str<64> name;
+        name.format("file_%05d.txt", i);
+        names.emplace_back(name.c_str());
+    }
+    for (int i = 0; i < file_count; ++i)
+    {
+        int attr = (i % 10 == 0) ? FILE_ATTRIBUTE_DIRECTORY : 0;
+        attr |= (i % 50 == 1) ? FILE_ATTRIBUTE_HIDDEN : 0;
+        entries.push_back({ names[i].c_str(), attr });
+    }
+
+    int found = 0;
+    auto start = clock::now();
+    for (int p = 0; p < passes; ++p)
+    {
+        globber glob(new test_glob_source(entries.data(), file_count), "root" PATH_SEP);
+        str<280> name;
+        int mode;
+        while (glob.next(name, true, &mode))
+            ++found;
+    }
+    printf("globber filtering: %d passes over %d entries in %.1f ms (%d found)\n",
+        passes, file_count, to_ms(clock::now() - start), found);
+
+    // And the platform's source reading a real directory.
+    str<280> root;
+    REQUIRE(os::get_temp_dir(root));
+    path::append(root, "clink_globber_benchmark");
+    os::make_dir(root.c_str());
+
+    str<280> file;
+    for (int i = 0; i < file_count; ++i)
+    {
+        file.format("%s" PATH_SEP "file_%05d.txt", root.c_str(), i);
+        if (os::get_path_type(file.c_str()) != os::path_type_file)
+            fclose(fopen(file.c_str(), "w"));
+    }
+
+    str<280> pattern;
+    pattern.format("%s" PATH_SEP "*", root.c_str());
+
+    found = 0;
+    start = clock::now();
+    for (int p = 0; p < passes; ++p)
+    {
+        globber glob(pattern.c_str());
+        str<280> name;
+        int mode;
+        while (glob.next(name, true, &mode))
+            ++found;
+    }
+    printf("globber directory: %d passes over %d files in %.1f ms (%d found)\n",
+        passes, file_count, to_ms(clock::now() - start), found);
+}
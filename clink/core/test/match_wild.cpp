@@ -76,4 +76,21 @@ TEST_CASE("path::match_wild()")
         REQUIRE(!path::match_wild("ori*", "origin/master", false));
         REQUIRE(path::match_wild("ori*", "origin/master", true));
     }
+
+    SECTION("Many stars")
+    {
+        REQUIRE(path::match_wild("*a*a*a*a*a*a*a*a*a*a*a*a", "aaaaaaaaaaaaaaaa"));
+        REQUIRE(!path::match_wild("*a*a*a*a*a*a*a*a*a*a*a*a", "aaaaaaaaaaa"));
+    }
+
+    SECTION("Reused matcher")
+    {
+        path::wild_matcher<char> matcher(str_iter("bu*"));
+        REQUIRE(matcher.match(str_iter("build")));
+        REQUIRE(matcher.match(str_iter(".build")));
+        REQUIRE(!matcher.match(str_iter("abc/build")));
+        REQUIRE(matcher.match(str_iter("bu/ild"), true));
+        REQUIRE(!matcher.match(str_iter("bu/ild")));
+        REQUIRE(matcher.match(str_iter("build/", 5)));
+    }
 }
@@ -0,0 +1,109 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "str_case_fold_data.h"
+
+#include <core/base.h>
+#include <core/str_case_fold.h>
+
+#include <chrono>
+#include <vector>
+
+//------------------------------------------------------------------------------
+TEST_CASE("Case folding")
+{
+    SECTION("ASCII")
+    {
+        REQUIRE(fold_case('A') == 'a');
+        REQUIRE(fold_case('Z') == 'z');
+        REQUIRE(fold_case('a') == 'a');
+        REQUIRE(fold_case('@') == '@');
+        REQUIRE(fold_case('[') == '[');
+    }
+
+    SECTION("Parity")
+    {
+        // Every C and S pair, and identity for everything else.  Report the
+        // first codepoint that differs rather than asserting on every one.
+        int i = 0;
+        int n = sizeof_array(s_case_folding);
+        int mismatch = -1;
+        for (int c = 0; c < 0x110000; ++c)
+        {
+            int expected = c;
+            if (i < n && s_case_folding[i].from == c)
+                expected = s_case_folding[i++].to;
+
+            if (mismatch < 0 && fold_case(c) != expected)
+                mismatch = c;
+        }
+
+        REQUIRE(i == n);
+        REQUIRE(mismatch == -1);
+    }
+
+    SECTION("CaseFolding.txt")
+    {
+        // Common (C) mappings.
+        REQUIRE(fold_case(0x212a) == 'k');              // KELVIN SIGN
+        REQUIRE(fold_case(0x00b5) == 0x03bc);           // MICRO SIGN
+        REQUIRE(fold_case(0x03a3) == 0x03c3);           // GREEK CAPITAL LETTER SIGMA
+        REQUIRE(fold_case(0x03c2) == 0x03c3);           // GREEK SMALL LETTER FINAL SIGMA
+        REQUIRE(fold_case(0x0178) == 0x00ff);           // LATIN CAPITAL LETTER Y WITH DIAERESIS
+        REQUIRE(fold_case(0x10400) == 0x10428);         // DESERET CAPITAL LETTER LONG I
+        REQUIRE(fold_case(0x1e921) == 0x1e943);         // ADLAM CAPITAL LETTER SHA
+
+        // Simple (S) mappings, used in place of the full (F) ones.
+        REQUIRE(fold_case(0x1e9e) == 0x00df);           // LATIN CAPITAL LETTER SHARP S
+        REQUIRE(fold_case(0x1f88) == 0x1f80);           // GREEK CAPITAL LETTER ALPHA WITH PSILI AND PROSGEGRAMMENI
+
+        // Only full (F) or Turkic (T) mappings, so these are left alone.
+        REQUIRE(fold_case(0x0130) == 0x0130);           // LATIN CAPITAL LETTER I WITH DOT ABOVE
+        REQUIRE(fold_case(0x00df) == 0x00df);           // LATIN SMALL LETTER SHARP S
+        REQUIRE(fold_case(0x0390) == 0x0390);           // GREEK SMALL LETTER IOTA WITH DIALYTIKA AND TONOS
+        REQUIRE(fold_case('I') == 'i');
+        REQUIRE(fold_case(0x0131) == 0x0131);           // LATIN SMALL LETTER DOTLESS I
+    }
+
+    SECTION("Out of range")
+    {
+        REQUIRE(fold_case(-1) == -1);
+        REQUIRE(fold_case(0x110000) == 0x110000);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Case folding benchmark", "[.benchmark]")
+{
+    static const int passes = 200;
+
+    // Mostly Latin text with some Greek, Cyrillic, and CJK mixed in.
+    std::vector<wchar_t> text;
+    static const wchar_t c_sample[] = L"Build_Output\\Caf\x00c9 \x03a3\x03bf\x03c6\x03af\x03b1 "
+        L"\x041e\x0442\x0447\x0451\x0442 \x6587\x6863 README.TXT ";
+    while (text.size() < 0x10000)
+        text.insert(text.end(), c_sample, c_sample + sizeof_array(c_sample) - 1);
+
+    auto to_ns = [] (std::chrono::steady_clock::duration d) {
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    };
+
+    unsigned int sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; ++p)
+        for (wchar_t c : text)
+            sum += fold_case(c);
+    double fold_ns = to_ns(std::chrono::steady_clock::now() - start);
+
+    // What str_compare and match_wild used to call for each character.
+    start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; ++p)
+        for (wchar_t c : text)
+            sum += (unsigned int)(uintptr_t)CharLowerW((wchar_t*)(uintptr_t)c);
+    double lower_ns = to_ns(std::chrono::steady_clock::now() - start);
+
+    double chars = double(passes) * text.size();
+    printf("case folding: fold_case %.2f ns, CharLowerW %.2f ns per char (%u)\n",
+        fold_ns / chars, lower_ns / chars, sum);
+}
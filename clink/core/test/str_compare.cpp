@@ -6,6 +6,9 @@
 #include <core/str.h>
 #include <core/str_compare.h>
 
+#include <chrono>
+#include <vector>
+
 //------------------------------------------------------------------------------
 TEST_CASE("String compare")
 {
@@ -51,6 +54,34 @@ TEST_CASE("String compare")
         REQUIRE(str_compare("-", "_") == -1);
     }
 
+    SECTION("Separators")
+    {
+        str_compare_scope _(str_compare_scope::caseless);
+
+        REQUIRE(str_compare("a/b", "a\\b") == -1);
+        REQUIRE(str_compare("a\\\\b", "A/b") == -1);
+        REQUIRE(str_compare("a//b/", "a/b\\") == -1);
+        REQUIRE(str_compare("a/b", "a/c") == 2);
+    }
+
+    SECTION("ASCII then non-ASCII")
+    {
+        str_compare_scope _(str_compare_scope::caseless);
+
+        REQUIRE(str_compare("aBc\xc3\x84", "abc\xc3\xa4") == -1);
+        REQUIRE(str_compare("abc\xc3\x84x", "ABC\xc3\xa4y") == 5);
+        REQUIRE(str_compare(L"aBc\x00c4", L"abc\x00e4") == -1);
+    }
+
+    SECTION("Case folding")
+    {
+        str_compare_scope _(str_compare_scope::caseless);
+
+        REQUIRE(str_compare("\xce\xa3", "\xcf\x82") == -1);
+        REQUIRE(str_compare("\xf0\x90\x90\x80", "\xf0\x90\x90\xa8") == -1);
+        REQUIRE(str_compare(L"\xd801\xdc00", L"\xd801\xdc28") == -1);
+    }
+
     SECTION("Scopes")
     {
         str_compare_scope outer(str_compare_scope::exact);
@@ -119,3 +150,52 @@ TEST_CASE("String compare")
         REQUIRE(str_compare(L"\xd800\xdc00" L"abc", L"\xd800\xdc00") == 2);
     }
 }
+
+//------------------------------------------------------------------------------
+TEST_CASE("String compare benchmark", "[.benchmark]")
+{
+    static const int pair_count = 10000;
+    static const int passes = 20;
+
+    // Path-like pairs that match in varying case and separators, as when a
+    // typed word is compared with file matches.  Each pair also comes with a
+    // leading non-ASCII character, which sends the whole comparison down the
+    // per-codepoint path, to compare against the ASCII fast path.
+    std::vector<str_moveable> ascii;
+    std::vector<str_moveable> unicode;
+    for (int i = 0; i < pair_count; ++i)
+    {
+        str<128> l, r;
+        l.format("C:\\Users\\Build-Agent\\source\\repos\\Project_%d\\src\\file_%d.cpp", i % 97, i);
+        r.format("c:/users/build_agent//Source/Repos/project_%d/SRC/File_%d.cpp", i % 97, i);
+        ascii.emplace_back(l.c_str());
+        ascii.emplace_back(r.c_str());
+
+        str<128> ul, ur;
+        ul << "\xc3\xa9" << l.c_str();
+        ur << "\xc3\xa9" << r.c_str();
+        unicode.emplace_back(ul.c_str());
+        unicode.emplace_back(ur.c_str());
+    }
+
+    auto measure = [] (const std::vector<str_moveable>& pairs) {
+        int matched = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int p = 0; p < passes; ++p)
+            for (size_t i = 0; i < pairs.size(); i += 2)
+                matched += str_compare(pairs[i].c_str(), pairs[i + 1].c_str()) != 0;
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        return std::make_pair(double(ns) / (passes * pairs.size() / 2), matched);
+    };
+
+    static const char* const c_names[] = { "exact", "caseless", "relaxed" };
+    for (int mode = 0; mode < str_compare_scope::num_scope_values; ++mode)
+    {
+        str_compare_scope _(mode);
+        auto fast = measure(ascii);
+        auto slow = measure(unicode);
+        printf("str_compare (%s): ascii %.1f ns, per-codepoint %.1f ns per pair\n",
+            c_names[mode], fast.first, slow.first);
+    }
+}
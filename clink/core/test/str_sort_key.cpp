@@ -0,0 +1,131 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include <core/base.h>
+#include <core/str.h>
+#include <core/str_sort_key.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+//------------------------------------------------------------------------------
+static int compare_keys(const char* lhs, const char* rhs)
+{
+    std::vector<char> l, r;
+    append_sort_key(lhs, -1, l);
+    append_sort_key(rhs, -1, r);
+    l.push_back('\0');
+    r.push_back('\0');
+
+    int cmp = strcmp(l.data(), r.data());
+    return (cmp > 0) - (cmp < 0);
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Sort keys")
+{
+    SECTION("Basic")
+    {
+        REQUIRE(compare_keys("abc", "abc") == 0);
+        REQUIRE(compare_keys("abc", "abd") < 0);
+        REQUIRE(compare_keys("ab", "abc") < 0);
+        REQUIRE(compare_keys("", "a") < 0);
+    }
+
+    SECTION("Case insensitive")
+    {
+        REQUIRE(compare_keys("ABC", "abc") == 0);
+        REQUIRE(compare_keys("Zeta", "alpha") > 0);
+        REQUIRE(compare_keys("\xc3\x84", "\xc3\xa4") == 0);
+    }
+
+    SECTION("Digits as numbers")
+    {
+        REQUIRE(compare_keys("file2", "file10") < 0);
+        REQUIRE(compare_keys("file10", "file9") > 0);
+        REQUIRE(compare_keys("x007", "x7") == 0);
+        REQUIRE(compare_keys("v1.2", "v1.10") < 0);
+        REQUIRE(compare_keys("a0", "a") > 0);
+    }
+
+    SECTION("Length")
+    {
+        std::vector<char> key;
+        append_sort_key("abcdef", 3, key);
+        key.push_back('\0');
+        REQUIRE(strcmp(key.data(), "abc") == 0);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Sort keys benchmark", "[.benchmark]")
+{
+    static const int count = 50000;
+
+    static const char* const c_stems[] = {
+        "readme", "Build_Output", "caf\xc3\xa9", "Module", "notes", "IMG_", "setup-v",
+    };
+
+    std::vector<str_moveable> names;
+    names.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        str<64> name;
+        int n = (i * 7919) % count;
+        name.format("%s%d%s", c_stems[i % sizeof_array(c_stems)], n, (i % 5) ? ".txt" : "\\");
+        names.emplace_back(name.c_str());
+    }
+
+    auto to_ms = [] (std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+
+    std::vector<const char*> order;
+    for (const auto& name : names)
+        order.push_back(name.c_str());
+
+    // How sort_match_list() used to sort; both strings converted and collated
+    // in every comparison.
+    auto start = std::chrono::steady_clock::now();
+    std::sort(order.begin(), order.end(), [] (const char* l, const char* r) {
+        wstr<> wl, wr;
+        to_utf16(wl, l);
+        to_utf16(wr, r);
+        DWORD flags = SORT_DIGITSASNUMBERS|NORM_LINGUISTIC_CASING|LINGUISTIC_IGNORECASE;
+        return CompareStringW(LOCALE_USER_DEFAULT, flags,
+            wl.c_str(), wl.length(), wr.c_str(), wr.length()) == CSTR_LESS_THAN;
+    });
+    double collate_ms = to_ms(std::chrono::steady_clock::now() - start);
+
+    // One key per string up front, then strcmp() of the keys.
+    order.clear();
+    for (const auto& name : names)
+        order.push_back(name.c_str());
+
+    start = std::chrono::steady_clock::now();
+    std::vector<char> keys;
+    std::vector<size_t> offsets;
+    offsets.reserve(count);
+    for (const char* name : order)
+    {
+        offsets.push_back(keys.size());
+        append_sort_key(name, -1, keys);
+        keys.push_back('\0');
+    }
+
+    std::vector<int> indices(count);
+    for (int i = 0; i < count; ++i)
+        indices[i] = i;
+
+    const char* base = keys.data();
+    std::sort(indices.begin(), indices.end(), [&] (int l, int r) {
+        return strcmp(base + offsets[l], base + offsets[r]) < 0;
+    });
+    double keys_ms = to_ms(std::chrono::steady_clock::now() - start);
+
+    printf("sort %d names: CompareStringW %.1f ms, sort keys %.1f ms (%u key bytes)\n",
+        count, collate_ms, keys_ms, (unsigned int)keys.size());
+}
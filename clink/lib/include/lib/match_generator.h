@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <functional>
+
 class line_state;
 class match_builder;
 struct match_display_filter_entry;
@@ -21,11 +23,29 @@ struct word_break_info
 class match_generator
 {
 public:
+    typedef std::function<bool (match_builder& builder)> parallel_task;
+
     virtual bool    generate(const line_state& line, match_builder& builder) = 0;
     virtual void    get_word_break_info(const line_state& line, word_break_info& info) const = 0;
     virtual bool    match_display_filter(char** matches, match_display_filter_entry*** filtered_matches, bool popup) { return false; }
 
+    // Generators that can run concurrently on a worker thread return true and
+    // set 'task' to run there in place of generate().  This is called on the
+    // calling thread, so any shared state (Lua, Readline, settings, the
+    // environment, the current directory, etc) is read here and captured by
+    // the task, which mustn't touch it; other generators may be running on the
+    // calling thread at the same time.  The line state outlives the task.
+    // Long running tasks should poll match_builder::is_cancelled().
+    virtual bool    get_parallel_task(const line_state& line, parallel_task& task) { return false; }
+
 private:
 };
 
 match_generator& file_match_generator();
+
+// When files.async is enabled, starts reading the directory for the line's end
+// word in the background so that a later generate() can use it.  Any previous
+// prefetch for a different directory is cancelled.  Nothing is read for empty
+// lines or for flags, where file completion is unlikely.
+void prefetch_file_matches(const line_state& line);
+void cancel_file_match_prefetch();
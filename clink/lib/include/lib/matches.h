@@ -3,9 +3,12 @@
 
 #pragma once
 
+#include <core/match_wild.h>
 #include <core/str_iter.h>
 #include <assert.h>
 
+#include <atomic>
+
 class str_base;
 
 //------------------------------------------------------------------------------
@@ -93,7 +96,7 @@ private:
     bool                    has_match() const { return m_index < m_next; }
     const matches&          m_matches;
     char*                   m_expanded_pattern;
-    str_iter                m_pattern;
+    path::wild_matcher<char> m_matcher;
     bool                    m_has_pattern = false;
     unsigned int            m_index = 0;
     unsigned int            m_next = 0;
@@ -148,6 +151,7 @@ class match_builder
 {
 public:
                             match_builder(matches& matches);
+                            match_builder(matches& matches, const std::atomic<bool>& cancelled);
     bool                    add_match(const char* match, match_type type);
     bool                    add_match(const match_desc& desc);
     void                    set_append_character(char append);
@@ -156,6 +160,12 @@ public:
 
     void                    set_matches_are_files(bool files=true);
 
+    // True once the matches are no longer wanted, so that a slow generator can
+    // stop early (e.g. one running in parallel behind a generator that's since
+    // returned true).
+    bool                    is_cancelled() const;
+
 private:
     matches&                m_matches;
+    const std::atomic<bool>* m_cancelled;
 };
@@ -0,0 +1,105 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "async_glob.h"
+
+#include <core/globber.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+//------------------------------------------------------------------------------
+struct async_glob::state
+{
+    str_moveable            pattern;
+    std::mutex              mutex;
+    std::condition_variable ready;
+    std::vector<char>       names;
+    std::vector<entry>      entries;
+    std::atomic<bool>       cancelled { false };
+    bool                    done = false;
+};
+
+
+
+//------------------------------------------------------------------------------
+async_glob::async_glob(const char* pattern, bool hidden, bool system)
+: m_state(std::make_shared<state>())
+, m_hidden(hidden)
+, m_system(system)
+{
+    m_state->pattern = pattern;
+
+    // Each enumeration gets a thread of its own rather than a worker_pool one.
+    // The file generator may itself be running on the pool (match.parallel)
+    // and waiting on this, and a cancelled enumeration that's stuck on a slow
+    // share shouldn't hold up anything else.  The thread holds its own
+    // reference to the state so it can finish up after the async_glob's gone.
+    std::shared_ptr<state> s = m_state;
+    std::thread([s, hidden, system] () {
+        globber globber(s->pattern.c_str());
+        globber.hidden(hidden);
+        globber.system(system);
+
+        str<288> name;
+        int st_mode = 0;
+        int attr = 0;
+        while (!s->cancelled && globber.next(name, false, &st_mode, &attr))
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            entry e = { (unsigned int)s->names.size(), st_mode, attr };
+            s->names.insert(s->names.end(), name.c_str(), name.c_str() + name.length() + 1);
+            s->entries.push_back(e);
+
+            // Only a reader that found nothing to take can be waiting.
+            if (s->entries.size() == 1)
+                s->ready.notify_all();
+        }
+
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->done = true;
+        s->ready.notify_all();
+    }).detach();
+}
+
+//------------------------------------------------------------------------------
+async_glob::~async_glob()
+{
+    cancel();
+}
+
+//------------------------------------------------------------------------------
+bool async_glob::is_same(const char* pattern, bool hidden, bool system) const
+{
+    return (m_hidden == hidden && m_system == system && m_state->pattern.equals(pattern));
+}
+
+//------------------------------------------------------------------------------
+void async_glob::cancel()
+{
+    m_state->cancelled = true;
+}
+
+//------------------------------------------------------------------------------
+// Swaps out the entries read so far, waiting for at least one if none are
+// ready yet.  Returns false once every entry has been taken.
+bool async_glob::take(std::vector<char>& names, std::vector<entry>& entries)
+{
+    names.clear();
+    entries.clear();
+
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+    m_state->ready.wait(lock, [this] () {
+        return m_state->done || !m_state->entries.empty();
+    });
+
+    if (m_state->entries.empty())
+        return false;
+
+    names.swap(m_state->names);
+    entries.swap(m_state->entries);
+    return true;
+}
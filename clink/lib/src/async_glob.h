@@ -0,0 +1,39 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/base.h>
+#include <core/str.h>
+
+#include <memory>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Enumerates a glob pattern on a thread of its own.  Entries can be taken as
+// soon as they're read, so the first of them can be used while the rest of a
+// large or slow directory is still being enumerated.  Cancelling or destroying
+// an async_glob stops the enumeration at the next entry.
+class async_glob
+    : public no_copy
+{
+public:
+    struct entry
+    {
+        unsigned int    name;       // Offset of the name in the names buffer.
+        int             st_mode;
+        int             attr;
+    };
+
+                        async_glob(const char* pattern, bool hidden, bool system);
+                        ~async_glob();
+    bool                is_same(const char* pattern, bool hidden, bool system) const;
+    void                cancel();
+    bool                take(std::vector<char>& names, std::vector<entry>& entries);
+
+private:
+    struct state;
+    std::shared_ptr<state> m_state;
+    bool                m_hidden;
+    bool                m_system;
+};
@@ -12,16 +12,15 @@
 #include <new>
 
 //------------------------------------------------------------------------------
-bind_resolver::binding::binding(bind_resolver* resolver, int node_index)
+bind_resolver::binding::binding(bind_resolver* resolver, unsigned int bind_index)
 : m_outer(resolver)
-, m_node_index(node_index)
 {
     const binder& binder = m_outer->m_binder;
-    const auto& node = binder.get_node(m_node_index);
+    const auto& bind = binder.m_binds[bind_index];
 
-    m_module = node.module;
-    m_depth = max<unsigned char>(1, node.depth);
-    m_id = node.id;
+    m_module = bind.module;
+    m_depth = max<unsigned char>(1, bind.depth);
+    m_id = bind.id;
 }
 
 //------------------------------------------------------------------------------
@@ -71,20 +70,19 @@ void bind_resolver::binding::claim()
 //------------------------------------------------------------------------------
 bind_resolver::bind_resolver(const binder& binder)
 : m_binder(binder)
+, m_node_index(0)
 {
+    set_node(binder.get_root(m_group));
 }
 
 //------------------------------------------------------------------------------
 void bind_resolver::set_group(int group)
 {
-    if (unsigned(group) - 1 >= sizeof_array(m_binder.m_nodes) - 1)
-        return;
-
-    if (m_group == group || !m_binder.get_node(group - 1).is_group)
+    if (m_group == group || !m_binder.get_root(group))
         return;
 
     m_group = group;
-    m_node_index = group;
+    set_node(m_binder.get_root(group));
     m_pending_input = true;
 }
 
@@ -102,7 +100,13 @@ void bind_resolver::reset()
     new (this) bind_resolver(m_binder);
 
     m_group = group;
-    m_node_index = m_group;
+    set_node(m_binder.get_root(m_group));
+}
+
+//------------------------------------------------------------------------------
+bool bind_resolver::is_resolving() const
+{
+    return (m_key_count != 0);
 }
 
 //------------------------------------------------------------------------------
@@ -123,12 +127,12 @@ bool bind_resolver::step(unsigned char key)
 //------------------------------------------------------------------------------
 bool bind_resolver::step_impl(unsigned char key)
 {
-    int next = m_binder.find_child(m_node_index, key);
+    unsigned int next = m_binder.find_child(m_node_index, key);
     if (!next)
         return true;
 
-    m_node_index = next;
-    return (m_binder.get_node(next).child == 0);
+    set_node(next);
+    return !m_binder.has_children(next);
 }
 
 //------------------------------------------------------------------------------
@@ -151,20 +155,17 @@ bind_resolver::binding bind_resolver::next()
                 break;
     }
 
-    // Go along this depth's nodes looking for valid binds.
+    // Walk back up the tree from the deepest node the input reached, offering
+    // each node's binds in turn; longer chords win over shorter ones.
     while (m_node_index)
     {
-        const binder::node& node = m_binder.get_node(m_node_index);
-
-        // Move iteration along to the next node.
-        int node_index = m_node_index;
-        m_node_index = node.next;
+        if (unsigned int bind_index = m_bind_index)
+        {
+            m_bind_index = m_binder.m_binds[bind_index].next;
+            return binding(this, bind_index);
+        }
 
-        // Check to see if where we're currently at a node in the tree that is
-        // a valid bind (at the point of call).
-        int key_index = m_tail + node.depth - 1;
-        if (node.bound && (!node.key || node.key == m_keys[key_index]))
-            return binding(this, node_index);
+        set_node(m_binder.m_nodes[m_node_index].parent);
     }
 
     // We can't get any further traversing the tree with the input provided.
@@ -184,9 +185,16 @@ void bind_resolver::claim(binding& binding)
     if (binding)
     {
         m_tail += binding.m_depth;
-        m_node_index = m_group;
+        set_node(m_binder.get_root(m_group));
         m_pending_input = true;
 
         binding.m_outer = nullptr;
     }
 }
+
+//------------------------------------------------------------------------------
+void bind_resolver::set_node(unsigned int node_index)
+{
+    m_node_index = node_index;
+    m_bind_index = m_binder.m_nodes[node_index].binds;
+}
@@ -23,9 +23,8 @@ public:
     private:
         friend class    bind_resolver;
                         binding() = default;
-                        binding(bind_resolver* resolver, int node_index);
+                        binding(bind_resolver* resolver, unsigned int bind_index);
         bind_resolver*  m_outer = nullptr;
-        unsigned short  m_node_index;
         unsigned char   m_module;
         unsigned char   m_depth;
         unsigned char   m_id;
@@ -37,14 +36,17 @@ public:
     bool                step(unsigned char key);
     binding             next();
     void                reset();
+    bool                is_resolving() const;
 
     bool                is_bound(const char* seq, int len) const;
 
 private:
     void                claim(binding& binding);
     bool                step_impl(unsigned char key);
+    void                set_node(unsigned int node_index);
     const binder&       m_binder;
-    unsigned short      m_node_index = 1;
+    unsigned int        m_node_index;
+    unsigned int        m_bind_index;
     unsigned short      m_group = 1;
     bool                m_pending_input = false;
     unsigned char       m_tail = 0;
@@ -101,31 +101,26 @@ template <int SIZE> static bool translate_chord(const char* chord, char (&out)[S
 //------------------------------------------------------------------------------
 binder::binder()
 {
-    // Initialise the default group.
-    m_nodes[0] = { 1 };
-    m_nodes[1] = { 0 };
-    m_next_node = 2;
+    // Index zero is "none" for nodes and binds.
+    m_nodes.push_back({});
+    m_binds.push_back({});
 
-    static_assert(sizeof(node) == sizeof(group_node), "Size assumption");
+    // Create the default group.
+    m_groups.push_back({ 0, add_node(0, true) });
 }
 
 //------------------------------------------------------------------------------
-int binder::get_group(const char* name)
+int binder::get_group(const char* name) const
 {
     if (name == nullptr || name[0] == '\0')
         return 1;
 
     unsigned int hash = str_hash(name);
 
-    int index = get_group_node(0)->next;
-    while (index)
-    {
-        const group_node* node = get_group_node(index);
-        if (*(int*)(node->hash) == hash)
-            return index + 1;
-
-        index = node->next;
-    }
+    // Newest first, so a recreated group shadows the old one.
+    for (int i = int(m_groups.size()) - 1; i > 0; --i)
+        if (m_groups[i].hash == hash)
+            return i + 1;
 
     return -1;
 }
@@ -136,24 +131,15 @@ int binder::create_group(const char* name)
     if (name == nullptr || name[0] == '\0')
         return -1;
 
-    int index = alloc_nodes(2);
-    if (index < 0)
+    if (m_groups.size() >= max_groups)
         return -1;
 
-    // Create a new group node;
-    group_node* group = get_group_node(index);
-    *(int*)(group->hash) = str_hash(name);
-    group->is_group = 1;
-
-    // Link the new node into the front of the list.
-    group_node* master = get_group_node(0);
-    group->next = master->next;
-    master->next = index;
+    unsigned int root = add_node(0, true);
+    if (!root)
+        return -1;
 
-    // Next node along is the group's root.
-    ++index;
-    m_nodes[index] = {};
-    return index;
+    m_groups.push_back({ str_hash(name), root });
+    return int(m_groups.size());
 }
 
 //------------------------------------------------------------------------------
@@ -164,7 +150,8 @@ bool binder::bind(
     unsigned char id)
 {
     // Validate input
-    if (group >= sizeof_array(m_nodes))
+    unsigned int head = get_root(group);
+    if (!head)
         return false;
 
     // Translate from ASCII representation to actual keys.
@@ -180,191 +167,176 @@ bool binder::bind(
     if (module_index < 0)
         return false;
 
-    // Add the chord of keys into the node graph.
-    int depth = 0;
-    int head = group;
-    for (; len; ++chord, ++depth, --len)
+    // Add the chord of keys into the trie.
+    for (; len; ++chord, --len)
         if (!(head = insert_child(head, *chord)))
             return false;
 
-    --chord;
-
-    // If the insert point is already bound we'll duplicate the node at the end
-    // of the list. Also check if this is a duplicate of the existing bind.
-    node* bindee = m_nodes + head;
-    if (bindee->bound)
+    // A chord can be bound more than once (by different modules, say), in
+    // which case the bindings are tried in the order they were added.
+    unsigned int* tail = &m_nodes[head].binds;
+    for (; *tail; tail = &m_binds[*tail].next)
     {
-        int check = head;
-        while (check > head)
-        {
-            if (bindee->key == *chord && bindee->module == module_index && bindee->id == id)
-                return true;
-
-            check = bindee->next;
-            bindee = m_nodes + check;
-        }
-
-        head = append(head, *chord);
+        const bind_info& existing = m_binds[*tail];
+        if (existing.module == module_index && existing.id == id)
+            return true;
     }
 
-    if (!head)
-        return false;
-
-    bindee = m_nodes + head;
-    bindee->module = module_index;
-    bindee->bound = 1;
-    bindee->depth = depth;
-    bindee->id = id;
+    bind_info addee = {};
+    addee.depth = m_nodes[head].depth;
+    addee.module = module_index;
+    addee.id = id;
 
+    *tail = (unsigned int)m_binds.size();
+    m_binds.push_back(addee);
     return true;
 }
 
 //------------------------------------------------------------------------------
 bool binder::is_bound(unsigned int group, const char* seq, int len) const
 {
-    unsigned int node_index = group;
+    unsigned int node_index = get_root(group);
+    if (!node_index)
+        return false;
 
     while (len--)
     {
-        int next = find_child(node_index, *(seq++));
+        unsigned int next = find_child(node_index, *(seq++));
         if (!next)
             return false;
         node_index = next;
         if (!len)
-            return (get_node(next).child == 0);
+            return !has_children(next);
     }
 
     return false;
 }
 
 //------------------------------------------------------------------------------
-int binder::insert_child(int parent, unsigned char key)
+unsigned int binder::get_root(unsigned int group) const
 {
-    if (int child = find_child(parent, key))
-        return child;
+    if (group - 1 >= m_groups.size())
+        return 0;
 
-    return add_child(parent, key);
+    return m_groups[group - 1].root;
 }
 
 //------------------------------------------------------------------------------
-int binder::find_child(int parent, unsigned char key) const
+unsigned int binder::insert_child(unsigned int parent, unsigned char key)
 {
-    const node* node = m_nodes + parent;
-
-    int index = node->child;
-    for (; index > parent; index = node->next)
-    {
-        node = m_nodes + index;
-        if (node->key == key)
-            return index;
-    }
-
-    return 0;
-}
+    if (unsigned int child = find_child(parent, key))
+        return child;
 
-//------------------------------------------------------------------------------
-int binder::add_child(int parent, unsigned char key)
-{
-    int child = alloc_nodes();
-    if (child < 0)
+    unsigned int child = add_node(parent, false);
+    if (!child)
         return 0;
 
-    node addee = {};
-    addee.key = key;
+    node& parent_node = m_nodes[parent];
+    if (parent_node.direct)
+    {
+        m_edges[parent_node.edges + key].node = child;
+        return child;
+    }
 
-    int current_child = m_nodes[parent].child;
-    if (current_child < parent)
+    // Keep the children sorted by key.  Children are only added while binding,
+    // so rather than leave room to grow, a full array's moved to the end of
+    // m_edges (unless it's already there) and the hole it leaves is wasted.
+    unsigned int count = parent_node.edge_count;
+    unsigned int first = parent_node.edges;
+    if (count && first + count != m_edges.size())
     {
-        addee.next = parent;
-        m_nodes[parent].child = child;
+        // Inserting a range of m_edges into itself is undefined, so grow it
+        // first and copy the children into the new space.
+        unsigned int moved = (unsigned int)m_edges.size();
+        m_edges.resize(moved + count);
+        std::copy(m_edges.begin() + first, m_edges.begin() + first + count, m_edges.begin() + moved);
+        first = moved;
     }
-    else
+    else if (!count)
     {
-        int tail = find_tail(current_child);
-        addee.next = parent;
-        m_nodes[tail].next = child;
+        first = (unsigned int)m_edges.size();
     }
 
-    m_nodes[child] = addee;
-    return child;
-}
-
-//------------------------------------------------------------------------------
-int binder::find_tail(int head)
-{
-    while (m_nodes[head].next > head)
-        head = m_nodes[head].next;
-
-    return head;
-}
+    unsigned int insert_at = first;
+    while (insert_at < first + count && m_edges[insert_at].key < key)
+        ++insert_at;
 
-//------------------------------------------------------------------------------
-int binder::append(int head, unsigned char key)
-{
-    int index = alloc_nodes();
-    if (index < 0)
-        return 0;
-
-    int tail = find_tail(head);
-
-    node addee = {};
+    edge addee;
     addee.key = key;
-    addee.next = m_nodes[tail].next;
-    m_nodes[tail].next = index;
+    addee.node = child;
+    m_edges.insert(m_edges.begin() + insert_at, addee);
 
-    m_nodes[index] = addee;
-    return index;
+    parent_node.edges = first;
+    parent_node.edge_count = count + 1;
+    return child;
 }
 
 //------------------------------------------------------------------------------
-const binder::node& binder::get_node(unsigned int index) const
+unsigned int binder::find_child(unsigned int parent, unsigned char key) const
 {
-    if (index < sizeof_array(m_nodes))
-        return m_nodes[index];
+    const node& node = m_nodes[parent];
+    if (node.direct)
+        return m_edges[node.edges + key].node;
+
+    // Binary search the sorted children.
+    const edge* edges = m_edges.data() + node.edges;
+    unsigned int lo = 0;
+    unsigned int hi = node.edge_count;
+    while (lo < hi)
+    {
+        unsigned int mid = (lo + hi) >> 1;
+        if (edges[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
 
-    static const node zero = {};
-    return zero;
+    return (lo < node.edge_count && edges[lo].key == key) ? edges[lo].node : 0;
 }
 
 //------------------------------------------------------------------------------
-binder::group_node* binder::get_group_node(unsigned int index)
+bool binder::has_children(unsigned int index) const
 {
-    if (index < sizeof_array(m_nodes))
-        return (group_node*)(m_nodes + index);
-
-    return nullptr;
+    const node& node = m_nodes[index];
+    return node.direct || node.edge_count;
 }
 
 //------------------------------------------------------------------------------
-int binder::alloc_nodes(unsigned int count)
+unsigned int binder::add_node(unsigned int parent, bool direct)
 {
-    int next = m_next_node + count;
-    if (next > sizeof_array(m_nodes))
-        return -1;
+    if (m_nodes.size() >= max_nodes)
+        return 0;
+
+    node addee = {};
+    addee.parent = parent;
+    addee.depth = parent ? m_nodes[parent].depth + 1 : 0;
+    addee.direct = direct;
+    if (direct)
+    {
+        addee.edges = (unsigned int)m_edges.size();
+        m_edges.resize(m_edges.size() + 256, edge());
+    }
 
-    m_next_node = next;
-    return m_next_node - count;
+    m_nodes.push_back(addee);
+    return (unsigned int)m_nodes.size() - 1;
 }
 
 //------------------------------------------------------------------------------
 int binder::add_module(editor_module& module)
 {
-    for (int i = 0, n = m_modules.size(); i < n; ++i)
-        if (*(m_modules[i]) == &module)
+    for (int i = 0, n = int(m_modules.size()); i < n; ++i)
+        if (m_modules[i] == &module)
             return i;
 
-    if (editor_module** slot = m_modules.push_back())
-    {
-        *slot = &module;
-        return int(slot - m_modules.front());
-    }
+    if (m_modules.size() >= max_modules)
+        return -1;
 
-    return -1;
+    m_modules.push_back(&module);
+    return int(m_modules.size()) - 1;
 }
 
 //------------------------------------------------------------------------------
 editor_module* binder::get_module(unsigned int index) const
 {
-    auto b = m_modules[index];
-    return b ? *b : nullptr;
+    return (index < m_modules.size()) ? m_modules[index] : nullptr;
 }
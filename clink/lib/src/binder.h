@@ -3,61 +3,70 @@
 
 #pragma once
 
-#include <core/array.h>
+#include <vector>
 
 class editor_module;
 
 //------------------------------------------------------------------------------
+// Bindings are kept in a trie.  Each group's root indexes its first key
+// directly, and deeper nodes keep their children in compact arrays sorted by
+// key, so resolving a key is a table lookup or a short search.  Everything
+// grows as needed.
 class binder
 {
 public:
                         binder();
-    int                 get_group(const char* name=nullptr);
+    int                 get_group(const char* name=nullptr) const;
     int                 create_group(const char* name);
     bool                bind(unsigned int group, const char* chord, editor_module& module, unsigned char id);
     bool                is_bound(unsigned int group, const char* seq, int len) const;
 
 private:
-    static const int    link_bits = 9;
-    static const int    module_bits = 6;
+    static const unsigned int max_modules = 256;
+    static const unsigned int max_groups = 0xffff;
+    static const unsigned int max_nodes = 1 << 24;
 
-    struct node
+    struct edge
     {
-        unsigned short  is_group    : 1;
-        unsigned short  next        : link_bits;
-        unsigned short  module      : module_bits;
+        unsigned int    key         : 8;
+        unsigned int    node        : 24;
+    };
 
-        unsigned short  child       : link_bits;
-        unsigned short  depth       : 4;
-        unsigned short  bound       : 1;
-        unsigned short              : 2;
+    struct node
+    {
+        unsigned int    parent;
+        unsigned int    edges;          // Offset of the children in m_edges.
+        unsigned short  edge_count;
+        unsigned char   depth;
+        unsigned char   direct;         // Children indexed by key (group roots).
+        unsigned int    binds;          // First in m_binds, or 0.
+    };
 
-        unsigned char   key;
+    struct bind_info
+    {
+        unsigned int    next;
+        unsigned char   depth;
+        unsigned char   module;
         unsigned char   id;
     };
 
-    struct group_node
+    struct group_info
     {
-        unsigned short  is_group    : 1;
-        unsigned short  next        : link_bits;
-        unsigned short              : 6;
-        unsigned short  hash[2];
+        unsigned int    hash;
+        unsigned int    root;
     };
 
-    typedef fixed_array<editor_module*, (1 << module_bits)> modules;
-
     friend class        bind_resolver;
-    int                 insert_child(int parent, unsigned char key);
-    int                 find_child(int parent, unsigned char key) const;
-    int                 add_child(int parent, unsigned char key);
-    int                 find_tail(int head);
-    int                 append(int head, unsigned char key);
-    const node&         get_node(unsigned int index) const;
-    group_node*         get_group_node(unsigned int index);
-    int                 alloc_nodes(unsigned int count=1);
+    unsigned int        get_root(unsigned int group) const;
+    unsigned int        insert_child(unsigned int parent, unsigned char key);
+    unsigned int        find_child(unsigned int parent, unsigned char key) const;
+    bool                has_children(unsigned int index) const;
+    unsigned int        add_node(unsigned int parent, bool direct);
     int                 add_module(editor_module& module);
     editor_module*      get_module(unsigned int index) const;
-    modules             m_modules;
-    node                m_nodes[1 << link_bits];
-    unsigned int        m_next_node;
+    std::vector<editor_module*> m_modules;
+    std::vector<group_info> m_groups;
+    std::vector<node>   m_nodes;
+    std::vector<edge>   m_edges;
+    std::vector<bind_info> m_binds;
 };
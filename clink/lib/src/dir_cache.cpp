@@ -0,0 +1,216 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "dir_cache.h"
+
+#include <core/os.h>
+
+//------------------------------------------------------------------------------
+// Some file systems only store modified times to two seconds, so a directory
+// that changed more recently than that could change again without its time
+// changing.
+static const unsigned long long c_min_stamp_age = 2 * 10000000ull;
+
+//------------------------------------------------------------------------------
+class modified_time_validator
+    : public dir_cache::validator
+{
+public:
+    virtual bool get_stamp(const char* dir, unsigned long long& stamp) override
+    {
+        if (!os::get_modified_time(dir, stamp))
+            return false;
+
+        unsigned long long now = os::get_current_time();
+        return (now > stamp && now - stamp >= c_min_stamp_age);
+    }
+};
+
+static modified_time_validator s_default_validator;
+
+
+
+//------------------------------------------------------------------------------
+size_t dir_listing::get_bytes() const
+{
+    return sizeof(*this) + names.capacity() + (entries.capacity() * sizeof(entries[0]));
+}
+
+
+
+//------------------------------------------------------------------------------
+dir_cache& dir_cache::get()
+{
+    static dir_cache s_cache;
+    return s_cache;
+}
+
+//------------------------------------------------------------------------------
+dir_cache::dir_cache()
+: m_validator(&s_default_validator)
+, m_budget(8 << 20)
+, m_bytes(0)
+, m_tick(0)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+//------------------------------------------------------------------------------
+void dir_cache::set_validator(validator* validator)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_validator = validator ? validator : &s_default_validator;
+
+    // Stamps from different validators can't be compared.
+    while (!m_slots.empty())
+        remove_slot(int(m_slots.size() - 1));
+}
+
+//------------------------------------------------------------------------------
+void dir_cache::set_budget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    trim(m_budget);
+}
+
+//------------------------------------------------------------------------------
+void dir_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (!m_slots.empty())
+        remove_slot(int(m_slots.size() - 1));
+}
+
+//------------------------------------------------------------------------------
+void dir_cache::get_stats(stats& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out = m_stats;
+    out.listings = (unsigned int)m_slots.size();
+    out.bytes = m_bytes;
+}
+
+//------------------------------------------------------------------------------
+void dir_cache::reset_stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+//------------------------------------------------------------------------------
+// The stamp should be taken before reading a directory, so that changes made
+// while it's being read make the listing stale.
+bool dir_cache::get_stamp(const char* dir, unsigned long long& stamp)
+{
+    validator* validator;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        validator = m_validator;
+    }
+
+    return validator->get_stamp(dir, stamp);
+}
+
+//------------------------------------------------------------------------------
+// Like find(), but without counting a hit or a miss.
+bool dir_cache::contains(const char* dir, unsigned int flags)
+{
+    unsigned long long stamp;
+    if (!get_stamp(dir, stamp))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int i = find_slot(dir, flags);
+    return (i >= 0 && m_slots[i].stamp == stamp);
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<const dir_listing> dir_cache::find(const char* dir, unsigned int flags)
+{
+    unsigned long long stamp;
+    bool stamped = get_stamp(dir, stamp);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    int i = find_slot(dir, flags);
+    if (i < 0)
+    {
+        m_stats.misses++;
+        return nullptr;
+    }
+
+    if (!stamped || m_slots[i].stamp != stamp)
+    {
+        remove_slot(i);
+        m_stats.stale++;
+        m_stats.misses++;
+        return nullptr;
+    }
+
+    m_slots[i].last_used = ++m_tick;
+    m_stats.hits++;
+    return m_slots[i].listing;
+}
+
+//------------------------------------------------------------------------------
+void dir_cache::store(const char* dir, unsigned int flags, unsigned long long stamp, std::shared_ptr<const dir_listing> listing)
+{
+    size_t bytes = listing->get_bytes();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    int i = find_slot(dir, flags);
+    if (i >= 0)
+        remove_slot(i);
+
+    // Listings bigger than the whole budget would only evict everything else.
+    if (bytes > m_budget)
+        return;
+
+    trim(m_budget - bytes);
+
+    m_slots.emplace_back();
+    slot& s = m_slots.back();
+    s.dir = dir;
+    s.flags = flags;
+    s.stamp = stamp;
+    s.last_used = ++m_tick;
+    s.listing = std::move(listing);
+    m_bytes += bytes;
+}
+
+//------------------------------------------------------------------------------
+int dir_cache::find_slot(const char* dir, unsigned int flags) const
+{
+    for (int i = 0, n = int(m_slots.size()); i < n; ++i)
+        if (m_slots[i].flags == flags && stricmp(m_slots[i].dir.c_str(), dir) == 0)
+            return i;
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+void dir_cache::remove_slot(int index)
+{
+    m_bytes -= m_slots[index].listing->get_bytes();
+    if (index != int(m_slots.size() - 1))
+        m_slots[index] = std::move(m_slots.back());
+    m_slots.pop_back();
+}
+
+//------------------------------------------------------------------------------
+void dir_cache::trim(size_t budget)
+{
+    while (m_bytes > budget && !m_slots.empty())
+    {
+        int oldest = 0;
+        for (int i = 1, n = int(m_slots.size()); i < n; ++i)
+            if (m_slots[i].last_used < m_slots[oldest].last_used)
+                oldest = i;
+
+        remove_slot(oldest);
+        m_stats.evictions++;
+    }
+}
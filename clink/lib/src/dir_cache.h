@@ -0,0 +1,85 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "async_glob.h"
+
+#include <core/base.h>
+#include <core/str.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//------------------------------------------------------------------------------
+struct dir_listing
+{
+    size_t                          get_bytes() const;
+    std::vector<char>               names;
+    std::vector<async_glob::entry>  entries;
+};
+
+//------------------------------------------------------------------------------
+// Remembers the entries of recently listed directories, so that completing in
+// the same directory again doesn't have to enumerate it again.  A listing is
+// only used while its directory's stamp (its modified time, by default) is the
+// same as when it was read.  Least recently used listings are dropped once the
+// listings exceed the memory budget.
+class dir_cache
+    : public no_copy
+{
+public:
+    struct stats
+    {
+        unsigned int    hits;
+        unsigned int    misses;
+        unsigned int    stale;          // Misses due to a changed directory.
+        unsigned int    evictions;
+        unsigned int    listings;
+        size_t          bytes;
+    };
+
+    class validator
+    {
+    public:
+        virtual         ~validator() = default;
+
+        // Returns a value that changes whenever DIR's entries change, or false
+        // if DIR's entries can't be trusted to stay the same.
+        virtual bool    get_stamp(const char* dir, unsigned long long& stamp) = 0;
+    };
+
+    static dir_cache&   get();
+                        dir_cache();
+    void                set_validator(validator* validator);
+    void                set_budget(size_t bytes);
+    void                clear();
+    void                get_stats(stats& out) const;
+    void                reset_stats();
+    bool                get_stamp(const char* dir, unsigned long long& stamp);
+    bool                contains(const char* dir, unsigned int flags);
+    std::shared_ptr<const dir_listing> find(const char* dir, unsigned int flags);
+    void                store(const char* dir, unsigned int flags, unsigned long long stamp, std::shared_ptr<const dir_listing> listing);
+
+private:
+    struct slot
+    {
+        str_moveable    dir;
+        unsigned int    flags;
+        unsigned long long stamp;
+        unsigned int    last_used;
+        std::shared_ptr<const dir_listing> listing;
+    };
+
+    int                 find_slot(const char* dir, unsigned int flags) const;
+    void                remove_slot(int index);
+    void                trim(size_t budget);
+    mutable std::mutex  m_mutex;
+    std::vector<slot>   m_slots;
+    validator*          m_validator;
+    size_t              m_budget;
+    size_t              m_bytes;
+    unsigned int        m_tick;
+    stats               m_stats;
+};
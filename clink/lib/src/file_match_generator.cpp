@@ -3,15 +3,21 @@
 
 #include "pch.h"
 #include "match_generator.h"
+#include "async_glob.h"
+#include "dir_cache.h"
 #include "line_state.h"
 #include "matches.h"
 
 #include <core/base.h>
 #include <core/globber.h>
+#include <core/os.h>
 #include <core/path.h>
 #include <core/settings.h>
 #include <readline/readline.h>
 
+#include <memory>
+#include <mutex>
+
 setting_bool g_glob_hidden(
     "files.hidden",
     "Include hidden files",
@@ -26,55 +32,303 @@ setting_bool g_glob_system(
     "file lists.",
     false);
 
+setting_bool g_glob_async(
+    "files.async",
+    "Read directories in the background",
+    "When enabled, the directory for the word being edited is read ahead on a\n"
+    "background thread while typing, rather than when completion is requested.\n"
+    "Completion still waits for the whole listing, but most of it is usually\n"
+    "read by then, which helps with large directories and network shares.",
+    false);
+
+
+
+setting_bool g_dir_cache(
+    "files.cache",
+    "Cache directory listings",
+    "When enabled, directory listings are remembered so that completing in the\n"
+    "same directory again doesn't need to read it again.  A listing is only\n"
+    "reused while the directory's modified time hasn't changed.",
+    false);
+
+setting_int g_dir_cache_size(
+    "files.cache_size",
+    "Directory cache size (KB)",
+    "The most memory that cached directory listings may use.  The least\n"
+    "recently used listings are dropped to stay within this limit.",
+    8192);
+
 
 
 //------------------------------------------------------------------------------
-static class : public match_generator
+struct prefetch
 {
-    virtual bool generate(const line_state& line, match_builder& builder) override
+    std::unique_ptr<async_glob> glob;
+    unsigned long long  stamp = 0;
+    bool                stamped = false;
+};
+
+static std::mutex s_prefetch_mutex;
+static prefetch s_prefetch;
+
+//------------------------------------------------------------------------------
+static bool get_glob_pattern(const line_state& line, str_base& pattern)
+{
+    line.get_end_word(pattern);
+
+    bool expanded_tilde;
+    {
+        char* expanded_root = tilde_expand(pattern.c_str());
+        expanded_tilde = (expanded_root && strcmp(expanded_root, pattern.c_str()) != 0);
+        if (expanded_tilde)
+            pattern = expanded_root;
+        free(expanded_root);
+    }
+
+    path::normalise_separators(pattern);
+
+    pattern << "*";
+    return expanded_tilde;
+}
+
+//------------------------------------------------------------------------------
+// Gets the absolute directory that PATTERN enumerates.
+static bool get_absolute_dir(const char* pattern, str_base& out)
+{
+    str<288> dir;
+    path::get_directory(pattern, dir);
+
+    // Drive relative paths (e.g. 'c:foo') depend on each drive's current
+    // directory, so they're left alone.
+    if (dir.length() >= 2 && dir[1] == ':' && !path::is_rooted(dir.c_str()))
+        return false;
+
+    out.clear();
+    if (!path::is_rooted(dir.c_str()))
+    {
+        os::get_current_dir(out);
+        path::append(out, dir.c_str());
+    }
+    else if (dir[1] != ':' && !path::is_separator(dir[1]))
+    {
+        str<288> cwd;
+        os::get_current_dir(cwd);
+        path::get_drive(cwd.c_str(), out);
+        out << dir;
+    }
+    else
+        out << dir;
+
+    path::normalise(out);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Gets the absolute directory that PATTERN enumerates, to identify its listing
+// in the directory cache.
+static bool get_cache_dir(const char* pattern, str_base& out)
+{
+    if (!g_dir_cache.get())
+        return false;
+
+    // Only a pattern that lists everything in the directory can stand in for
+    // it.  Word break rules can leave part of a name in the end word (e.g.
+    // '-flag:dir\ab' globs 'dir\ab*'), and that listing mustn't be cached.
+    if (strcmp(path::get_name(pattern), "*") != 0)
+        return false;
+
+    return get_absolute_dir(pattern, out);
+}
+
+//------------------------------------------------------------------------------
+static unsigned int get_cache_flags(bool hidden, bool system)
+{
+    return (hidden ? 1 : 0) | (system ? 2 : 0);
+}
+
+//------------------------------------------------------------------------------
+static async_glob* take_prefetch(const char* pattern, bool hidden, bool system, unsigned long long& stamp, bool& stamped)
+{
+    std::lock_guard<std::mutex> lock(s_prefetch_mutex);
+    if (s_prefetch.glob && !s_prefetch.glob->is_same(pattern, hidden, system))
+        s_prefetch.glob.reset();
+    stamp = s_prefetch.stamp;
+    stamped = s_prefetch.stamped;
+    return s_prefetch.glob.release();
+}
+
+//------------------------------------------------------------------------------
+// What a file completion reads from shared state (the line, settings, the
+// environment and the current directory), so that the directory can then be
+// read on any thread.
+struct glob_request
+{
+    str_moveable        pattern;        // As typed, to find a prefetch.
+    str_moveable        glob_pattern;   // Rooted, unless it's drive relative.
+    str_moveable        root;           // What prefixes each match.
+    str_moveable        cache_dir;
+    unsigned int        cache_flags;
+    bool                hidden;
+    bool                system;
+    bool                async;
+    bool                cacheable;
+    bool                rooted;
+};
+
+//------------------------------------------------------------------------------
+static void resolve_glob(const line_state& line, glob_request& request)
+{
+    str<288> pattern;
+    bool expanded_tilde = get_glob_pattern(line, pattern);
+    request.pattern = pattern.c_str();
+
+    request.hidden = g_glob_hidden.get();
+    request.system = g_glob_system.get();
+    request.async = g_glob_async.get();
+    request.cache_flags = get_cache_flags(request.hidden, request.system);
+
+    str<288> dir;
+    request.rooted = get_absolute_dir(pattern.c_str(), dir);
+    request.cacheable = get_cache_dir(pattern.c_str(), request.cache_dir);
+    if (request.cacheable)
+        dir_cache::get().set_budget(size_t(max(g_dir_cache_size.get(), 0)) << 10);
+
+    if (request.rooted)
+    {
+        path::append(dir, path::get_name(pattern.c_str()));
+        request.glob_pattern = dir.c_str();
+    }
+    else
+        request.glob_pattern = pattern.c_str();
+
+    str<288> root;
+    path::get_directory(pattern.c_str(), root);
+    if (expanded_tilde)
     {
-        str<288> root;
-        line.get_end_word(root);
+        extern bool collapse_tilde(const char* in, str_base& out, bool force);
+        str<288> collapsed;
+        if (collapse_tilde(root.c_str(), collapsed, false))
+            root = collapsed.c_str();
+    }
+    request.root = root.c_str();
+}
+
+//------------------------------------------------------------------------------
+static bool glob_matches(const glob_request& request, match_builder& builder)
+{
+    std::shared_ptr<const dir_listing> cached;
+    if (request.cacheable)
+        cached = dir_cache::get().find(request.cache_dir.c_str(), request.cache_flags);
+
+    unsigned long long stamp = 0;
+    bool stamped = false;
+    std::unique_ptr<async_glob> glob;
+    if (!cached)
+    {
+        glob.reset(take_prefetch(request.pattern.c_str(), request.hidden, request.system, stamp, stamped));
 
-        bool expanded_tilde;
+        // The stamp is taken before reading the directory, so that changes
+        // made while it's read make the listing stale.
+        if (!glob)
         {
-            char* expanded_root = tilde_expand(root.c_str());
-            expanded_tilde = (expanded_root && strcmp(expanded_root, root.c_str()) != 0);
-            if (expanded_tilde)
-                root = expanded_root;
-            free(expanded_root);
+            stamped = (request.cacheable && dir_cache::get().get_stamp(request.cache_dir.c_str(), stamp));
+            if (request.async)
+                glob.reset(new async_glob(request.glob_pattern.c_str(), request.hidden, request.system));
         }
+    }
+    else
+    {
+        cancel_file_match_prefetch();
+    }
 
-        path::normalise_separators(root);
+    str<288> root;
+    root = request.root.c_str();
+    unsigned int root_len = root.length();
 
-        root << "*";
+    auto add_match = [&] (const char* name, int st_mode, int attr) {
+        root.truncate(root_len);
+        path::append(root, name);
+        builder.add_match(root.c_str(), to_match_type(st_mode, attr));
+    };
 
-        int st_mode = 0;
-        int attr = 0;
-        globber globber(root.c_str());
-        globber.hidden(g_glob_hidden.get());
-        globber.system(g_glob_system.get());
+    if (cached)
+    {
+        for (const auto& entry : cached->entries)
+            add_match(cached->names.data() + entry.name, entry.st_mode, entry.attr);
 
-        path::get_directory(root);
-        unsigned int root_len = root.length();
+        return true;
+    }
 
-        if (expanded_tilde)
+    std::shared_ptr<dir_listing> listing;
+    if (request.cacheable && stamped)
+        listing = std::make_shared<dir_listing>();
+
+    // Matches are added as the background enumeration reads them, so the
+    // first of them don't wait for the rest of the directory.
+    if (glob)
+    {
+        std::vector<char> names;
+        std::vector<async_glob::entry> entries;
+        while (!builder.is_cancelled() && glob->take(names, entries))
         {
-            extern bool collapse_tilde(const char* in, str_base& out, bool force);
-            str<288> collapsed;
-            if (collapse_tilde(root.c_str(), collapsed, false))
-                root = collapsed.c_str();
+            for (const auto& entry : entries)
+                add_match(names.data() + entry.name, entry.st_mode, entry.attr);
+
+            if (listing)
+            {
+                unsigned int base = (unsigned int)listing->names.size();
+                listing->names.insert(listing->names.end(), names.begin(), names.end());
+                for (auto entry : entries)
+                {
+                    entry.name += base;
+                    listing->entries.push_back(entry);
+                }
+            }
         }
+    }
+    else
+    {
+        int st_mode = 0;
+        int attr = 0;
+        globber globber(request.glob_pattern.c_str());
+        globber.hidden(request.hidden);
+        globber.system(request.system);
 
         str<288> buffer;
-        while (globber.next(buffer, false, &st_mode, &attr))
+        while (!builder.is_cancelled() && globber.next(buffer, false, &st_mode, &attr))
         {
-            root.truncate(root_len);
-            path::append(root, buffer.c_str());
-            builder.add_match(root.c_str(), to_match_type(st_mode, attr));
+            add_match(buffer.c_str(), st_mode, attr);
+
+            if (listing)
+            {
+                async_glob::entry entry = { (unsigned int)listing->names.size(), st_mode, attr };
+                listing->names.insert(listing->names.end(), buffer.c_str(), buffer.c_str() + buffer.length() + 1);
+                listing->entries.push_back(entry);
+            }
         }
+    }
 
-        return true;
+    // A cancelled listing is incomplete, so it isn't cached.
+    if (listing && !builder.is_cancelled())
+    {
+        listing->names.shrink_to_fit();
+        listing->entries.shrink_to_fit();
+        dir_cache::get().store(request.cache_dir.c_str(), request.cache_flags, stamp, std::move(listing));
+    }
+
+    return true;
+}
+
+
+
+//------------------------------------------------------------------------------
+static class : public match_generator
+{
+    virtual bool generate(const line_state& line, match_builder& builder) override
+    {
+        glob_request request;
+        resolve_glob(line, request);
+        return glob_matches(request, builder);
     }
 
     virtual void get_word_break_info(const line_state& line, word_break_info& info) const override
@@ -93,6 +347,22 @@ static class : public match_generator
         info.truncate = 0;
         info.keep = int(c - start);
     }
+
+    virtual bool get_parallel_task(const line_state& line, parallel_task& task) override
+    {
+        auto request = std::make_shared<glob_request>();
+        resolve_glob(line, *request);
+
+        // A drive relative directory is only known to the drive's current
+        // directory, which can change while the worker reads it.
+        if (!request->rooted)
+            return false;
+
+        task = [request] (match_builder& builder) {
+            return glob_matches(*request, builder);
+        };
+        return true;
+    }
 } g_file_generator;
 
 
@@ -101,3 +371,75 @@ match_generator& file_match_generator()
 {
     return g_file_generator;
 }
+
+//------------------------------------------------------------------------------
+static bool is_file_completion_plausible(const line_state& line)
+{
+    // A fresh prompt would otherwise read the current directory every time,
+    // whether or not anything gets completed.
+    str_iter end_word = line.get_end_word();
+    if (line.get_word_count() <= 1 && !end_word.length())
+        return false;
+
+    // Neither are flags worth reading ahead for, unless they hold a path.
+    if (end_word.length() && end_word.get_pointer()[0] == '-')
+    {
+        const char* c = end_word.get_pointer();
+        for (int i = end_word.length(); i > 0 && !path::is_separator(*c); --i, ++c);
+        return (c < end_word.get_pointer() + end_word.length());
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void prefetch_file_matches(const line_state& line)
+{
+    if (!g_glob_async.get())
+        return;
+
+    if (!is_file_completion_plausible(line))
+    {
+        cancel_file_match_prefetch();
+        return;
+    }
+
+    str<288> pattern;
+    get_glob_pattern(line, pattern);
+    bool hidden = g_glob_hidden.get();
+    bool system = g_glob_system.get();
+
+    {
+        std::lock_guard<std::mutex> lock(s_prefetch_mutex);
+        if (s_prefetch.glob && s_prefetch.glob->is_same(pattern.c_str(), hidden, system))
+            return;
+    }
+
+    // There's nothing to read ahead if the directory's listing is cached.
+    str<288> cache_dir;
+    unsigned long long stamp = 0;
+    bool stamped = false;
+    if (get_cache_dir(pattern.c_str(), cache_dir))
+    {
+        if (dir_cache::get().contains(cache_dir.c_str(), get_cache_flags(hidden, system)))
+        {
+            cancel_file_match_prefetch();
+            return;
+        }
+
+        stamped = dir_cache::get().get_stamp(cache_dir.c_str(), stamp);
+    }
+
+    std::lock_guard<std::mutex> lock(s_prefetch_mutex);
+    s_prefetch.glob.reset(new async_glob(pattern.c_str(), hidden, system));
+    s_prefetch.stamp = stamp;
+    s_prefetch.stamped = stamped;
+}
+
+//------------------------------------------------------------------------------
+void cancel_file_match_prefetch()
+{
+    std::lock_guard<std::mutex> lock(s_prefetch_mutex);
+    s_prefetch.glob.reset();
+    s_prefetch.stamped = false;
+}
@@ -180,6 +180,27 @@ void line_editor_impl::initialise()
         module->bind_input(binder_impl);
     }
 
+    // Pastes can only bypass the binder if the keys that make up text all fall
+    // through to Readline.
+    m_text_keys_unbound = true;
+    bind_resolver resolver(m_binder);
+    for (int c = ' '; c < 0x100 && m_text_keys_unbound; ++c)
+    {
+        resolver.reset();
+        if (c == 0x7f)
+            continue;
+
+        // A key that starts a longer chord doesn't resolve on its own.
+        if (!resolver.step(c))
+        {
+            m_text_keys_unbound = false;
+            break;
+        }
+
+        auto binding = resolver.next();
+        m_text_keys_unbound = (binding && binding.get_module() == &m_module);
+    }
+
     set_flag(flag_init);
 }
 
@@ -222,6 +243,8 @@ void line_editor_impl::end_line()
 
     rl_before_display_function = nullptr;
 
+    cancel_file_match_prefetch();
+
     m_buffer.end_line();
     m_desc.output->end();
     m_desc.input->end();
@@ -473,6 +496,34 @@ void line_editor_impl::set_keyseq_len(int len)
     m_module.set_keyseq_len(len);
 }
 
+//------------------------------------------------------------------------------
+// A paste can skip key dispatch when each of its characters would only have
+// been self-inserted; nothing's partway through a key sequence or waiting for
+// more input, and nothing other than self-insert is bound to text keys.
+bool line_editor_impl::accepts_paste()
+{
+    if (!check_flag(flag_editing) || m_dispatching || !m_text_keys_unbound)
+        return false;
+
+    if (m_bind_resolver.is_resolving() || m_bind_resolver.get_group() != m_binder.get_group())
+        return false;
+
+    if (RL_ISSTATE(RL_STATE_MULTIKEY|RL_STATE_NUMERICARG|RL_STATE_ISEARCH|simple_input_states))
+        return false;
+
+    if (rl_is_insert_next_callback_pending() || rl_insert_mode != RL_IM_INSERT)
+        return false;
+
+    Keymap keymap = rl_get_keymap();
+    for (int c = ' '; c < 0x100; ++c)
+    {
+        if (c != 0x7f && (keymap[c].type != ISFUNC || keymap[c].function != rl_insert))
+            return false;
+    }
+
+    return true;
+}
+
 //------------------------------------------------------------------------------
 // Returns false when a chord is in progress, otherwise returns true.  This is
 // to help dispatch() be able to dispatch an entire chord.
@@ -497,6 +548,12 @@ bool line_editor_impl::update_input()
         return true;
     }
 
+    if (key == terminal_in::input_paste)
+    {
+        insert_paste(m_desc.input->read_paste());
+        return true;
+    }
+
     if (key < 0)
         return true;
 
@@ -586,6 +643,23 @@ bool line_editor_impl::update_input()
     return true;
 }
 
+//------------------------------------------------------------------------------
+// The whole paste goes in with one insert (and so one undo entry), and the line
+// is classified and drawn once rather than after each character.
+void line_editor_impl::insert_paste(const char* text)
+{
+    if (!*text)
+        return;
+
+    m_buffer.insert(text);
+    rl_last_func = rl_insert;
+
+    if (g_classify_words.get())
+        classify();
+
+    m_buffer.draw();
+}
+
 //------------------------------------------------------------------------------
 void line_editor_impl::collect_words(bool stop_at_cursor)
 {
@@ -948,6 +1022,17 @@ void line_editor_impl::update_internal()
             set_flag(flag_generate);
             m_matches.set_word_break_position(line.get_end_word_offset());
             update_prev_generate = len;
+
+            // Directories can be slow to read, so get a head start on it if
+            // the file generator's going to be asked for matches.
+            for (const auto* generator : m_generators)
+            {
+                if (generator == &file_match_generator())
+                {
+                    prefetch_file_matches(line);
+                    break;
+                }
+            }
         }
     }
 
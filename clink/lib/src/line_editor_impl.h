@@ -61,6 +61,7 @@ public:
     virtual bool        is_bound(const char* seq, int len) override;
     virtual bool        translate(const char* seq, int len, str_base& out) override;
     virtual void        set_keyseq_len(int len) override;
+    virtual bool        accepts_paste() override;
 
 private:
     typedef editor_module                       module;
@@ -99,6 +100,7 @@ private:
     matches*            get_mutable_matches(bool nosort=false);
     void                update_internal();
     bool                update_input();
+    void                insert_paste(const char* text);
     module::context     get_context(const line_state& line) const;
     line_state          get_linestate() const;
     void                set_flag(unsigned char flag);
@@ -130,6 +132,7 @@ private:
     unsigned short      m_command_offset;
     unsigned char       m_keys_size;
     unsigned char       m_flags = 0;
+    bool                m_text_keys_unbound = false;
     str<64>             m_needle;
 
     const char*         m_insert_on_begin = nullptr;
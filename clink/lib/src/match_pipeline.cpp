@@ -7,15 +7,20 @@
 #include "match_generator.h"
 #include "match_pipeline.h"
 #include "matches_impl.h"
+#include "worker_pool.h"
 
 #include <core/array.h>
 #include <core/path.h>
 #include <core/str_compare.h>
+#include <core/str_sort_key.h>
 #include <core/settings.h>
 #include <terminal/ecma48_iter.h>
 #include <readline/readline.h>
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include <assert.h>
 
 //------------------------------------------------------------------------------
@@ -26,6 +31,15 @@ static setting_enum g_sort_dirs(
     "before,with,after",
     1);
 
+static setting_bool g_parallel_generators(
+    "match.parallel",
+    "Run match generators concurrently",
+    "When enabled, match generators that can run in parallel (such as file\n"
+    "completion) are started concurrently on worker threads.  Their matches are\n"
+    "still merged in priority order, so the results are the same as running\n"
+    "the generators one at a time.",
+    false);
+
 
 
 //------------------------------------------------------------------------------
@@ -52,68 +66,83 @@ static unsigned int normal_selector(
         const char* name = infos[i].match;
         int j = str_compare(needle, name);
         infos[i].select = (j < 0 || !needle[j]);
-        ++select_count;
+        select_count += infos[i].select;
     }
 
     return select_count;
 }
 
 //------------------------------------------------------------------------------
-static bool is_dir_match(const wstr_base& match, match_type type)
+static bool is_dir_match(const char* match, int len, match_type type)
 {
     if (is_match_type(type, match_type::dir))
         return true;
     if (!is_match_type(type, match_type::none))
         return false;
-    if (match.empty())
+    if (!len)
         return false;
-    return path::is_separator(match.c_str()[match.length() - 1]);
+    return path::is_separator(match[len - 1]);
 }
 
 //------------------------------------------------------------------------------
-inline bool sort_worker(wstr_base& l, match_type l_type,
-                        wstr_base& r, match_type r_type,
-                        int order)
+// Appends a nul terminated sort key for a match to 'keys'.  The key folds in
+// the directory ordering from match.sort_dirs ahead of the text, and a tie
+// breaker on the match type after it, so that sorting is just strcmp() of
+// the keys.
+static void append_match_sort_key(const char* match, match_type type, int order, std::vector<char>& keys)
 {
-    bool l_dir = is_dir_match(l, l_type);
-    bool r_dir = is_dir_match(r, r_type);
-
-    if (order != 1 && l_dir != r_dir)
-        return (order == 0) ? l_dir : r_dir;
+    int len = int(strlen(match));
+    bool dir = is_dir_match(match, len, type);
 
-    if (l_dir)
-        path::maybe_strip_last_separator(l);
-    if (r_dir)
-        path::maybe_strip_last_separator(r);
+    if (order != 1)
+        keys.push_back((dir == (order == 0)) ? 2 : 3);
 
-    DWORD flags = SORT_DIGITSASNUMBERS|NORM_LINGUISTIC_CASING;
-    if (true/*casefold*/)
-        flags |= LINGUISTIC_IGNORECASE;
-    int cmp = CompareStringW(LOCALE_USER_DEFAULT, flags,
-                            l.c_str(), l.length(),
-                            r.c_str(), r.length());
-    cmp -= CSTR_EQUAL;
-    if (cmp) return (cmp < 0);
+    if (dir && len && path::is_separator(match[len - 1]))
+        --len;
 
-    unsigned char t1 = ((unsigned char)l_type) & MATCH_TYPE_MASK;
-    unsigned char t2 = ((unsigned char)r_type) & MATCH_TYPE_MASK;
+    append_sort_key(match, len, keys);
+    keys.push_back(1);
 
-    cmp = int(t1 == MATCH_TYPE_DIR) - int(t2 == MATCH_TYPE_DIR);
-    if (cmp) return (cmp < 0);
+    unsigned char t = ((unsigned char)type) & MATCH_TYPE_MASK;
+    keys.push_back(char(1 +
+        ((t == MATCH_TYPE_DIR) << 4) +
+        ((t == MATCH_TYPE_ALIAS) << 3) +
+        ((t == MATCH_TYPE_WORD) << 2) +
+        ((t == MATCH_TYPE_ARG) << 1) +
+        ((t == MATCH_TYPE_FILE) << 0)));
 
-    cmp = int(t1 == MATCH_TYPE_ALIAS) - int(t2 == MATCH_TYPE_ALIAS);
-    if (cmp) return (cmp < 0);
+    keys.push_back(0);
+}
 
-    cmp = int(t1 == MATCH_TYPE_WORD) - int(t2 == MATCH_TYPE_WORD);
-    if (cmp) return (cmp < 0);
+//------------------------------------------------------------------------------
+// Sorts 'count' items by building each item's sort key once up front, rather
+// than converting and collating both strings in every comparison.  'get_key'
+// is called once per item and appends the item's key.
+template <typename T, typename GET_KEY>
+static void sort_by_keys(T* items, int count, GET_KEY get_key)
+{
+    struct keyed_item
+    {
+        size_t      offset;
+        T           item;
+    };
 
-    cmp = int(t1 == MATCH_TYPE_ARG) - int(t2 == MATCH_TYPE_ARG);
-    if (cmp) return (cmp < 0);
+    std::vector<char> keys;
+    std::vector<keyed_item> keyed;
+    keyed.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        keyed.push_back({ keys.size(), items[i] });
+        get_key(items[i], keys);
+    }
 
-    cmp = int(t1 == MATCH_TYPE_FILE) - int(t2 == MATCH_TYPE_FILE);
-    if (cmp) return (cmp < 0);
+    const char* base = keys.data();
+    std::sort(keyed.begin(), keyed.end(), [base] (const keyed_item& l, const keyed_item& r) {
+        return strcmp(base + l.offset, base + r.offset) < 0;
+    });
 
-    return (cmp < 0);
+    for (int i = 0; i < count; ++i)
+        items[i] = keyed[i].item;
 }
 
 //------------------------------------------------------------------------------
@@ -122,18 +151,9 @@ inline bool sort_worker(wstr_base& l, match_type l_type,
 static void alpha_sorter(match_info* infos, int count)
 {
     int order = g_sort_dirs.get();
-    wstr<> ltmp;
-    wstr<> rtmp;
-
-    auto predicate = [&] (const match_info& lhs, const match_info& rhs) {
-        ltmp.clear();
-        rtmp.clear();
-        to_utf16(ltmp, lhs.match);
-        to_utf16(rtmp, rhs.match);
-        return sort_worker(ltmp, lhs.type, rtmp, rhs.type, order);
-    };
-
-    std::sort(infos, infos + count, predicate);
+    sort_by_keys(infos, count, [order] (const match_info& info, std::vector<char>& keys) {
+        append_match_sort_key(info.match, info.type, order, keys);
+    });
 }
 #endif
 
@@ -158,22 +178,10 @@ void sort_match_list(char** matches, int len)
     }
 
     int order = g_sort_dirs.get();
-    wstr<> ltmp;
-    wstr<> rtmp;
-
-    auto predicate = [&] (const char* l, const char* r) {
-        match_type l_type = match_type(*(l++));
-        match_type r_type = match_type(*(r++));
-
-        ltmp.clear();
-        rtmp.clear();
-        to_utf16(ltmp, l);
-        to_utf16(rtmp, r);
-
-        return sort_worker(ltmp, l_type, rtmp, r_type, order);
-    };
-
-    std::sort(matches, matches + len, predicate);
+    sort_by_keys(matches, len, [order] (const char* match, std::vector<char>& keys) {
+        match_type type = match_type(*(match++));
+        append_match_sort_key(match, type, order, keys);
+    });
 }
 
 
@@ -204,10 +212,17 @@ void match_pipeline::generate(
 {
     m_matches.set_word_break_position(state.get_end_word_offset());
 
-    match_builder builder(m_matches);
-    for (auto* generator : generators)
-        if (generator->generate(state, builder))
-            break;
+    if (g_parallel_generators.get())
+    {
+        generate_parallel(state, generators);
+    }
+    else
+    {
+        match_builder builder(m_matches);
+        for (auto* generator : generators)
+            if (generator->generate(state, builder))
+                break;
+    }
 
 #ifdef DEBUG
     if (dbg_get_env_int("DEBUG_PIPELINE"))
@@ -231,10 +246,80 @@ void match_pipeline::generate(
 #endif
 }
 
+//------------------------------------------------------------------------------
+void match_pipeline::generate_parallel(
+    const line_state& state,
+    const array<match_generator*>& generators) const
+{
+    struct parallel_slot
+    {
+        matches_impl    matches;
+        completion      done;
+        std::atomic<bool> cancelled { false };
+        bool            ret = false;
+    };
+
+    // Start every generator that has a parallel task up front, each writing
+    // into its own matches.  The tasks and slots are created here on the
+    // calling thread; matches_impl isn't safe to construct concurrently.
+    std::vector<std::unique_ptr<parallel_slot>> slots;
+    slots.reserve(generators.size());
+    for (auto* generator : generators)
+    {
+        parallel_slot* slot = nullptr;
+        match_generator::parallel_task task;
+        if (generator->get_parallel_task(state, task))
+        {
+            slot = new parallel_slot;
+            worker_pool::get().post([task, slot] () {
+                if (!slot->cancelled)
+                {
+                    match_builder builder(slot->matches, slot->cancelled);
+                    slot->ret = task(builder);
+                }
+                slot->done.signal();
+            });
+        }
+        slots.emplace_back(slot);
+    }
+
+    // Walk the generators in priority order, merging the results of parallel
+    // ones and running the rest here, so that the outcome is the same as if
+    // they'd all been run serially.
+    match_builder builder(m_matches);
+    unsigned int i = 0;
+    for (auto* generator : generators)
+    {
+        parallel_slot* slot = slots[i++].get();
+        if (slot)
+        {
+            slot->done.wait();
+            m_matches.merge(slot->matches);
+            if (slot->ret)
+                break;
+        }
+        else if (generator->generate(state, builder))
+        {
+            break;
+        }
+    }
+
+    // Whatever's left is lower priority than a generator that returned true,
+    // so its matches are thrown away.  Cancel it all so queued generators don't
+    // start and running ones can stop early.  They reference the line state and
+    // their slots, so they must still finish before returning.
+    for (unsigned int j = i; j < slots.size(); ++j)
+        if (slots[j])
+            slots[j]->cancelled = true;
+
+    for (; i < slots.size(); ++i)
+        if (slots[i])
+            slots[i]->done.wait();
+}
+
 //------------------------------------------------------------------------------
 void match_pipeline::select(const char* needle) const
 {
-    int count = m_matches.get_info_count();
     unsigned int selected_count = 0;
 
     char* expanded = nullptr;
@@ -249,10 +334,14 @@ void match_pipeline::select(const char* needle) const
     str<32> debug_needle(needle); // needle goes out of scope before DEBUG_PIPELINE.
 #endif
 
+    // Only matches selected by a shorter prefix of the needle can still match,
+    // so typing narrows the selection rather than starting over each time.
+    unsigned int count = m_matches.begin_select(needle);
     if (count)
         selected_count = normal_selector(needle, m_matches.get_infos(), count);
 
     m_matches.coalesce(selected_count);
+    m_matches.end_select(needle);
 
     free(expanded);
 
@@ -20,5 +20,6 @@ public:
     void                sort() const;
 
 private:
+    void                generate_parallel(const line_state& state, const array<match_generator*>& generators) const;
     matches_impl&       m_matches;
 };
@@ -15,6 +15,8 @@
 #include <readline/readline.h> // for rl_last_path_separator
 
 #include <assert.h>
+#include <map>
+#include <mutex>
 
 extern "C" {
 extern int rl_complete_with_tilde_expansion;
@@ -133,6 +135,14 @@ void match_type_to_string(match_type type, str_base& out)
 //------------------------------------------------------------------------------
 match_builder::match_builder(matches& matches)
 : m_matches(matches)
+, m_cancelled(nullptr)
+{
+}
+
+//------------------------------------------------------------------------------
+match_builder::match_builder(matches& matches, const std::atomic<bool>& cancelled)
+: m_matches(matches)
+, m_cancelled(&cancelled)
 {
 }
 
@@ -177,14 +187,20 @@ void match_builder::set_matches_are_files(bool files)
     return ((matches_impl&)m_matches).set_matches_are_files(files);
 }
 
+//------------------------------------------------------------------------------
+bool match_builder::is_cancelled() const
+{
+    return m_cancelled && m_cancelled->load(std::memory_order_relaxed);
+}
+
 
 
 //------------------------------------------------------------------------------
 matches_iter::matches_iter(const matches& matches, const char* pattern)
 : m_matches(matches)
 , m_expanded_pattern(pattern && rl_complete_with_tilde_expansion ? tilde_expand(pattern) : nullptr)
-, m_pattern((m_expanded_pattern ? m_expanded_pattern : pattern),
-            (m_expanded_pattern ? m_expanded_pattern : pattern) ? -1 : 0)
+, m_matcher(str_iter((m_expanded_pattern ? m_expanded_pattern : pattern),
+                    (m_expanded_pattern ? m_expanded_pattern : pattern) ? -1 : 0))
 , m_has_pattern(pattern != nullptr)
 , m_filename_completion_desired(matches.is_filename_completion_desired())
 , m_filename_display_desired(matches.is_filename_display_desired())
@@ -217,7 +233,7 @@ bool matches_iter::next()
             int match_len = int(strlen(match));
             while (match_len && path::is_separator((unsigned char)match[match_len - 1]))
                 match_len--;
-            if (path::match_wild(m_pattern, str_iter(match, match_len), !is_pathish(get_match_type())))
+            if (m_matcher.match(str_iter(match, match_len), !is_pathish(get_match_type())))
                 goto found;
         }
     }
@@ -269,111 +285,325 @@ shadow_bool matches_iter::is_filename_display_desired() const
 
 
 
+//------------------------------------------------------------------------------
+// The pages of every store, keyed by their start address, with the end address
+// and the chain each belongs to.
+struct matches_impl::store_impl::registry
+{
+    struct page
+    {
+        const char*         end;
+        loan_chain*         chain;
+    };
+
+    std::mutex              mutex;
+    std::map<const char*, page> pages;
+};
+
+//------------------------------------------------------------------------------
+matches_impl::store_impl::registry& matches_impl::store_impl::get_registry()
+{
+    // Never destroyed, as loans can be returned during static destruction.
+    static registry* s_registry = new registry;
+    return *s_registry;
+}
+
 //------------------------------------------------------------------------------
 matches_impl::store_impl::store_impl(unsigned int size)
 {
-    m_size = max((unsigned int)4096, size);
+    m_initial_size = clamp(size, (unsigned int)4096, max_page_size);
+    m_size = m_initial_size;
     m_ptr = nullptr;
+    m_chain = new loan_chain;
     new_page();
 }
 
 //------------------------------------------------------------------------------
 matches_impl::store_impl::~store_impl()
 {
-    free_chain(false/*keep_one*/);
+    if (!retire_chain())
+        free_chain(false/*keep_one*/);
+
+    delete m_chain;
 }
 
 //------------------------------------------------------------------------------
 void matches_impl::store_impl::reset()
 {
-    free_chain(true/*keep_one*/);
+    if (retire_chain())
+    {
+        m_chain = new loan_chain;
+        m_size = m_initial_size;
+        new_page();
+    }
+    else
+    {
+        free_chain(true/*keep_one*/);
+    }
+
     m_back = m_size;
-    m_front = sizeof(m_ptr);
+    m_front = sizeof(page_header);
 }
 
 //------------------------------------------------------------------------------
-const char* matches_impl::store_impl::store_front(const char* str)
+const char* matches_impl::store_impl::store_front(const char* str, unsigned char prefix)
 {
-    unsigned int size = get_size(str);
-    unsigned int next = m_front + size;
-    if (next > m_back && !new_page())
+    if (!m_ptr && !new_page())
         return nullptr;
 
-    str_base(m_ptr + m_front, size).copy(str);
+    unsigned int size = get_size(str);
+    if (is_spill_size(size))
+    {
+        char* spill = new_spill(size);
+        return spill ? store(spill, str, size, prefix) : nullptr;
+    }
+
+    if (m_front + size > m_back && !new_page())
+        return nullptr;
 
-    const char* ret = m_ptr + m_front;
-    m_front = next;
+    const char* ret = store(m_ptr + m_front, str, size, prefix);
+    m_front += size;
     return ret;
 }
 
 //------------------------------------------------------------------------------
-const char* matches_impl::store_impl::store_back(const char* str)
+const char* matches_impl::store_impl::store_back(const char* str, unsigned char prefix)
 {
+    if (!m_ptr && !new_page())
+        return nullptr;
+
     unsigned int size = get_size(str);
-    unsigned int next = m_back - size;
-    if (next < m_front && !new_page())
+    if (is_spill_size(size))
+    {
+        char* spill = new_spill(size);
+        return spill ? store(spill, str, size, prefix) : nullptr;
+    }
+
+    if (m_front + size > m_back && !new_page())
         return nullptr;
 
-    m_back = next;
-    str_base(m_ptr + m_back, size).copy(str);
+    m_back -= size;
+    return store(m_ptr + m_back, str, size, prefix);
+}
 
-    return m_ptr + m_back;
+//------------------------------------------------------------------------------
+const char* matches_impl::store_impl::store(char* ptr, const char* str, unsigned int size, unsigned char prefix)
+{
+    // Not str_base; its size can't describe strings of spill page sizes.
+    *ptr = prefix;
+    if (str)
+        memcpy(ptr + 1, str, size - 1);
+    else
+        ptr[1] = '\0';
+    return ptr + 1;
 }
 
 //------------------------------------------------------------------------------
 unsigned int matches_impl::store_impl::get_size(const char* str) const
 {
+    // One byte for the prefix, plus the string and its terminator.
     if (str == nullptr)
-        return 1;
+        return 2;
+
+    return int(strlen(str) + 2);
+}
+
+//------------------------------------------------------------------------------
+bool matches_impl::store_impl::is_spill_size(unsigned int size) const
+{
+    // Anything over a quarter of a page would waste too much of the page, so
+    // it gets a dedicated allocation instead.
+    return size > (m_size - sizeof(page_header)) / 4;
+}
+
+//------------------------------------------------------------------------------
+char* matches_impl::store_impl::new_spill(unsigned int size)
+{
+    size += sizeof(page_header);
+
+    char* temp = (char*)malloc(size);
+    if (temp == nullptr)
+        return nullptr;
 
-    return int(strlen(str) + 1);
+    // Link the spill page in behind the current page, so the current page can
+    // continue to be filled.
+    page_header* head = reinterpret_cast<page_header*>(m_ptr);
+    page_header* header = reinterpret_cast<page_header*>(temp);
+    header->next = head->next;
+    header->size = size;
+    head->next = temp;
+    add_page(temp, size);
+    return temp + sizeof(page_header);
 }
 
 //------------------------------------------------------------------------------
 bool matches_impl::store_impl::new_page()
 {
-    char* temp = (char*)malloc(m_size);
+    // The first page uses the requested size; each subsequent page doubles in
+    // size so the number of pages grows logarithmically with the match count.
+    unsigned int size = m_size;
+    if (m_ptr)
+        size = min(m_size << 1, max_page_size);
+
+    char* temp = (char*)malloc(size);
     if (temp == nullptr)
         return false;
 
-    *reinterpret_cast<char**>(temp) = m_ptr;
-    m_front = sizeof(m_ptr);
+    page_header* header = reinterpret_cast<page_header*>(temp);
+    header->next = m_ptr;
+    header->size = size;
+    add_page(temp, size);
+    m_size = size;
+    m_front = sizeof(page_header);
     m_back = m_size;
     m_ptr = temp;
     return true;
 }
 
+//------------------------------------------------------------------------------
+void matches_impl::store_impl::add_page(char* page, unsigned int size)
+{
+    registry& reg = get_registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.pages[page] = { page + size, m_chain };
+}
+
 //------------------------------------------------------------------------------
 void matches_impl::store_impl::free_chain(bool keep_one)
 {
+    registry& reg = get_registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
     char* ptr = m_ptr;
 
     if (!keep_one)
     {
         m_ptr = nullptr;
-        m_front = sizeof(m_ptr);
+        m_front = sizeof(page_header);
         m_back = m_size;
     }
 
     while (ptr)
     {
         char* tmp = ptr;
-        ptr = *reinterpret_cast<char**>(ptr);
+        ptr = reinterpret_cast<page_header*>(ptr)->next;
         if (keep_one)
         {
+            // The head of the chain is always a regular page (spill pages are
+            // linked in behind it), and it's the largest one.  Keep it.
             keep_one = false;
-            *reinterpret_cast<char**>(tmp) = nullptr;
+            reinterpret_cast<page_header*>(tmp)->next = nullptr;
         }
         else
+        {
+            reg.pages.erase(tmp);
             free(tmp);
+        }
     }
 }
 
+//------------------------------------------------------------------------------
+// Returns false if there are no loans, leaving the chain with the store.
+bool matches_impl::store_impl::retire_chain()
+{
+    registry& reg = get_registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    if (!m_chain->loans)
+        return false;
+
+    // Readline still holds pointers into the chain, so the chain's pages stay
+    // registered to it, and the last loan returned frees them.
+    m_chain->pages = m_ptr;
+    m_chain->retired = true;
+    m_chain = nullptr;
+    m_ptr = nullptr;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+matches_impl::store_impl::loan_chain* matches_impl::store_impl::find_chain(registry& reg, const char* ptr)
+{
+    auto iter = reg.pages.upper_bound(ptr);
+    if (iter == reg.pages.begin())
+        return nullptr;
+
+    --iter;
+    if (ptr < iter->first + sizeof(page_header) || ptr >= iter->second.end)
+        return nullptr;
+
+    return iter->second.chain;
+}
+
+//------------------------------------------------------------------------------
+void matches_impl::store_impl::free_pages(registry& reg, char* pages)
+{
+    while (pages)
+    {
+        char* tmp = pages;
+        pages = reinterpret_cast<page_header*>(pages)->next;
+        reg.pages.erase(tmp);
+        free(tmp);
+    }
+}
+
+//------------------------------------------------------------------------------
+char* matches_impl::store_impl::lend(const char* str)
+{
+    // Lending hands out the prefixed form of the string.
+    char* ptr = const_cast<char*>(str) - 1;
+
+    registry& reg = get_registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    loan_chain* chain = find_chain(reg, ptr);
+    if (chain == nullptr)
+        return nullptr;
+
+    ++chain->loans;
+    return ptr;
+}
+
+//------------------------------------------------------------------------------
+bool matches_impl::store_impl::reclaim(char* ptr)
+{
+    registry& reg = get_registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    loan_chain* chain = find_chain(reg, ptr);
+    if (chain == nullptr)
+        return false;
+
+    assert(chain->loans);
+    if (--chain->loans == 0 && chain->retired)
+    {
+        free_pages(reg, chain->pages);
+        delete chain;
+    }
+
+    return true;
+}
+
+
+
+//------------------------------------------------------------------------------
+char* lend_match(const char* match)
+{
+    return matches_impl::store_impl::lend(match);
+}
+
+//------------------------------------------------------------------------------
+void free_match(char* match)
+{
+    if (!matches_impl::store_impl::reclaim(match))
+        free(match);
+}
+
 
 
 //------------------------------------------------------------------------------
 matches_impl::matches_impl(generators* generators, unsigned int store_size)
-: m_store(min(store_size, 0x10000u))
+: m_store(store_size)
 , m_generators(generators)
 , m_filename_completion_desired(false)
 , m_filename_display_desired(false)
@@ -520,6 +750,7 @@ void matches_impl::reset()
 {
     m_store.reset();
     m_infos.clear();
+    m_select_levels.clear();
     m_coalesced = false;
     m_count = 0;
     m_append_character = '\0';
@@ -584,7 +815,7 @@ bool matches_impl::add_match(const match_desc& desc)
             type = match_type::dir;
     }
 
-    const char* store_match = m_store.store_front(match);
+    const char* store_match = m_store.store_front(match, (unsigned char)type);
     if (!store_match)
         return false;
 
@@ -593,6 +824,73 @@ bool matches_impl::add_match(const match_desc& desc)
     return true;
 }
 
+//------------------------------------------------------------------------------
+void matches_impl::merge(const matches_impl& other)
+{
+    for (const auto& info : other.m_infos)
+        add_match({ info.match, info.type });
+
+    if (other.m_append_character)
+        m_append_character = other.m_append_character;
+    if (other.m_suppress_append)
+        m_suppress_append = true;
+    if (other.m_suppress_quoting)
+        m_suppress_quoting = other.m_suppress_quoting;
+    if (other.m_filename_completion_desired.is_explicit())
+        m_filename_completion_desired.set_explicit(other.m_filename_completion_desired.get());
+    if (other.m_filename_display_desired.is_explicit())
+        m_filename_display_desired.set_explicit(other.m_filename_display_desired.get());
+}
+
+//------------------------------------------------------------------------------
+// Returns how many leading infos can possibly match 'needle', based on earlier
+// selections.  Infos beyond that are left deselected.
+unsigned int matches_impl::begin_select(const char* needle)
+{
+    // A different comparison mode invalidates every earlier selection.
+    int mode = str_compare_scope::current();
+    bool fuzzy_accents = str_compare_scope::current_fuzzy_accents();
+    if (mode != m_select_mode || fuzzy_accents != m_select_fuzzy_accents)
+    {
+        m_select_levels.clear();
+        m_select_mode = mode;
+        m_select_fuzzy_accents = fuzzy_accents;
+    }
+
+    // Back up to the longest earlier needle that is a prefix of this one.
+    unsigned int needle_length = unsigned(strlen(needle));
+    while (!m_select_levels.empty())
+    {
+        const select_level& level = m_select_levels.back();
+        if (level.needle_length <= needle_length &&
+            strncmp(m_select_needle.c_str(), needle, level.needle_length) == 0)
+            break;
+
+        m_select_levels.pop_back();
+    }
+
+    if (m_select_levels.empty())
+        return get_info_count();
+
+    unsigned int count = m_select_levels.back().count;
+    if (m_select_levels.back().needle_length == needle_length)
+        m_select_levels.pop_back();
+
+    // Entries past 'count' were deselected by an earlier, shorter needle.
+    // Entries inside it may have been deselected by a longer needle since,
+    // but the selector visits all of those again.
+    return count;
+}
+
+//------------------------------------------------------------------------------
+void matches_impl::end_select(const char* needle)
+{
+    assert(m_coalesced);
+
+    m_select_needle = needle;
+    m_select_levels.push_back({ m_select_needle.length(), m_count });
+}
+
 //------------------------------------------------------------------------------
 void matches_impl::coalesce(unsigned int count_hint)
 {
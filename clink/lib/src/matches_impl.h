@@ -6,6 +6,7 @@
 #include "matches.h"
 
 #include "core/array.h"
+#include "core/str.h"
 #include <vector>
 
 //------------------------------------------------------------------------------
@@ -64,6 +65,8 @@ private:
     friend class            match_pipeline;
     friend class            match_builder;
     friend class            matches_iter;
+    friend char*            lend_match(const char* match);
+    friend void             free_match(char* match);
     void                    set_append_character(char append);
     void                    set_suppress_append(bool suppress);
     void                    set_suppress_quoting(int suppress);
@@ -73,9 +76,27 @@ private:
     const match_info*       get_infos() const;
     match_info*             get_infos();
     void                    reset();
+    unsigned int            begin_select(const char* needle);
+    void                    end_select(const char* needle);
     void                    coalesce(unsigned int count_hint);
+    void                    merge(const matches_impl& other);
 
 private:
+    // Pages are chained through a small header at the start of each page.
+    // Each new page is twice the size of the previous one (up to
+    // max_page_size) so that appending is amortized O(1) regardless of the
+    // number of matches.  Strings too large to share a page are given a
+    // dedicated "spill" page that is linked in behind the current page, so the
+    // current page stays usable.
+    //
+    // Each string is stored with a leading prefix byte (the match type), which
+    // is the layout Readline uses for its match list.  That lets strings be
+    // lent to Readline without copying them.  Loans are counted per chain of
+    // pages; a chain with outstanding loans is retired rather than freed on
+    // reset, and is freed once the last loan is returned.  Every page is
+    // registered by address so a returned string's chain is found in
+    // O(log pages), and as loans can come back on any thread the registry and
+    // loan counts are kept behind a lock.
     class store_impl
         : public match_store
     {
@@ -83,23 +104,67 @@ private:
                             store_impl(unsigned int size);
                             ~store_impl();
         void                reset();
-        const char*         store_front(const char* str);
-        const char*         store_back(const char* str);
+        const char*         store_front(const char* str, unsigned char prefix=0);
+        const char*         store_back(const char* str, unsigned char prefix=0);
+        static char*        lend(const char* str);
+        static bool         reclaim(char* ptr);
 
     private:
+        struct page_header
+        {
+            char*           next;
+            unsigned int    size;
+        };
+
+        struct loan_chain
+        {
+            char*           pages = nullptr;    // Set when retired.
+            unsigned int    loans = 0;
+            bool            retired = false;
+        };
+
+        struct registry;
+        static const unsigned int max_page_size = 0x100000;
+        static registry&    get_registry();
+        static loan_chain*  find_chain(registry& reg, const char* ptr);
+        static void         free_pages(registry& reg, char* pages);
         unsigned int        get_size(const char* str) const;
+        bool                is_spill_size(unsigned int size) const;
+        void                add_page(char* page, unsigned int size);
+        char*               new_spill(unsigned int size);
         bool                new_page();
         void                free_chain(bool keep_one);
+        bool                retire_chain();
+        const char*         store(char* ptr, const char* str, unsigned int size, unsigned char prefix);
         unsigned int        m_front;
         unsigned int        m_back;
+        unsigned int        m_initial_size;
+        loan_chain*         m_chain;
+    };
+
+    // Selecting only ever permutes the infos, moving selected ones to the
+    // front.  When a needle extends the previous one, only the entries that
+    // were selected last time can still match, so each level records how many
+    // leading infos were selected for a prefix of m_select_needle.  Narrowing
+    // the selection stays within the previous level's entries, so the levels
+    // remain valid and backing up to a shorter needle just restores a count.
+    struct select_level
+    {
+        unsigned int        needle_length;
+        unsigned int        count;
     };
 
     typedef std::vector<match_info> infos;
+    typedef std::vector<select_level> select_levels;
 
     store_impl              m_store;
     generators*             m_generators;
     infos                   m_infos;
-    unsigned short          m_count = 0;
+    unsigned int            m_count = 0;
+    select_levels           m_select_levels;
+    str_moveable            m_select_needle;
+    int                     m_select_mode = -1;
+    bool                    m_select_fuzzy_accents = false;
     bool                    m_coalesced = false;
     char                    m_append_character = '\0';
     bool                    m_suppress_append = false;
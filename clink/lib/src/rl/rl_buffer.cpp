@@ -10,6 +10,9 @@
 #include <core/path.h>
 #include <core/str_tokeniser.h>
 
+#include <algorithm>
+#include <assert.h>
+
 extern "C" {
 #include <readline/history.h>
 #include <readline/readline.h>
@@ -36,6 +39,9 @@ void rl_buffer::reset()
 void rl_buffer::begin_line()
 {
     m_need_draw = true;
+
+    // Aliases may have changed since the last line.
+    invalidate_word_cache();
 }
 
 //------------------------------------------------------------------------------
@@ -117,20 +123,94 @@ void rl_buffer::end_undo_group()
 }
 
 //------------------------------------------------------------------------------
-void rl_buffer::find_command_bounds(std::vector<command>& commands, bool stop_at_cursor) const
+void rl_buffer::invalidate_word_cache() const
+{
+    m_cache_valid = false;
+    m_cache_line.clear();
+    m_cache_commands.clear();
+    m_cache_words.clear();
+}
+
+//------------------------------------------------------------------------------
+void rl_buffer::update_word_cache() const
 {
     const char* line_buffer = get_buffer();
-    unsigned int line_stop = stop_at_cursor ? get_cursor() : get_length();
+    unsigned int line_length = get_length();
 
-    commands.clear();
+    // Find where the line first differs from the one the cache describes.
+    // Readline edits rl_line_buffer directly in too many places to rely on
+    // being told, and comparing is cheap next to tokenising.
+    unsigned int diff = 0;
+    if (m_cache_valid)
+    {
+        unsigned int n = min(line_length, unsigned(m_cache_line.size()));
+        const char* cache_line = m_cache_line.data();
+        while (diff + 64 <= n && memcmp(line_buffer + diff, cache_line + diff, 64) == 0)
+            diff += 64;
+        while (diff < n && line_buffer[diff] == cache_line[diff])
+            ++diff;
+
+        if (diff == n && line_length == m_cache_line.size())
+            return;
+    }
+
+    m_cache_line.assign(line_buffer, line_buffer + line_length);
+    m_cache_valid = true;
+
+    // Commands that end before the difference are unchanged, as are words of
+    // the next one that end before it (unless what was looked up as an alias
+    // has changed).  The tokenisers carry no state past a delimiter, so they
+    // can pick up from there.
+    unsigned int keep = 0;
+    while (keep < m_cache_commands.size() && m_cache_commands[keep].end() < diff)
+        ++keep;
+
+    unsigned int keep_words = unsigned(m_cache_words.size());
+    cached_command resume = {};
+    bool resuming = false;
+    if (keep < m_cache_commands.size())
+    {
+        const cached_command& next = m_cache_commands[keep];
+        keep_words = next.words;
+        if (next.token_offset < diff && next.first_word_end < diff)
+        {
+            auto words_end = m_cache_words.begin() + get_command_word_end(next);
+            auto kept_end = std::partition_point(m_cache_words.begin() + keep_words, words_end,
+                [diff] (const cached_word& cached) {
+                    return cached.word.offset + cached.word.length < diff;
+                });
+            keep_words = unsigned(kept_end - m_cache_words.begin());
+
+            resume = next;
+            resuming = true;
+        }
+    }
+
+    m_cache_commands.resize(keep);
+    m_cache_words.resize(keep_words);
 
     if (m_command_delims == nullptr)
     {
-        commands.push_back({ 0, line_stop });
+        add_cached_command(0, line_length, resuming ? &resume : nullptr);
         return;
     }
 
-    str_iter token_iter(line_buffer, line_stop);
+    // Kept words end outside of quotes, so a command can be picked up from
+    // the last of them too.  Not so an alias though, as it isn't tokenised.
+    unsigned int from = keep ? m_cache_commands.back().end() : 0;
+    bool inside = false;
+    if (resuming && m_cache_words.size() > resume.words)
+    {
+        inside = true;
+        if (m_cache_words[resume.words].word.is_alias)
+            for (unsigned int i = resume.bounds.offset; inside && i < resume.first_word_end; ++i)
+                inside = (line_buffer[i] != m_quote_pair[0]);
+
+        if (inside)
+            from = m_cache_words.back().token_end;
+    }
+
+    str_iter token_iter(line_buffer + from, line_length - from);
     str_tokeniser tokens(token_iter, m_command_delims);
     tokens.add_quote_pair(m_quote_pair);
 
@@ -138,119 +218,218 @@ void rl_buffer::find_command_bounds(std::vector<command>& commands, bool stop_at
     int length;
     while (tokens.next(start, length))
     {
-        // Match the doskey-disabler space in doskey::resolve().
-        if (start > line_buffer && length && start[0] == ' ')
-            start++, length--;
-
         unsigned int offset = unsigned(start - line_buffer);
-        if (stop_at_cursor)
+        unsigned int end = offset + length;
+        if (inside)
         {
-            // Have we found the command containing the cursor?
-            if (get_cursor() >= offset &&
-                get_cursor() <= offset + length)
+            assert(offset == from);
+            offset = resume.token_offset;
+            inside = false;
+        }
+
+        add_cached_command(offset, end, resuming ? &resume : nullptr);
+        resuming = false;
+    }
+}
+
+//------------------------------------------------------------------------------
+void rl_buffer::add_cached_command(
+    unsigned int token_offset,
+    unsigned int token_end,
+    const cached_command* resume) const
+{
+    const char* line_buffer = get_buffer();
+
+    cached_command addee = {};
+    addee.token_offset = token_offset;
+    addee.words = unsigned(m_cache_words.size());
+
+    // Match the doskey-disabler space in doskey::resolve().
+    unsigned int offset = token_offset;
+    if (m_command_delims != nullptr && offset > 0 && token_end > offset && line_buffer[offset] == ' ')
+        ++offset;
+
+    addee.bounds = { offset, token_end - offset };
+
+    // Carry on from the words kept from when this command was last tokenised.
+    if (resume != nullptr && resume->token_offset == token_offset)
+    {
+        addee.words = resume->words;
+        addee.first_word_end = resume->first_word_end;
+    }
+
+    collect_command_words(addee.bounds, addee.words, m_cache_words, addee.first_word_end);
+    m_cache_commands.push_back(addee);
+}
+
+//------------------------------------------------------------------------------
+void rl_buffer::collect_command_words(
+    const command& command,
+    unsigned int first,
+    std::vector<cached_word>& words,
+    unsigned int& first_word_end) const
+{
+    const char* line_buffer = get_buffer();
+    unsigned int command_offset = command.offset;
+    unsigned int command_end = command.offset + command.length;
+
+    unsigned int from = command_offset;
+    if (words.size() > first)
+    {
+        from = words.back().token_end;
+    }
+    else
+    {
+        unsigned int doskey_len = 0;
+        unsigned int first_word_len = 0;
+        while (first_word_len < command.length &&
+                line_buffer[command_offset + first_word_len] != ' ' &&
+                line_buffer[command_offset + first_word_len] != '\t')
+            first_word_len++;
+
+        first_word_end = command_offset + first_word_len;
+
+        if (first_word_len > 0)
+        {
+            str<32> lookup;
+            str<32> alias;
+            lookup.concat(line_buffer + command_offset, first_word_len);
+            if (os::get_alias(lookup.c_str(), alias))
             {
-                commands.push_back({ offset, unsigned(length) });
-                return;
+                unsigned char delim = (doskey_len < command.length) ? line_buffer[command_offset + doskey_len] : 0;
+                doskey_len = first_word_len;
+                words.push_back({{command_offset, doskey_len, true, true/*is_alias*/, 0, delim}, first_word_end});
             }
         }
-        else
+
+        from += doskey_len;
+    }
+
+    str_iter token_iter(line_buffer + from, command_end - from);
+    str_tokeniser tokens(token_iter, m_word_delims);
+    tokens.add_quote_pair(m_quote_pair);
+    while (1)
+    {
+        int length = 0;
+        const char *start = nullptr;
+        str_token token = tokens.next(start, length);
+        if (!token)
+            break;
+
+        unsigned int offset = unsigned(start - line_buffer);
+        unsigned int token_end = offset + length;
+
+        // Mercy.  We need to know later on if a flag word ends with = but
+        // that's never part of a word because it's a word delimiter.  We
+        // can't really know what is a flag word without running argmatchers
+        // because the argmatchers define the flag character(s) (and linked
+        // argmatchers can define different flag characters).  But we can't
+        // run argmatchers without having already parsed the words.  The
+        // abstraction between collecting words and running argmatchers
+        // breaks down here.
+        //
+        // Rather that redesign the system or dream up a complex solution,
+        // we'll use a simple(ish) mitigation that works the vast majority
+        // of the time because / and - are the only flag characters in
+        // widespread use.  If the word starts with / or - and the next
+        // character in the line is = then add it to the word.
+        if (length > 1 && strchr("-/", line_buffer[offset]))
         {
-            commands.push_back({ offset, unsigned(length) });
+            while (offset + length < command_end &&
+                line_buffer[offset + length] == '=')
+            {
+                length++;
+            }
         }
+
+        // Add the word.
+        bool first_word = (words.size() == first);
+        words.push_back({{offset, unsigned(length), first_word, false/*is_alias*/, 0, token.delim}, token_end});
     }
+}
+
+//------------------------------------------------------------------------------
+const rl_buffer::cached_command* rl_buffer::find_cursor_command() const
+{
+    // Without command delimiters the line is one command.
+    if (m_command_delims == nullptr)
+        return m_cache_commands.data();
 
-    if (stop_at_cursor)
+    // Only commands that start before the cursor; tokenising up to the cursor
+    // wouldn't find the others.
+    unsigned int cursor = get_cursor();
+    for (const cached_command& command : m_cache_commands)
     {
-        // We should expect to reach the cursor. If not then there's a trailing
-        // separator and we'll just say the command starts at the cursor.
-        start = line_buffer + line_stop;
-        length = 0;
+        if (command.token_offset >= cursor)
+            break;
+
+        if (cursor <= command.end())
+            return &command;
     }
+
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------
+unsigned int rl_buffer::get_command_word_end(const cached_command& command) const
+{
+    const cached_command* next = &command + 1;
+    if (next < m_cache_commands.data() + m_cache_commands.size())
+        return next->words;
+
+    return unsigned(m_cache_words.size());
 }
 
 //------------------------------------------------------------------------------
 unsigned int rl_buffer::collect_words(std::vector<word>& words, collect_words_mode mode) const
 {
+    update_word_cache();
+
     words.clear();
 
     const char* line_buffer = get_buffer();
     unsigned int line_cursor = get_cursor();
 
-    std::vector<command> commands;
     bool stop_at_cursor = (mode == collect_words_mode::stop_at_cursor ||
                            mode == collect_words_mode::display_filter);
-    find_command_bounds(commands, stop_at_cursor);
 
     unsigned int command_offset = 0;
 
-    for (auto& command : commands)
+    if (!stop_at_cursor)
     {
-        bool first = true;
-        unsigned int doskey_len = 0;
-        command_offset = command.offset;
+        for (const cached_word& cached : m_cache_words)
+            words.push_back(cached.word);
 
-        {
-            unsigned int first_word_len = 0;
-            while (first_word_len < command.length &&
-                    line_buffer[command_offset + first_word_len] != ' ' &&
-                    line_buffer[command_offset + first_word_len] != '\t')
-                first_word_len++;
+        if (!m_cache_commands.empty())
+            command_offset = m_cache_commands.back().bounds.offset;
+    }
+    else if (const cached_command* command = find_cursor_command())
+    {
+        command_offset = command->bounds.offset;
 
-            if (first_word_len > 0)
-            {
-                str<32> lookup;
-                str<32> alias;
-                lookup.concat(line_buffer + command_offset, first_word_len);
-                if (os::get_alias(lookup.c_str(), alias))
-                {
-                    unsigned char delim = (doskey_len < command.length) ? line_buffer[command_offset + doskey_len] : 0;
-                    doskey_len = first_word_len;
-                    words.push_back({command_offset, doskey_len, first, true/*is_alias*/, 0, delim});
-                    first = false;
-                }
-            }
-        }
+        const cached_word* word_iter = m_cache_words.data() + command->words;
+        const cached_word* word_end = m_cache_words.data() + get_command_word_end(*command);
 
-        str_iter token_iter(line_buffer + command.offset + doskey_len, command.length - doskey_len);
-        str_tokeniser tokens(token_iter, m_word_delims);
-        tokens.add_quote_pair(m_quote_pair);
-        while (1)
+        if (line_cursor < command->first_word_end)
         {
-            int length = 0;
-            const char *start = nullptr;
-            str_token token = tokens.next(start, length);
-            if (!token)
-                break;
-
-            unsigned int offset = unsigned(start - line_buffer);
-
-            // Mercy.  We need to know later on if a flag word ends with = but
-            // that's never part of a word because it's a word delimiter.  We
-            // can't really know what is a flag word without running argmatchers
-            // because the argmatchers define the flag character(s) (and linked
-            // argmatchers can define different flag characters).  But we can't
-            // run argmatchers without having already parsed the words.  The
-            // abstraction between collecting words and running argmatchers
-            // breaks down here.
-            //
-            // Rather that redesign the system or dream up a complex solution,
-            // we'll use a simple(ish) mitigation that works the vast majority
-            // of the time because / and - are the only flag characters in
-            // widespread use.  If the word starts with / or - and the next
-            // character in the line is = then add it to the word.
-            if (length > 1 && strchr("-/", line_buffer[offset]))
+            // What's looked up as an alias is cut short by the cursor, so
+            // tokenise the command up to the cursor afresh.
+            std::vector<cached_word> cut;
+            unsigned int first_word_end;
+            collect_command_words({ command_offset, line_cursor - command_offset }, 0, cut, first_word_end);
+            for (const cached_word& cached : cut)
+                words.push_back(cached.word);
+        }
+        else
+        {
+            // Tokenising stops at the cursor, which cuts short the word it's
+            // in and leaves out the words after it.
+            for (; word_iter < word_end && word_iter->word.offset < line_cursor; ++word_iter)
             {
-                while (offset + length < command.offset + command.length &&
-                    line_buffer[offset + length] == '=')
-                {
-                    length++;
-                }
+                word addee = word_iter->word;
+                addee.length = min<unsigned int>(addee.offset + addee.length, line_cursor) - addee.offset;
+                words.push_back(addee);
             }
-
-            // Add the word.
-            words.push_back({offset, unsigned(length), first, false/*is_alias*/, 0, token.delim});
-
-            first = false;
         }
     }
 
@@ -4,6 +4,9 @@
 #pragma once
 
 #include "line_buffer.h"
+#include "line_state.h"
+
+#include <vector>
 
 //------------------------------------------------------------------------------
 class rl_buffer
@@ -15,6 +18,21 @@ class rl_buffer
         unsigned int        length;
     };
 
+    struct cached_word
+    {
+        word                word;           // Before quotes are stripped.
+        unsigned int        token_end;      // Where the tokeniser stopped.
+    };
+
+    struct cached_command
+    {
+        unsigned int        end() const { return bounds.offset + bounds.length; }
+        command             bounds;
+        unsigned int        token_offset;   // Including any doskey-disabler space.
+        unsigned int        first_word_end; // What was looked up as an alias.
+        unsigned int        words;          // Index of its first cached_word.
+    };
+
 public:
                             rl_buffer(const char* command_delims = nullptr,
                                       const char* word_delims = " \t",
@@ -37,12 +55,23 @@ public:
     virtual unsigned int    collect_words(std::vector<word>& words, collect_words_mode mode) const;
 
 private:
-    void                    find_command_bounds(std::vector<command>& commands, bool stop_at_cursor) const;
+    void                    update_word_cache() const;
+    void                    add_cached_command(unsigned int token_offset, unsigned int token_end, const cached_command* resume) const;
+    void                    collect_command_words(const command& command, unsigned int first, std::vector<cached_word>& words, unsigned int& first_word_end) const;
+    const cached_command*   find_cursor_command() const;
+    unsigned int            get_command_word_end(const cached_command& command) const;
+    void                    invalidate_word_cache() const;
     char                    get_closing_quote() const;
 
 private:
     bool                    m_need_draw;
 
+    // Words of the whole line, updated from the first change since last time.
+    mutable std::vector<char> m_cache_line;
+    mutable std::vector<cached_command> m_cache_commands;
+    mutable std::vector<cached_word> m_cache_words;
+    mutable bool            m_cache_valid = false;
+
     const char* const       m_command_delims;
     const char* const       m_word_delims;
     const char* const       m_quote_pair;
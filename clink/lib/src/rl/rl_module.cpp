@@ -34,6 +34,8 @@ extern "C" {
 #include <readline/xmalloc.h>
 #include <compat/dirent.h>
 #include <compat/display_matches.h>
+#include <compat/history_arena.h>
+#include <compat/history_index.h>
 #include <readline/posixdir.h>
 #include <readline/history.h>
 extern int _rl_bell_preference;
@@ -85,6 +87,8 @@ extern int macro_hook_func(const char* macro);
 extern int filter_matches(char** matches);
 extern void update_matches();
 extern matches* maybe_regenerate_matches(const char* needle, bool popup);
+extern char* lend_match(const char* match);
+extern void free_match(char* match);
 extern setting_color g_color_interact;
 
 terminal_in*        s_direct_input = nullptr;       // for read_key_hook
@@ -206,6 +210,30 @@ static setting_bool g_match_wild(
     "Turn this off to behave how bash does.",
     true);
 
+static setting_bool g_match_zero_copy(
+    "match.zero_copy",
+    "Hand matches to Readline without copying",
+    "When enabled, Readline borrows match strings directly from Clink's match\n"
+    "storage instead of receiving a separately allocated copy of each match.\n"
+    "This makes completing large numbers of matches faster.",
+    false);
+
+static setting_bool g_history_search_index(
+    "history.search_index",
+    "Index history lines for searching",
+    "When enabled, history searches use an index of the history lines to skip\n"
+    "lines that can't contain the search text.  This makes searching a large\n"
+    "history faster, at the cost of some memory.",
+    false);
+
+static setting_bool g_history_arena(
+    "history.arena",
+    "Allocate history lines in large blocks",
+    "When enabled, history lines and their timestamps are allocated from large\n"
+    "blocks of memory instead of one at a time.  This makes loading and clearing\n"
+    "a large history faster and fragments memory less.",
+    false);
+
 static setting_bool g_rl_hide_stderr(
     "readline.hide_stderr",
     "Suppress stderr from the Readline library",
@@ -685,10 +713,13 @@ static char** alternative_matches(const char* text, int start, int end)
         end_prefix = (char*)text + 2;
     int len_prefix = end_prefix ? end_prefix - text : 0;
 
-    // Deep copy of the generated matches.  Inefficient, but this is how
-    // readline wants them.
+    // Readline wants each match as a separate string with a leading type byte.
+    // The match store already lays matches out that way, so when zero copy is
+    // enabled Readline borrows the strings and returns them via free_match().
+    // Otherwise each match is deep copied.
     str<32> lcd;
     int past_flag = rl_completion_matches_include_type;
+    bool zero_copy = past_flag && g_match_zero_copy.get();
     int count = 0;
     int reserved = 0;
     char** matches = nullptr;
@@ -712,6 +743,16 @@ static char** alternative_matches(const char* text, int start, int end)
         }
 
         const char* match = iter.get_match();
+        if (zero_copy)
+        {
+            matches[count] = lend_match(match);
+            if (matches[count])
+            {
+                assert((unsigned char)matches[count][0] == (unsigned char)type);
+                continue;
+            }
+        }
+
         int match_len = strlen(match);
         int match_size = past_flag + match_len + 1;
         matches[count] = (char*)malloc(match_size);
@@ -1220,6 +1261,7 @@ rl_module::rl_module(const char* shell_name, terminal_in* input)
     rl_match_display_filter_func = match_display_filter_callback;
     rl_is_exec_func = is_exec_ext;
     rl_postprocess_lcd_func = postprocess_lcd;
+    rl_free_match_func = free_match;
     rl_read_key_hook = read_key_hook;
     rl_get_face_func = get_face_func;
     rl_puts_face_func = puts_face_func;
@@ -1270,6 +1312,9 @@ rl_module::rl_module(const char* shell_name, terminal_in* input)
         rl_complete_with_tilde_expansion = 1;   // Since CMD doesn't understand tilde.
     }
 
+    // The host loads history once the module exists.
+    history_use_arena = g_history_arena.get();
+
     // Bind extended keys so editing follows Windows' conventions.
     static const char* emacs_key_binds[][2] = {
         { "\\e[1;5D",       "backward-word" },           // ctrl-left
@@ -1511,6 +1556,9 @@ concat_verbatim:
     if (!_rl_display_message_color)
         _rl_display_message_color = "\x1b[m";
 
+    history_search_indexed = g_history_search_index.get();
+    history_use_arena = g_history_arena.get();
+
     auto handler = [] (char* line) { rl_module::get()->done(line); };
     rl_callback_handler_install(rl_prompt.c_str(), handler);
 
@@ -1550,6 +1598,16 @@ void rl_module::on_end_line()
     // This prevents any partial Readline state leaking from one line to the next
     rl_readline_state &= ~RL_MORE_INPUT_STATES;
 
+    // Stuffed input is only dropped once the input buffer's at its limit.
+    static unsigned int s_input_drops = 0;
+    unsigned int input_high_water, input_drops;
+    rl_get_input_stats(&input_high_water, &input_drops);
+    if (input_drops != s_input_drops)
+    {
+        LOG("INPUT dropped %u keys (high water %u)", input_drops - s_input_drops, input_high_water);
+        s_input_drops = input_drops;
+    }
+
     g_rl_buffer = nullptr;
     g_pager = nullptr;
     g_printer = nullptr;
@@ -1573,6 +1631,7 @@ void rl_module::on_input(const input& input, result& result, const context& cont
         virtual void end() override     {}
         virtual void select() override  {}
         virtual int  read() override    { return *(unsigned char*)(data++); }
+        virtual const char* read_paste() override { return ""; }
         virtual key_tester* set_key_tester(key_tester* keys) override { return nullptr; }
         const char*  data;
     } term_in;
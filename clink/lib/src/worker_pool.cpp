@@ -0,0 +1,63 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "worker_pool.h"
+
+//------------------------------------------------------------------------------
+void completion::signal()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_done = true;
+    m_signalled.notify_all();
+}
+
+//------------------------------------------------------------------------------
+void completion::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_signalled.wait(lock, [this] () { return m_done; });
+}
+
+
+
+//------------------------------------------------------------------------------
+worker_pool& worker_pool::get()
+{
+    // The pool is deliberately never destroyed; joining threads while the
+    // process (or DLL) is being torn down can deadlock on Windows.
+    static worker_pool* s_pool = new worker_pool(clamp(std::thread::hardware_concurrency(), 1u, 4u));
+    return *s_pool;
+}
+
+//------------------------------------------------------------------------------
+worker_pool::worker_pool(unsigned int thread_count)
+{
+    for (unsigned int i = 0; i < thread_count; ++i)
+        std::thread([this] () { worker(); }).detach();
+}
+
+//------------------------------------------------------------------------------
+void worker_pool::post(task&& work)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back(std::move(work));
+    m_wake.notify_one();
+}
+
+//------------------------------------------------------------------------------
+void worker_pool::worker()
+{
+    while (true)
+    {
+        task work;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] () { return !m_tasks.empty(); });
+            work = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        work();
+    }
+}
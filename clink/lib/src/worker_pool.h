@@ -0,0 +1,45 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/base.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+//------------------------------------------------------------------------------
+class completion
+    : public no_copy
+{
+public:
+    void                    signal();
+    void                    wait();
+
+private:
+    std::mutex              m_mutex;
+    std::condition_variable m_signalled;
+    bool                    m_done = false;
+};
+
+//------------------------------------------------------------------------------
+class worker_pool
+    : public no_copy
+{
+public:
+    typedef std::function<void()> task;
+
+    static worker_pool&     get();
+    void                    post(task&& work);
+
+private:
+                            worker_pool(unsigned int thread_count);
+                            ~worker_pool() = delete;
+    void                    worker();
+    std::deque<task>        m_tasks;
+    std::mutex              m_mutex;
+    std::condition_variable m_wake;
+};
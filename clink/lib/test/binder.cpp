@@ -6,6 +6,11 @@
 #include "binder.h"
 #include "editor_module.h"
 
+#include <core/base.h>
+#include <core/str.h>
+
+#include <chrono>
+
 //------------------------------------------------------------------------------
 TEST_CASE("Binder")
 {
@@ -30,36 +35,104 @@ TEST_CASE("Binder")
         REQUIRE(binder.get_group("group2") == groups[1]);
     }
 
-    SECTION("Overflow : group")
+    SECTION("Many groups")
     {
-        for (int i = 1; i < 256; ++i)
-            REQUIRE(binder.create_group("group") == (i * 2) + 1);
+        int groups[1000];
+        for (int i = 0; i < sizeof_array(groups); ++i)
+        {
+            str<16> name;
+            name.format("group%d", i);
+            groups[i] = binder.create_group(name.c_str());
+            REQUIRE(groups[i] != -1);
+        }
 
-        REQUIRE(binder.create_group("group") == -1);
+        for (int i = 0; i < sizeof_array(groups); ++i)
+        {
+            str<16> name;
+            name.format("group%d", i);
+            REQUIRE(binder.get_group(name.c_str()) == groups[i]);
+
+            auto& module = ((editor_module*)0)[i & 0x7f];
+            REQUIRE(binder.bind(groups[i], "\\e[A", module, char(i)));
+        }
+
+        bind_resolver resolver(binder);
+        for (int i = 0; i < sizeof_array(groups); i += 111)
+        {
+            resolver.set_group(groups[i]);
+            resolver.reset();
+            resolver.step('\x1b');
+            resolver.step('[');
+            REQUIRE(resolver.step('A'));
+
+            auto binding = resolver.next();
+            REQUIRE(binding);
+            REQUIRE(binding.get_id() == (unsigned char)i);
+            binding.claim();
+        }
     }
 
     SECTION("Overflow : module")
     {
         int group = binder.get_group();
-        for (int i = 0; i < 64; ++i)
+        for (int i = 0; i < 256; ++i)
             REQUIRE(binder.bind(group, "", ((editor_module*)0)[i], char(i)));
 
-        auto& module = ((editor_module*)0)[0xff];
+        auto& module = ((editor_module*)0)[0x100];
         REQUIRE(!binder.bind(group, "", module, 0xff));
     }
 
-    SECTION("Overflow : bind")
+    SECTION("Many binds")
     {
         auto& null_module = *(editor_module*)0;
         int default_group = binder.get_group();
 
-        for (int i = 0; i < 508; ++i)
+        for (int i = 0; i < 20000; ++i)
+        {
+            char chord[] = { char((i / 0xfe) + 1), char((i % 0xfe) + 1), 0 };
+            REQUIRE(binder.bind(default_group, chord, null_module, char(i)));
+        }
+
+        REQUIRE(binder.bind(default_group, "\x01\x02\x03", null_module, 0x12));
+
+        for (int i = 0; i < 20000; i += 97)
         {
-            char chord[] = { char((i > 0xff) + 1), char((i % 0xfe) + 1), 0 };
-            REQUIRE(binder.bind(default_group, chord, null_module, 0x12));
+            bind_resolver resolver(binder);
+            resolver.step(char((i / 0xfe) + 1));
+            if (!resolver.step(char((i % 0xfe) + 1)))
+                resolver.step('x');
+
+            auto binding = resolver.next();
+            REQUIRE(binding);
+            REQUIRE(binding.get_id() == (unsigned char)i);
         }
+    }
+
+    SECTION("Longest chord first")
+    {
+        auto& module_a = ((editor_module*)0)[1];
+        auto& module_b = ((editor_module*)0)[2];
+        int group = binder.get_group();
+
+        REQUIRE(binder.bind(group, "", module_a, 1));
+        REQUIRE(binder.bind(group, "\\e[", module_a, 2));
+        REQUIRE(binder.bind(group, "\\e[A", module_a, 3));
+        REQUIRE(binder.bind(group, "\\e[A", module_b, 4));
 
-        REQUIRE(!binder.bind(default_group, "\x01\x02\x03", null_module, 0x12));
+        bind_resolver resolver(binder);
+        resolver.step('\x1b');
+        resolver.step('[');
+        REQUIRE(resolver.step('A'));
+
+        unsigned char expected[] = { 3, 4, 2, 1 };
+        for (unsigned char id : expected)
+        {
+            auto binding = resolver.next();
+            REQUIRE(binding);
+            REQUIRE(binding.get_id() == id);
+        }
+
+        REQUIRE(!resolver.next());
     }
 
     SECTION("Valid chords")
@@ -117,3 +190,107 @@ TEST_CASE("Binder")
         }
     }
 }
+
+
+
+//------------------------------------------------------------------------------
+TEST_CASE("Binder benchmark", "[.benchmark]")
+{
+    // A keymap shaped like the one the editor builds; a catch-all, cursor and
+    // function keys with all the xterm modifiers, SS3 keys, Alt-letters, and
+    // control keys.
+    binder binder;
+    auto& module = *(editor_module*)0;
+    int group = binder.get_group();
+    unsigned char id = 0;
+
+    binder.bind(group, "", module, id++);
+
+    static const char csi_finals[] = "ABCDHF";
+    static const char* const tildes[] = { "2", "3", "5", "6", "15", "17", "18", "19", "20", "21", "23", "24" };
+    for (int mod = 1; mod <= 8; ++mod)
+    {
+        str<16> chord;
+        for (const char* c = csi_finals; *c; ++c)
+        {
+            if (mod == 1)
+                chord.format("\\e[%c", *c);
+            else
+                chord.format("\\e[1;%d%c", mod, *c);
+            binder.bind(group, chord.c_str(), module, id++);
+        }
+
+        for (const char* tilde : tildes)
+        {
+            if (mod == 1)
+                chord.format("\\e[%s~", tilde);
+            else
+                chord.format("\\e[%s;%d~", tilde, mod);
+            binder.bind(group, chord.c_str(), module, id++);
+        }
+    }
+
+    for (const char* c = "ABCDHFPQRS"; *c; ++c)
+    {
+        str<16> chord;
+        chord.format("\\eO%c", *c);
+        binder.bind(group, chord.c_str(), module, id++);
+    }
+
+    for (char c = 'a'; c <= 'z'; ++c)
+    {
+        str<16> chord;
+        chord.format("\\M-%c", c);
+        binder.bind(group, chord.c_str(), module, id++);
+        chord.format("\\C-%c", c);
+        binder.bind(group, chord.c_str(), module, id++);
+    }
+
+    // Mostly typing, with cursor movement, word motion, and editing keys mixed
+    // in as they would be at a prompt.
+    static const char* const input_parts[] = {
+        "git log --oneline --graph ",
+        "\x1b[D", "\x1b[D", "\x1b[1;5D", "\x1b[3~",
+        "cd \\some\\path",
+        "\x1b" "b", "\x1b" "f", "\x01", "\x05",
+        "\x1bOA", "\x1bOB", "\x1b[1;2C", "\x1b[5~",
+        "echo %PATH% && dir /b /s",
+        "\x1b[15;5~", "\x1b[H", "\x1b[F", "\x17",
+    };
+
+    str<> input;
+    for (int i = 0; i < 100; ++i)
+        for (const char* part : input_parts)
+            input << part;
+
+    typedef std::chrono::steady_clock clock;
+    static const int repeats = 200;
+
+    bind_resolver resolver(binder);
+    unsigned int dispatched = 0;
+    auto start = clock::now();
+
+    for (int r = 0; r < repeats; ++r)
+    {
+        for (const char* c = input.c_str(); *c; ++c)
+        {
+            if (!resolver.step(*c))
+                continue;
+
+            while (auto binding = resolver.next())
+            {
+                ++dispatched;
+                binding.claim();
+            }
+        }
+    }
+
+    auto elapsed = clock::now() - start;
+    double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    double keys = double(input.length()) * repeats;
+
+    printf("bind_resolver %.0f keys  %d binds  %u dispatched  %.1f ns/key\n",
+        keys, int(id), dispatched, ns / keys);
+
+    REQUIRE(dispatched > 0);
+}
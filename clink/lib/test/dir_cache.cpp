@@ -0,0 +1,255 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "dir_cache.h"
+#include "fs_fixture.h"
+#include "line_state.h"
+#include "matches_impl.h"
+#include "setting_fixture.h"
+
+#include <core/os.h>
+#include <core/path.h>
+#include <core/settings.h>
+#include <core/str.h>
+#include <lib/match_generator.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+class test_validator
+    : public dir_cache::validator
+{
+public:
+    virtual bool get_stamp(const char* dir, unsigned long long& stamp) override
+    {
+        stamp = m_stamp;
+        return m_valid;
+    }
+
+    unsigned long long  m_stamp = 1;
+    bool                m_valid = true;
+};
+
+//------------------------------------------------------------------------------
+static std::shared_ptr<const dir_listing> make_listing(int count)
+{
+    auto listing = std::make_shared<dir_listing>();
+    for (int i = 0; i < count; ++i)
+    {
+        str<16> name;
+        name.format("file%d", i);
+        async_glob::entry entry = { (unsigned int)listing->names.size(), 0, 0 };
+        listing->names.insert(listing->names.end(), name.c_str(), name.c_str() + name.length() + 1);
+        listing->entries.push_back(entry);
+    }
+    return listing;
+}
+
+
+
+//------------------------------------------------------------------------------
+TEST_CASE("Directory cache")
+{
+    test_validator validator;
+    dir_cache cache;
+    cache.set_validator(&validator);
+
+    dir_cache::stats stats;
+
+    SECTION("Hit and miss")
+    {
+        REQUIRE(cache.find("c:\\dir", 0) == nullptr);
+
+        cache.store("c:\\dir", 0, 1, make_listing(3));
+        auto listing = cache.find("c:\\dir", 0);
+        REQUIRE(listing != nullptr);
+        REQUIRE(listing->entries.size() == 3);
+        REQUIRE(strcmp(listing->names.data() + listing->entries[2].name, "file2") == 0);
+
+        REQUIRE(cache.find("C:\\DIR", 0) != nullptr);
+        REQUIRE(cache.find("c:\\dir", 1) == nullptr);
+        REQUIRE(cache.find("c:\\other", 0) == nullptr);
+
+        cache.get_stats(stats);
+        REQUIRE(stats.hits == 2);
+        REQUIRE(stats.misses == 3);
+        REQUIRE(stats.stale == 0);
+        REQUIRE(stats.listings == 1);
+    }
+
+    SECTION("Stale")
+    {
+        cache.store("c:\\dir", 0, 1, make_listing(3));
+        REQUIRE(cache.contains("c:\\dir", 0));
+
+        validator.m_stamp = 2;
+        REQUIRE(!cache.contains("c:\\dir", 0));
+        REQUIRE(cache.find("c:\\dir", 0) == nullptr);
+
+        cache.get_stats(stats);
+        REQUIRE(stats.stale == 1);
+        REQUIRE(stats.listings == 0);
+        REQUIRE(stats.bytes == 0);
+    }
+
+    SECTION("Unverifiable")
+    {
+        cache.store("c:\\dir", 0, 1, make_listing(3));
+
+        validator.m_valid = false;
+        REQUIRE(cache.find("c:\\dir", 0) == nullptr);
+    }
+
+    SECTION("Budget")
+    {
+        auto listing = make_listing(100);
+        size_t bytes = listing->get_bytes();
+        cache.set_budget(bytes * 2);
+
+        cache.store("c:\\one", 0, 1, listing);
+        cache.store("c:\\two", 0, 1, make_listing(100));
+        REQUIRE(cache.find("c:\\one", 0) != nullptr);
+
+        // 'two' is the least recently used, so it goes first.
+        cache.store("c:\\three", 0, 1, make_listing(100));
+        REQUIRE(cache.contains("c:\\one", 0));
+        REQUIRE(!cache.contains("c:\\two", 0));
+        REQUIRE(cache.contains("c:\\three", 0));
+
+        cache.get_stats(stats);
+        REQUIRE(stats.evictions == 1);
+        REQUIRE(stats.bytes <= bytes * 2);
+
+        // Listings bigger than the whole budget aren't kept.
+        cache.store("c:\\big", 0, 1, make_listing(1000));
+        REQUIRE(!cache.contains("c:\\big", 0));
+        REQUIRE(cache.contains("c:\\one", 0));
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Directory cache file generator")
+{
+    fs_fixture fs;
+
+    static const char* settings[] = { "files.cache", "true", nullptr };
+    setting_fixture cache_settings(settings);
+
+    // Directories in the fixture are brand new, so the default validator
+    // wouldn't trust them yet.
+    struct validator_scope
+    {
+                        validator_scope() { dir_cache::get().set_validator(&validator); }
+                        ~validator_scope() { dir_cache::get().set_validator(nullptr); }
+        test_validator  validator;
+    } scope;
+
+    dir_cache::get().reset_stats();
+    dir_cache::stats stats;
+
+    auto generate = [] (const char* input) {
+        std::vector<word> words;
+        word end_word = { 0, (unsigned int)strlen(input), false, false, false, 0 };
+        words.push_back(end_word);
+        line_state line(input, end_word.length, 0, words);
+
+        matches_impl matches;
+        match_builder builder(matches);
+        file_match_generator().generate(line, builder);
+        return matches.get_match_count();
+    };
+
+    SECTION("Whole directory")
+    {
+        REQUIRE(generate("dir1\\") == 3);
+        REQUIRE(generate("dir1\\") == 3);
+
+        dir_cache::get().get_stats(stats);
+        REQUIRE(stats.hits == 1);
+        REQUIRE(stats.listings == 1);
+    }
+
+    SECTION("Part of a name")
+    {
+        // As with '-flag:dir1\f', where the end word keeps part of a name.
+        REQUIRE(generate("dir1\\f") == 2);
+
+        dir_cache::get().get_stats(stats);
+        REQUIRE(stats.listings == 0);
+
+        REQUIRE(generate("dir1\\") == 3);
+        REQUIRE(generate("dir1\\f") == 2);
+
+        dir_cache::get().get_stats(stats);
+        REQUIRE(stats.hits == 0);
+        REQUIRE(stats.listings == 1);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Directory cache benchmark", "[.benchmark]")
+{
+    static const int file_count = 50000;
+    static const int completions = 20;
+
+    str<280> root;
+    REQUIRE(os::get_temp_dir(root));
+    path::append(root, "clink_dir_cache_benchmark");
+    os::make_dir(root.c_str());
+
+    str<280> file;
+    bool created = false;
+    for (int i = 0; i < file_count; ++i)
+    {
+        file.format("%s\\file_%05d.txt", root.c_str(), i);
+        if (os::get_path_type(file.c_str()) != os::path_type_file)
+        {
+            fclose(fopen(file.c_str(), "w"));
+            created = true;
+        }
+    }
+
+    // Listings of just-modified directories aren't trusted, so let it settle.
+    if (created)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+
+    str<280> input;
+    input.format("%s\\", root.c_str());
+
+    std::vector<word> words;
+    word end_word = { 0, input.length(), false, false, false, 0 };
+    words.push_back(end_word);
+    line_state line(input.c_str(), input.length(), 0, words);
+
+    static const char* settings[] = { "files.cache", "false", nullptr };
+    setting_fixture cache_settings(settings);
+    setting* cache_setting = settings::find("files.cache");
+
+    for (int cached = 0; cached <= 1; ++cached)
+    {
+        cache_setting->set(cached ? "true" : "false");
+        dir_cache::get().clear();
+        dir_cache::get().reset_stats();
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < completions; ++i)
+        {
+            matches_impl matches;
+            match_builder builder(matches);
+            file_match_generator().generate(line, builder);
+            REQUIRE(matches.get_match_count() == file_count);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        dir_cache::stats stats;
+        dir_cache::get().get_stats(stats);
+        printf("%s: %d completions of %d files took %lld ms (%u hits, %u misses)\n",
+            cached ? "cached" : "uncached", completions, file_count,
+            (long long)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(),
+            stats.hits, stats.misses);
+    }
+}
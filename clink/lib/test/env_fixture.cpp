@@ -0,0 +1,28 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "env_fixture.h"
+
+#include <core/os.h>
+
+//------------------------------------------------------------------------------
+env_fixture::env_fixture(const char** env)
+{
+    for (; env[0] != nullptr; env += 2)
+    {
+        saved_var saved;
+        saved.name = env[0];
+        saved.existed = os::get_env(env[0], saved.value);
+        m_saved.push_back(std::move(saved));
+
+        os::set_env(env[0], env[1]);
+    }
+}
+
+//------------------------------------------------------------------------------
+env_fixture::~env_fixture()
+{
+    for (auto i = m_saved.rbegin(), n = m_saved.rend(); i != n; ++i)
+        os::set_env(i->name.c_str(), i->existed ? i->value.c_str() : nullptr);
+}
@@ -0,0 +1,28 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/str.h>
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Sets environment variables from a nullptr-terminated list of name/value
+// pairs, putting back whatever was there before when it goes out of scope.
+class env_fixture
+{
+public:
+                        env_fixture(const char** env);
+                        ~env_fixture();
+
+private:
+    struct saved_var
+    {
+        str_moveable    name;
+        str_moveable    value;
+        bool            existed;
+    };
+
+    std::vector<saved_var> m_saved;
+};
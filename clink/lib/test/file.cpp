@@ -5,6 +5,7 @@
 #include "env_fixture.h"
 #include "fs_fixture.h"
 #include "line_editor_tester.h"
+#include "setting_fixture.h"
 
 #include <core/os.h>
 #include <core/path.h>
@@ -132,3 +133,31 @@ TEST_CASE("File match generator")
         }
     }
 }
+
+//------------------------------------------------------------------------------
+TEST_CASE("File match generator (async)")
+{
+    fs_fixture fs;
+
+    static const char* settings[] = { "files.async", "true", nullptr };
+    setting_fixture async(settings);
+
+    line_editor_tester tester;
+    tester.get_editor()->add_generator(file_match_generator());
+
+    SECTION("File system matches")
+    {
+        tester.set_input("");
+        tester.set_expected_matches("case_map-1", "case_map_2", "dir1\\",
+            "dir2\\", "file1", "file2");
+        tester.run();
+    }
+
+    SECTION("Sub-directory")
+    {
+        tester.set_input("dir1/" DO_COMPLETE);
+        tester.set_expected_matches("dir1\\only", "dir1\\file1", "dir1\\file2");
+        tester.set_expected_output("dir1\\");
+        tester.run();
+    }
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "fs_fixture.h"
+
+#include <core/globber.h>
+#include <core/os.h>
+#include <core/path.h>
+
+//------------------------------------------------------------------------------
+static const char* g_default_fs[] = {
+    "dir1/only",
+    "dir1/file1",
+    "dir1/file2",
+    "dir2/",
+    "file1",
+    "file2",
+    "case_map-1",
+    "case_map_2",
+    nullptr,
+};
+
+
+
+//------------------------------------------------------------------------------
+fs_fixture::fs_fixture(const char** fs)
+{
+    static int s_id = 0;
+
+    os::get_current_dir(m_prev_dir);
+
+    str<16> name;
+    name.format("clink_test_%d", ++s_id);
+    os::get_temp_dir(m_root);
+    path::append(m_root, name.c_str());
+    clean(m_root.c_str());
+    os::make_dir(m_root.c_str());
+
+    for (const char** entry = (fs ? fs : g_default_fs); *entry; ++entry)
+    {
+        int length = int(strlen(*entry));
+        bool is_dir = (length > 0 && (*entry)[length - 1] == '/');
+        is_dir |= (length > 1 && strcmp(*entry + length - 2, "/.") == 0);
+
+        str<280> item;
+        path::join(m_root.c_str(), *entry, item);
+        path::normalise(item);
+        while (item.length() && path::is_separator(item[item.length() - 1]))
+            item.truncate(item.length() - 1);
+
+        if (is_dir)
+        {
+            os::make_dir(item.c_str());
+            continue;
+        }
+
+        str<280> dir;
+        path::get_directory(item.c_str(), dir);
+        os::make_dir(dir.c_str());
+
+        if (FILE* out = fopen(item.c_str(), "wb"))
+        {
+            fputs(*entry, out);
+            fclose(out);
+        }
+    }
+
+    os::set_current_dir(m_root.c_str());
+}
+
+//------------------------------------------------------------------------------
+fs_fixture::~fs_fixture()
+{
+    os::set_current_dir(m_prev_dir.c_str());
+    clean(m_root.c_str());
+}
+
+//------------------------------------------------------------------------------
+const char* fs_fixture::get_root() const
+{
+    return m_root.c_str();
+}
+
+//------------------------------------------------------------------------------
+void fs_fixture::clean(const char* path)
+{
+    if (os::get_path_type(path) != os::path_type_dir)
+        return;
+
+    str<280> pattern;
+    path::join(path, "*", pattern);
+
+    globber dirs(pattern.c_str());
+    dirs.files(false);
+    dirs.suffix_dirs(false);
+    dirs.hidden(true);
+    dirs.system(true);
+
+    str<280> child;
+    while (dirs.next(child))
+        clean(child.c_str());
+
+    globber files(pattern.c_str());
+    files.directories(false);
+    files.hidden(true);
+    files.system(true);
+
+    while (files.next(child))
+        os::unlink(child.c_str());
+
+    os::remove_dir(path);
+}
@@ -0,0 +1,24 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/str.h>
+
+//------------------------------------------------------------------------------
+// Builds a throwaway directory tree in the temp directory and makes it the
+// current directory for the fixture's lifetime.  Entries are relative paths
+// using '/'; a trailing '/' (or "/.") makes an empty directory.  The list is
+// terminated by nullptr.
+class fs_fixture
+{
+public:
+                        fs_fixture(const char** fs=nullptr);
+                        ~fs_fixture();
+    const char*         get_root() const;
+
+private:
+    void                clean(const char* path);
+    str<280>            m_root;
+    str<280>            m_prev_dir;
+};
@@ -0,0 +1,394 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "fs_fixture.h"
+#include "line_editor_tester.h"
+#include "setting_fixture.h"
+
+#include <core/base.h>
+#include <core/settings.h>
+#include <core/str.h>
+#include <lib/match_generator.h>
+
+#include <readline/history.h>
+
+extern "C" {
+#include <compat/history_index.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+//------------------------------------------------------------------------------
+TEST_CASE("Line editor")
+{
+    line_editor_tester tester;
+
+    SECTION("Typing")
+    {
+        tester.set_input("abc 123");
+        tester.set_expected_output("abc 123");
+        tester.run();
+    }
+
+    SECTION("Editing")
+    {
+        tester.set_input("abcd\b\x02" "X");     // backspace, back a char, insert
+        tester.set_expected_output("abXc");
+        tester.run();
+    }
+
+    SECTION("Reuse")
+    {
+        tester.set_input("first");
+        tester.set_expected_output("first");
+        tester.run();
+
+        tester.set_input("second");
+        tester.set_expected_output("second");
+        tester.run();
+    }
+
+    SECTION("Terminal output")
+    {
+        test_terminal_out& out = tester.get_terminal_out();
+        out.reset();
+
+        tester.begin_line();
+        tester.press("xyzzy");
+
+        str<> line;
+        REQUIRE(tester.end_line(line));
+        REQUIRE(line.equals("xyzzy"));
+
+        REQUIRE(out.get_stats().writes > 0);
+        REQUIRE(out.get_stats().bytes >= 5);
+        REQUIRE(strstr(out.get_output(), "xyzzy") != nullptr);
+    }
+
+    SECTION("Paste")
+    {
+        tester.begin_line();
+        tester.press("echo ");
+        tester.paste("one two three four five six seven eight nine ten");
+
+        str<> line;
+        tester.press("\x1f");                  // undo; the paste is one edit
+        REQUIRE(tester.end_line(line));
+        REQUIRE(line.equals("echo "));
+
+        // Quoted-insert is waiting for a key, so the paste goes in as keys.
+        tester.begin_line();
+        tester.press("\x16");
+        tester.paste("ab\x01");                // a is quoted, ^A is beginning-of-line
+        REQUIRE(tester.end_line(line));
+        REQUIRE(line.equals("ab"));
+    }
+}
+
+
+
+//------------------------------------------------------------------------------
+class keystroke_timer
+{
+public:
+                        keystroke_timer(line_editor_tester& tester) : m_tester(tester) {}
+    void                press(const char* keys);
+    void                report(const char* label);
+
+private:
+    typedef std::chrono::steady_clock clock;
+    line_editor_tester& m_tester;
+    std::vector<long long> m_samples;
+};
+
+//------------------------------------------------------------------------------
+void keystroke_timer::press(const char* keys)
+{
+    auto start = clock::now();
+    m_tester.press(keys);
+    auto elapsed = clock::now() - start;
+    m_samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+//------------------------------------------------------------------------------
+void keystroke_timer::report(const char* label)
+{
+    if (m_samples.empty())
+        return;
+
+    std::sort(m_samples.begin(), m_samples.end());
+    auto percentile = [&] (int p) {
+        size_t index = (m_samples.size() - 1) * p / 100;
+        return m_samples[index] / 1000.0;
+    };
+
+    printf("%-12s %6d keys  p50 %8.1f us  p90 %8.1f us  p99 %8.1f us  max %8.1f us\n",
+        label, int(m_samples.size()), percentile(50), percentile(90), percentile(99),
+        percentile(100));
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Line editor benchmark", "[.benchmark]")
+{
+    static const int file_count = 2000;
+    static const int history_count = 5000;
+    static const int repeats = 50;
+
+    std::vector<str_moveable> names;
+    for (int i = 0; i < file_count; ++i)
+    {
+        str<64> name;
+        name.format("file_%05d.txt", i);
+        names.emplace_back(name.c_str());
+    }
+    names.emplace_back("dir/");
+
+    std::vector<const char*> fs;
+    for (const auto& name : names)
+        fs.push_back(name.c_str());
+    fs.push_back(nullptr);
+
+    fs_fixture fixture(fs.data());
+
+    line_editor_tester tester;
+    tester.get_editor()->add_generator(file_match_generator());
+
+    static const char* const kill_line = "\x01\x0b";    // beginning-of-line, kill-line
+    static const char* const abort = "\x07";
+
+    // Typing; one keystroke at a time into an ordinary command line.
+    {
+        static const char command[] = "git log --oneline --graph --decorate origin/master..HEAD";
+
+        keystroke_timer timer(tester);
+        tester.begin_line();
+        for (int r = 0; r < repeats; ++r)
+        {
+            for (const char* c = command; *c; ++c)
+            {
+                char key[2] = { *c };
+                timer.press(key);
+            }
+            tester.press(kill_line);
+        }
+
+        str<> line;
+        tester.end_line(line);
+        timer.report("typing");
+    }
+
+    // Tab completion; each Tab completes a unique file name in a directory
+    // with a couple of thousand entries.
+    {
+        keystroke_timer timer(tester);
+        tester.begin_line();
+        for (int r = 0; r < repeats * 4; ++r)
+        {
+            str<64> prefix;
+            prefix.format("type file_%05d.t", (r * 37) % file_count);
+            tester.press(prefix.c_str());
+            timer.press(DO_COMPLETE);
+            tester.press(kill_line);
+        }
+
+        str<> line;
+        tester.end_line(line);
+        timer.report("tab");
+    }
+
+    // Incremental history search; Ctrl-R and then the search text.
+    {
+        clear_history();
+        for (int i = 0; i < history_count; ++i)
+        {
+            str<64> entry;
+            entry.format("echo history entry %d && dir /b", i);
+            add_history(entry.c_str());
+        }
+
+        keystroke_timer timer(tester);
+        tester.begin_line();
+        for (int r = 0; r < repeats; ++r)
+        {
+            str<16> needle;
+            needle.format("entry %d", (r * 97) % history_count);
+
+            timer.press("\x12");
+            for (const char* c = needle.c_str(); *c; ++c)
+            {
+                char key[2] = { *c };
+                timer.press(key);
+            }
+            tester.press(abort);
+            tester.press(kill_line);
+        }
+
+        str<> line;
+        tester.end_line(line);
+        timer.report("history");
+
+        clear_history();
+    }
+
+    // Pasting; a megabyte in one go, then a smaller paste fed through as keys
+    // for comparison.
+    {
+        std::vector<char> text(1 << 20);
+        for (size_t i = 0; i < text.size(); ++i)
+            text[i] = "abcdefghijklmnopqrstuvwxyz "[i % 27];
+        text.back() = '\0';
+
+        typedef std::chrono::steady_clock clock;
+        auto to_ms = [] (clock::duration d) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+        };
+
+        str<> line;
+
+        tester.begin_line();
+        auto start = clock::now();
+        tester.paste(text.data());
+        double paste_ms = to_ms(clock::now() - start);
+        tester.end_line(line);
+
+        static const int keyed_size = 16 << 10;
+        text[keyed_size] = '\0';
+
+        tester.begin_line();
+        start = clock::now();
+        tester.press(text.data());
+        double keyed_ms = to_ms(clock::now() - start);
+        tester.end_line(line);
+
+        printf("%-12s %6d KB   %10.1f ms  (%.3f ms/KB)\n", "paste", int(text.size() >> 10), paste_ms, paste_ms / (text.size() >> 10));
+        printf("%-12s %6d KB   %10.1f ms  (%.3f ms/KB)\n", "paste keys", keyed_size >> 10, keyed_ms, keyed_ms / (keyed_size >> 10));
+    }
+
+    // Long lines; keystrokes at the end of a 10 KB pipeline, and then in the
+    // middle of it.
+    {
+        line_editor::desc desc(nullptr, nullptr, nullptr);
+        desc.command_delims = "&|";
+        line_editor_tester long_tester(desc);
+
+        str<> half;
+        while (half.length() < (5 << 10))
+            half << "findstr /i \"some text\" file.txt | sort /r & ";
+
+        keystroke_timer end_timer(long_tester);
+        long_tester.begin_line();
+        long_tester.paste(half.c_str());
+        long_tester.paste(half.c_str());
+        for (int r = 0; r < repeats * 4; ++r)
+        {
+            char key[2] = { "abc "[r & 3] };
+            end_timer.press(key);
+        }
+
+        keystroke_timer middle_timer(long_tester);
+        long_tester.press("\x01");
+        long_tester.paste(half.c_str());
+        for (int r = 0; r < repeats * 4; ++r)
+        {
+            char key[2] = { "abc "[r & 3] };
+            middle_timer.press(key);
+        }
+
+        str<> line;
+        long_tester.end_line(line);
+        end_timer.report("long end");
+        middle_timer.report("long middle");
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("History search benchmark", "[.benchmark]")
+{
+    static const int history_count = 1000000;
+    static const int searches = 100;
+
+    static const char* const c_commands[] = {
+        "git log --oneline -n %d",
+        "cd c:\\projects\\build_%d",
+        "msbuild /m /p:BuildNumber=%d solution.sln",
+        "echo history entry %d && dir /b",
+        "findstr /s /i \"error %d\" *.log",
+    };
+
+    clear_history();
+    for (int i = 0; i < history_count; ++i)
+    {
+        str<128> entry;
+        entry.format(c_commands[i % sizeof_array(c_commands)], i);
+        add_history(entry.c_str());
+    }
+
+    static const char* settings[] = { "history.search_index", "false", nullptr };
+    setting_fixture search_settings(settings);
+    setting* search_index = settings::find("history.search_index");
+
+    static const char* const kill_line = "\x01\x0b";    // beginning-of-line, kill-line
+    static const char* const abort = "\x07";
+
+    typedef std::chrono::steady_clock clock;
+    auto to_ms = [] (clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+
+    line_editor_tester tester;
+    for (int indexed = 0; indexed <= 1; ++indexed)
+    {
+        search_index->set(indexed ? "true" : "false");
+        history_search_indexed = indexed;
+
+        // history_search() from the end of the history backwards.  The first
+        // search also builds the index, so it's timed on its own.
+        auto search = [] (int r) {
+            str<32> needle;
+            needle.format("BuildNumber=%d ", ((r * 9973) % (history_count / 5)) * 5 + 2);
+            history_set_pos(history_length - 1);
+            return history_search(needle.c_str(), -1);
+        };
+
+        auto start = clock::now();
+        search(0);
+        double first_ms = to_ms(clock::now() - start);
+
+        int found = 0;
+        start = clock::now();
+        for (int r = 1; r <= searches; ++r)
+            found += (search(r) >= 0);
+        double search_ms = to_ms(clock::now() - start);
+
+        printf("%-12s %6d lines  first %8.1f ms  then %8.2f ms per search (%d found)\n",
+            indexed ? "search idx" : "search", history_length, first_ms,
+            search_ms / searches, found);
+
+        // Ctrl-R and then the search text, a keystroke at a time.
+        keystroke_timer timer(tester);
+        tester.begin_line();
+        for (int r = 0; r < searches / 10; ++r)
+        {
+            str<16> needle;
+            needle.format("build_%d", ((r * 9973) % (history_count / 5)) * 5 + 1);
+
+            timer.press("\x12");
+            for (const char* c = needle.c_str(); *c; ++c)
+            {
+                char key[2] = { *c };
+                timer.press(key);
+            }
+            tester.press(abort);
+            tester.press(kill_line);
+        }
+
+        str<> line;
+        tester.end_line(line);
+        timer.report(indexed ? "isearch idx" : "isearch");
+    }
+
+    clear_history();
+}
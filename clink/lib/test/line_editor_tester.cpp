@@ -0,0 +1,242 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "line_editor_tester.h"
+
+#include <core/str_compare.h>
+#include <lib/matches.h>
+#include <terminal/key_tester.h>
+#include <terminal/printer.h>
+
+//------------------------------------------------------------------------------
+void test_terminal_in::set_input(const char* input)
+{
+    m_read = (input && *input) ? input : nullptr;
+    m_paste = nullptr;
+}
+
+//------------------------------------------------------------------------------
+void test_terminal_in::set_paste(const char* text)
+{
+    m_read = nullptr;
+    m_paste = (text && *text) ? text : nullptr;
+}
+
+//------------------------------------------------------------------------------
+int test_terminal_in::read()
+{
+    if (m_paste != nullptr)
+    {
+        const char* paste = m_paste;
+        m_paste = nullptr;
+
+        if (m_keys != nullptr && m_keys->accepts_paste())
+        {
+            m_pasted = paste;
+            return terminal_in::input_paste;
+        }
+
+        m_read = paste;
+    }
+
+    if (m_read == nullptr)
+        return terminal_in::input_none;
+
+    unsigned char c = *m_read++;
+    if (!*m_read)
+        m_read = nullptr;
+
+    return c;
+}
+
+//------------------------------------------------------------------------------
+const char* test_terminal_in::read_paste()
+{
+    return m_pasted;
+}
+
+//------------------------------------------------------------------------------
+key_tester* test_terminal_in::set_key_tester(key_tester* keys)
+{
+    key_tester* ret = m_keys;
+    m_keys = keys;
+    return ret;
+}
+
+
+
+//------------------------------------------------------------------------------
+void test_terminal_out::reset()
+{
+    m_output.clear();
+    m_state.reset();
+    m_stats = {};
+}
+
+//------------------------------------------------------------------------------
+void test_terminal_out::write(const char* chars, int length)
+{
+    ++m_stats.writes;
+    m_stats.bytes += length;
+    m_output.concat(chars, length);
+
+    ecma48_iter iter(chars, m_state, length);
+    while (const ecma48_code& code = iter.next())
+    {
+        switch (code.get_type())
+        {
+        case ecma48_code::type_c0:
+            if (code.get_code() != ecma48_code::c0_esc)
+                ++m_stats.control_codes;
+            break;
+
+        case ecma48_code::type_c1:
+        case ecma48_code::type_icf:
+            ++m_stats.control_codes;
+            break;
+        }
+    }
+}
+
+
+
+//------------------------------------------------------------------------------
+line_editor_tester::line_editor_tester()
+{
+    line_editor::desc desc(nullptr, nullptr, nullptr);
+    create_line_editor(desc);
+}
+
+//------------------------------------------------------------------------------
+line_editor_tester::line_editor_tester(const line_editor::desc& desc)
+{
+    create_line_editor(desc);
+}
+
+//------------------------------------------------------------------------------
+line_editor_tester::~line_editor_tester()
+{
+    line_editor_destroy(m_editor);
+    delete m_printer;
+}
+
+//------------------------------------------------------------------------------
+void line_editor_tester::create_line_editor(const line_editor::desc& desc)
+{
+    m_printer = new printer(m_terminal_out);
+
+    line_editor::desc inner_desc(desc);
+    inner_desc.input = &m_terminal_in;
+    inner_desc.output = &m_terminal_out;
+    inner_desc.printer = m_printer;
+    m_editor = line_editor_create(inner_desc);
+    m_editor->add_module(m_match_catch);
+}
+
+//------------------------------------------------------------------------------
+void line_editor_tester::set_input(const char* input)
+{
+    m_input = input;
+}
+
+//------------------------------------------------------------------------------
+void line_editor_tester::set_expected_matches_list(const char* const* expected)
+{
+    m_expected_matches.clear();
+    for (; *expected; ++expected)
+        m_expected_matches.push_back(*expected);
+
+    m_has_matches = true;
+}
+
+//------------------------------------------------------------------------------
+void line_editor_tester::set_expected_output(const char* expected)
+{
+    m_expected_output = expected;
+}
+
+//------------------------------------------------------------------------------
+void line_editor_tester::run()
+{
+    REQUIRE((m_has_matches || m_expected_output != nullptr));
+    REQUIRE(m_input != nullptr);
+
+    begin_line();
+    press(m_input);
+
+    if (m_has_matches)
+    {
+        // Generating and selecting matches is deferred until they're needed.
+        m_editor->update_matches();
+
+        const matches* matches = m_match_catch.m_matches;
+        REQUIRE(matches != nullptr);
+
+        unsigned int match_count = matches->get_match_count();
+        REQUIRE(m_expected_matches.size() == match_count);
+
+        matches_iter iter = matches->get_iter();
+        while (iter.next())
+        {
+            bool found = false;
+            for (auto i = m_expected_matches.begin(); i != m_expected_matches.end(); ++i)
+            {
+                if (str_compare(*i, iter.get_match()) == -1)
+                {
+                    m_expected_matches.erase(i);
+                    found = true;
+                    break;
+                }
+            }
+
+            REQUIRE(found);
+        }
+
+        REQUIRE(m_expected_matches.empty());
+    }
+
+    str<> line;
+    REQUIRE(end_line(line));
+    if (m_expected_output != nullptr)
+        REQUIRE(line.equals(m_expected_output));
+
+    // Tidy up so the tester can be reused.
+    m_input = nullptr;
+    m_expected_output = nullptr;
+    m_expected_matches.clear();
+    m_has_matches = false;
+}
+
+//------------------------------------------------------------------------------
+void line_editor_tester::begin_line()
+{
+    // The first update starts the line without reading any input.
+    m_terminal_in.set_input(nullptr);
+    REQUIRE(m_editor->update());
+}
+
+//------------------------------------------------------------------------------
+void line_editor_tester::press(const char* keys)
+{
+    m_terminal_in.set_input(keys);
+    while (m_terminal_in.has_input())
+        if (!m_editor->update())
+            break;
+}
+
+//------------------------------------------------------------------------------
+void line_editor_tester::paste(const char* text)
+{
+    m_terminal_in.set_paste(text);
+    while (m_terminal_in.has_input())
+        if (!m_editor->update())
+            break;
+}
+
+//------------------------------------------------------------------------------
+bool line_editor_tester::end_line(str_base& out)
+{
+    m_terminal_in.set_input(nullptr);
+    return m_editor->get_line(out);
+}
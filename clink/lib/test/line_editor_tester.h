@@ -0,0 +1,138 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/str.h>
+#include <lib/editor_module.h>
+#include <lib/line_editor.h>
+#include <terminal/ecma48_iter.h>
+#include <terminal/terminal_in.h>
+#include <terminal/terminal_out.h>
+
+#include <vector>
+
+class matches;
+class printer;
+
+//------------------------------------------------------------------------------
+// Replays a script of keystrokes one byte at a time, then reports no input.  A
+// paste is handed over whole if the editor accepts it, otherwise it's replayed
+// as keystrokes like any other input.
+class test_terminal_in
+    : public terminal_in
+{
+public:
+    void                set_input(const char* input);
+    void                set_paste(const char* text);
+    bool                has_input() const { return (m_read != nullptr || m_paste != nullptr); }
+    virtual void        begin() override {}
+    virtual void        end() override {}
+    virtual void        select() override {}
+    virtual int         read() override;
+    virtual const char* read_paste() override;
+    virtual key_tester* set_key_tester(key_tester* keys) override;
+
+private:
+    const char*         m_read = nullptr;
+    const char*         m_paste = nullptr;
+    const char*         m_pasted = "";
+    key_tester*         m_keys = nullptr;
+};
+
+//------------------------------------------------------------------------------
+// A terminal with no screen behind it.  It keeps what's written to it and
+// counts writes, flushes, and the control codes that move the cursor or
+// change the display.
+class test_terminal_out
+    : public terminal_out
+{
+public:
+    struct stats
+    {
+        unsigned int    writes;
+        unsigned int    bytes;
+        unsigned int    flushes;
+        unsigned int    control_codes;
+    };
+
+    void                reset();
+    const stats&        get_stats() const { return m_stats; }
+    const char*         get_output() const { return m_output.c_str(); }
+    virtual void        open() override {}
+    virtual void        begin() override {}
+    virtual void        end() override {}
+    virtual void        close() override {}
+    virtual void        write(const char* chars, int length) override;
+    virtual bool        get_line_text(int line, str_base& out) const override { return false; }
+    virtual void        flush() override { ++m_stats.flushes; }
+    virtual int         get_columns() const override { return 80; }
+    virtual int         get_rows() const override { return 25; }
+    virtual int         is_line_default_color(int line) const override { return -1; }
+    virtual int         line_has_color(int line, const BYTE* attrs, int num_attrs, BYTE mask=0xff) const override { return -1; }
+    virtual int         find_line(int starting_line, int distance, const char* text, find_line_mode mode, const BYTE* attrs=nullptr, int num_attrs=0, BYTE mask=0xff) const override { return -1; }
+
+private:
+    str_moveable        m_output;
+    ecma48_state        m_state;
+    stats               m_stats = {};
+};
+
+//------------------------------------------------------------------------------
+class line_editor_tester
+{
+public:
+                        line_editor_tester();
+                        line_editor_tester(const line_editor::desc& desc);
+                        ~line_editor_tester();
+    line_editor*        get_editor() const { return m_editor; }
+    test_terminal_out&  get_terminal_out() { return m_terminal_out; }
+    void                set_input(const char* input);
+    template <class ...T> void set_expected_matches(T... t);
+    void                set_expected_matches_list(const char* const* expected);
+    void                set_expected_output(const char* expected);
+    void                run();
+
+    // For driving the editor a keystroke at a time.
+    void                begin_line();
+    void                press(const char* keys);
+    void                paste(const char* text);
+    bool                end_line(str_base& out);
+
+private:
+    // The matches live in the editor, so this catches where they are when the
+    // line begins so they can be inspected once the input's done.
+    class match_catch
+        : public editor_module
+    {
+    public:
+        virtual void    bind_input(binder& binder) override {}
+        virtual void    on_begin_line(const context& context) override { m_matches = &context.matches; }
+        virtual void    on_end_line() override {}
+        virtual void    on_input(const input& input, result& result, const context& context) override {}
+        virtual void    on_terminal_resize(int columns, int rows, const context& context) override {}
+        const matches*  m_matches = nullptr;
+    };
+
+    void                create_line_editor(const line_editor::desc& desc);
+    match_catch         m_match_catch;
+    test_terminal_in    m_terminal_in;
+    test_terminal_out   m_terminal_out;
+    printer*            m_printer = nullptr;
+    line_editor*        m_editor = nullptr;
+    std::vector<const char*> m_expected_matches;
+    const char*         m_input = nullptr;
+    const char*         m_expected_output = nullptr;
+    bool                m_has_matches = false;
+};
+
+//------------------------------------------------------------------------------
+template <class ...T>
+void line_editor_tester::set_expected_matches(T... t)
+{
+    const char* expected[] = { t..., nullptr };
+    set_expected_matches_list(expected);
+}
+
+//------------------------------------------------------------------------------
+#define DO_COMPLETE "\t"
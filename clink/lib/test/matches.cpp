@@ -0,0 +1,462 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "fs_fixture.h"
+#include "line_editor_tester.h"
+#include "line_state.h"
+#include "match_generator.h"
+#include "match_pipeline.h"
+#include "matches_impl.h"
+#include "setting_fixture.h"
+
+#include <core/array.h>
+#include <core/os.h>
+#include <core/settings.h>
+#include <core/str.h>
+
+#include <psapi.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#pragma comment(lib, "psapi.lib")
+
+extern char* lend_match(const char* match);
+extern void free_match(char* match);
+
+//------------------------------------------------------------------------------
+TEST_CASE("Match store")
+{
+    matches_impl matches;
+    match_builder builder(matches);
+
+    SECTION("More than 64K matches")
+    {
+        const unsigned int count = 100000;
+
+        str<> tmp;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            tmp.format("match_%u", i);
+            REQUIRE(builder.add_match(tmp.c_str(), match_type::word));
+        }
+
+        REQUIRE(matches.get_match_count() == count);
+
+        unsigned int i = 0;
+        matches_iter iter = matches.get_iter();
+        while (iter.next())
+            ++i;
+        REQUIRE(i == count);
+    }
+
+    SECTION("Larger than a page")
+    {
+        // str<> can't hold this much, so use a plain buffer.
+        std::vector<char> large(0x40000, 'x');
+        large.back() = '\0';
+
+        REQUIRE(builder.add_match("small", match_type::word));
+        REQUIRE(builder.add_match(large.data(), match_type::word));
+        REQUIRE(builder.add_match("after", match_type::word));
+        REQUIRE(matches.get_match_count() == 3);
+
+        matches_iter iter = matches.get_iter();
+        REQUIRE(iter.next());
+        REQUIRE(strcmp(iter.get_match(), "small") == 0);
+        REQUIRE(iter.next());
+        REQUIRE(strcmp(iter.get_match(), large.data()) == 0);
+        REQUIRE(iter.next());
+        REQUIRE(strcmp(iter.get_match(), "after") == 0);
+        REQUIRE(!iter.next());
+    }
+
+    SECTION("Lent matches outlive reset")
+    {
+        REQUIRE(builder.add_match("abc", match_type::file));
+        REQUIRE(builder.add_match("def", match_type::dir));
+
+        matches_iter iter = matches.get_iter();
+        REQUIRE(iter.next());
+        char* lent = lend_match(iter.get_match());
+        REQUIRE(lent != nullptr);
+        REQUIRE(lent[0] == char(match_type::file));
+        REQUIRE(strcmp(lent + 1, "abc") == 0);
+
+        REQUIRE(lend_match("not from the store") == nullptr);
+
+        match_pipeline(matches).reset();
+        REQUIRE(builder.add_match("xyz", match_type::word));
+        REQUIRE(strcmp(lent + 1, "abc") == 0);
+
+        free_match(lent);
+    }
+
+    SECTION("Loans returned on another thread")
+    {
+        const unsigned int count = 20000;
+
+        str<> tmp;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            tmp.format("match_%u", i);
+            REQUIRE(builder.add_match(tmp.c_str(), match_type::word));
+        }
+
+        std::vector<char*> lent;
+        matches_iter iter = matches.get_iter();
+        while (iter.next())
+            lent.push_back(lend_match(iter.get_match()));
+        REQUIRE(lent.size() == count);
+
+        // The loans come back while the store fills up new pages.
+        match_pipeline(matches).reset();
+        bool intact = true;
+        std::thread returner([&] () {
+            str<> expected;
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                expected.format("match_%u", i);
+                intact &= (strcmp(lent[i] + 1, expected.c_str()) == 0);
+                free_match(lent[i]);
+            }
+        });
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            tmp.format("other_%u", i);
+            builder.add_match(tmp.c_str(), match_type::word);
+        }
+
+        returner.join();
+        REQUIRE(intact);
+        REQUIRE(matches.get_match_count() == count);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Match store benchmark", "[.benchmark]")
+{
+    static const unsigned int count = 1000000;
+
+    PROCESS_MEMORY_COUNTERS before = { sizeof(before) };
+    GetProcessMemoryInfo(GetCurrentProcess(), &before, sizeof(before));
+
+    PROCESS_MEMORY_COUNTERS after = { sizeof(after) };
+    std::chrono::steady_clock::duration add_time, iter_time;
+    {
+        matches_impl matches;
+        match_builder builder(matches);
+
+        str<> tmp;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            tmp.format("build_output\\obj\\module_%07u.obj", i);
+            builder.add_match(tmp.c_str(), match_type::file);
+        }
+        add_time = std::chrono::steady_clock::now() - start;
+        REQUIRE(matches.get_match_count() == count);
+
+        unsigned int length = 0;
+        start = std::chrono::steady_clock::now();
+        matches_iter iter = matches.get_iter();
+        while (iter.next())
+            length += (unsigned int)strlen(iter.get_match());
+        iter_time = std::chrono::steady_clock::now() - start;
+        REQUIRE(length > count);
+
+        GetProcessMemoryInfo(GetCurrentProcess(), &after, sizeof(after));
+    }
+
+    auto to_ms = [] (std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+
+    double add_ms = to_ms(add_time);
+    printf("match store: %u matches added in %.1f ms (%.1f M/s), iterated in %.1f ms\n",
+        count, add_ms, count / add_ms / 1000.0, to_ms(iter_time));
+    printf("match store: peak working set %.1f MB -> %.1f MB\n",
+        before.PeakWorkingSetSize / 1048576.0, after.PeakWorkingSetSize / 1048576.0);
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Match selection")
+{
+    matches_impl matches;
+    match_builder builder(matches);
+    match_pipeline pipeline(matches);
+
+    const char* names[] = { "abc", "abd", "abcd", "xyz", "ab", "abcde" };
+    for (const char* name : names)
+        REQUIRE(builder.add_match(name, match_type::word));
+
+    SECTION("Narrowing")
+    {
+        pipeline.select("a");
+        REQUIRE(matches.get_match_count() == 5);
+        pipeline.select("ab");
+        REQUIRE(matches.get_match_count() == 5);
+        pipeline.select("abc");
+        REQUIRE(matches.get_match_count() == 3);
+        pipeline.select("abcd");
+        REQUIRE(matches.get_match_count() == 2);
+        pipeline.select("abcq");
+        REQUIRE(matches.get_match_count() == 0);
+    }
+
+    SECTION("Backing up")
+    {
+        pipeline.select("abcd");
+        REQUIRE(matches.get_match_count() == 2);
+        pipeline.select("abc");
+        REQUIRE(matches.get_match_count() == 3);
+        pipeline.select("abce");
+        REQUIRE(matches.get_match_count() == 0);
+        pipeline.select("ab");
+        REQUIRE(matches.get_match_count() == 5);
+        pipeline.select("abd");
+        REQUIRE(matches.get_match_count() == 1);
+        matches_iter iter = matches.get_iter();
+        REQUIRE(iter.next());
+        REQUIRE(strcmp(iter.get_match(), "abd") == 0);
+        pipeline.select("");
+        REQUIRE(matches.get_match_count() == 6);
+        pipeline.select("x");
+        REQUIRE(matches.get_match_count() == 1);
+    }
+}
+
+
+
+//------------------------------------------------------------------------------
+class test_generator
+    : public match_generator
+{
+public:
+                        test_generator(const char* prefix, bool parallel, bool stop, int delay_ms=0)
+                        : m_prefix(prefix), m_parallel(parallel), m_stop(stop), m_delay_ms(delay_ms) {}
+
+    virtual bool generate(const line_state& line, match_builder& builder) override
+    {
+        ++m_calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_delay_ms));
+
+        str<16> match;
+        for (int i = 0; i < 3; ++i)
+        {
+            match.format("%s%d", m_prefix, i);
+            builder.add_match(match.c_str(), match_type::word);
+        }
+
+        if (m_until_cancelled)
+        {
+            auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (!builder.is_cancelled() && std::chrono::steady_clock::now() < give_up)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            m_saw_cancel = builder.is_cancelled();
+        }
+
+        return m_stop;
+    }
+
+    virtual void get_word_break_info(const line_state& line, word_break_info& info) const override {}
+
+    virtual bool get_parallel_task(const line_state& line, parallel_task& task) override
+    {
+        if (m_parallel)
+            task = [this, &line] (match_builder& builder) { return generate(line, builder); };
+        return m_parallel;
+    }
+
+    std::atomic<int>    m_calls { 0 };
+    bool                m_until_cancelled = false;
+    bool                m_saw_cancel = false;
+
+private:
+    const char*         m_prefix;
+    bool                m_parallel;
+    bool                m_stop;
+    int                 m_delay_ms;
+};
+
+//------------------------------------------------------------------------------
+static void get_match_list(const matches_impl& matches, str_base& out)
+{
+    out.clear();
+    matches_iter iter = matches.get_iter();
+    while (iter.next())
+    {
+        if (out.length())
+            out << " ";
+        out << iter.get_match();
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Parallel match generators")
+{
+    static const char* settings[] = { "match.parallel", "true", nullptr };
+    setting_fixture parallel(settings);
+
+    std::vector<word> words;
+    word end_word = { 0, 0, false, false, false, 0 };
+    words.push_back(end_word);
+    line_state line("", 0, 0, words);
+
+    matches_impl matches;
+    match_pipeline pipeline(matches);
+    fixed_array<match_generator*, 8> generators;
+    str<> list;
+
+    SECTION("Priority order")
+    {
+        // Higher priority generators finish last, but still merge first.
+        test_generator a("a", true, false, 60);
+        test_generator b("b", false, false);
+        test_generator c("c", true, false, 30);
+        test_generator d("d", true, false);
+        *generators.push_back() = &a;
+        *generators.push_back() = &b;
+        *generators.push_back() = &c;
+        *generators.push_back() = &d;
+
+        pipeline.generate(line, generators);
+        get_match_list(matches, list);
+        REQUIRE(list.equals("a0 a1 a2 b0 b1 b2 c0 c1 c2 d0 d1 d2"));
+    }
+
+    SECTION("Returning true stops lower priority generators")
+    {
+        test_generator a("a", false, false);
+        test_generator b("b", true, true, 30);
+        test_generator c("c", false, false);
+        test_generator d("d", true, false);
+        d.m_until_cancelled = true;
+        *generators.push_back() = &a;
+        *generators.push_back() = &b;
+        *generators.push_back() = &c;
+        *generators.push_back() = &d;
+
+        auto start = std::chrono::steady_clock::now();
+        pipeline.generate(line, generators);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        get_match_list(matches, list);
+        REQUIRE(list.equals("a0 a1 a2 b0 b1 b2"));
+        REQUIRE(c.m_calls == 0);
+
+        // 'd' may or may not have started, but if it did it was cancelled
+        // rather than waited out.
+        REQUIRE((d.m_calls == 0 || d.m_saw_cancel));
+        REQUIRE(elapsed < std::chrono::seconds(5));
+    }
+
+    SECTION("File matches")
+    {
+        static const char* fs[] = { "file", "dir/one", "dir/two", nullptr };
+        fs_fixture fixture(fs);
+
+        std::vector<word> dir_words;
+        word dir_word = { 0, 4, false, false, false, 0 };
+        dir_words.push_back(dir_word);
+        line_state dir_line("dir\\", 4, 0, dir_words);
+
+        test_generator a("a", true, false, 30);
+        *generators.push_back() = &a;
+        *generators.push_back() = &file_match_generator();
+
+        pipeline.generate(dir_line, generators);
+        get_match_list(matches, list);
+        REQUIRE(list.equals("a0 a1 a2 dir\\one dir\\two"));
+
+        // The task has what it needs from the calling thread already, so the
+        // current directory changing before it runs makes no difference.
+        match_generator::parallel_task task;
+        REQUIRE(file_match_generator().get_parallel_task(dir_line, task));
+
+        str<280> temp;
+        os::get_temp_dir(temp);
+        os::set_current_dir(temp.c_str());
+
+        matches_impl task_matches;
+        match_builder builder(task_matches);
+        REQUIRE(task(builder));
+        get_match_list(task_matches, list);
+        REQUIRE(list.equals("dir\\one dir\\two"));
+
+        os::set_current_dir(fixture.get_root());
+    }
+}
+
+
+
+//------------------------------------------------------------------------------
+class count_generator
+    : public match_generator
+{
+public:
+                        count_generator(unsigned int count) : m_count(count) {}
+
+    virtual bool generate(const line_state& line, match_builder& builder) override
+    {
+        str<32> match;
+        for (unsigned int i = 0; i < m_count; ++i)
+        {
+            match.format("match_%06u", i);
+            builder.add_match(match.c_str(), match_type::word);
+        }
+        return true;
+    }
+
+    virtual void get_word_break_info(const line_state& line, word_break_info& info) const override {}
+
+private:
+    unsigned int        m_count;
+};
+
+//------------------------------------------------------------------------------
+TEST_CASE("Zero copy benchmark", "[.benchmark]")
+{
+    static const int repeats = 20;
+    static const char* const kill_line = "\x01\x0b";    // beginning-of-line, kill-line
+
+    static const char* settings[] = { "match.zero_copy", "false", nullptr };
+    setting_fixture zero_copy_settings(settings);
+    setting* zero_copy = settings::find("match.zero_copy");
+
+    for (unsigned int count : { 1000, 10000, 100000 })
+    {
+        count_generator generator(count);
+        line_editor_tester tester;
+        tester.get_editor()->add_generator(generator);
+
+        for (int on = 0; on <= 1; ++on)
+        {
+            zero_copy->set(on ? "true" : "false");
+
+            // The first Tab only inserts the common prefix, so nothing's
+            // listed and the time is mostly handing the matches to Readline.
+            std::chrono::steady_clock::duration total = {};
+            tester.begin_line();
+            for (int r = 0; r < repeats; ++r)
+            {
+                tester.press("m");
+                auto start = std::chrono::steady_clock::now();
+                tester.press(DO_COMPLETE);
+                total += std::chrono::steady_clock::now() - start;
+                tester.press(kill_line);
+            }
+
+            str<> line;
+            tester.end_line(line);
+
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(total).count();
+            printf("zero copy %-3s %6u matches  %8.2f ms per Tab\n",
+                on ? "on" : "off", count, us / 1000.0 / repeats);
+        }
+    }
+}
@@ -0,0 +1,277 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "line_state.h"
+#include "rl/rl_buffer.h"
+
+#include <core/base.h>
+#include <core/os.h>
+#include <core/path.h>
+#include <core/str.h>
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Adds a doskey alias for this executable, as cmd.exe's doskey would, and
+// removes it again when it goes out of scope.
+class alias_fixture
+{
+public:
+                        alias_fixture(const char* name, const char* text);
+                        ~alias_fixture();
+
+private:
+    void                set(const wchar_t* text);
+    wstr<32>            m_name;
+};
+
+//------------------------------------------------------------------------------
+alias_fixture::alias_fixture(const char* name, const char* text)
+{
+    m_name = name;
+
+    wstr<32> wtext;
+    wtext = text;
+    set(wtext.c_str());
+}
+
+//------------------------------------------------------------------------------
+alias_fixture::~alias_fixture()
+{
+    set(nullptr);
+}
+
+//------------------------------------------------------------------------------
+void alias_fixture::set(const wchar_t* text)
+{
+    wchar_t exe_path[280];
+    GetModuleFileNameW(nullptr, exe_path, sizeof_array(exe_path));
+
+    wstr<32> exe_name;
+    exe_name = path::get_name(exe_path);
+
+    AddConsoleAliasW(m_name.data(), const_cast<wchar_t*>(text), exe_name.data());
+}
+
+
+
+//------------------------------------------------------------------------------
+static const char* const c_command_delims = "&|";
+
+//------------------------------------------------------------------------------
+static void describe_words(const line_buffer& buffer, collect_words_mode mode, str_base& out)
+{
+    std::vector<word> words;
+    unsigned int command_offset = buffer.collect_words(words, mode);
+
+    out.format("@%u:", command_offset);
+    for (const word& word : words)
+    {
+        str<48> tmp;
+        tmp.format(" %u+%u%s%s%s(%d)",
+            word.offset, word.length,
+            word.command_word ? "c" : "",
+            word.is_alias ? "a" : "",
+            word.quoted ? "q" : "",
+            word.delim);
+        out << tmp;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Checks the incremental buffer's words against a buffer with nothing cached,
+// in each collect mode and with the cursor at every position in the line.
+static void check_words(rl_buffer& buffer)
+{
+    static const collect_words_mode modes[] = {
+        collect_words_mode::stop_at_cursor,
+        collect_words_mode::display_filter,
+        collect_words_mode::whole_command,
+    };
+
+    unsigned int cursor = buffer.get_cursor();
+    for (unsigned int i = 0, n = buffer.get_length(); i <= n; ++i)
+    {
+        buffer.set_cursor(i);
+        for (collect_words_mode mode : modes)
+        {
+            rl_buffer fresh(c_command_delims);
+
+            str<> expected;
+            str<> incremental;
+            describe_words(fresh, mode, expected);
+            describe_words(buffer, mode, incremental);
+
+            REQUIRE(incremental.equals(expected.c_str()));
+        }
+    }
+    buffer.set_cursor(cursor);
+}
+
+//------------------------------------------------------------------------------
+static void replace(rl_buffer& buffer, unsigned int from, unsigned int to, const char* text)
+{
+    buffer.remove(from, to);
+    buffer.set_cursor(from);
+    buffer.insert(text);
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Incremental words")
+{
+    alias_fixture alias("al", "dir $*");
+
+    str<> alias_text;
+    REQUIRE(os::get_alias("al", alias_text));
+
+    rl_buffer buffer(c_command_delims);
+    buffer.reset();
+    buffer.begin_line();
+
+    SECTION("Mid-line edits")
+    {
+        buffer.insert("echo one two & copy three four | sort /r");
+        check_words(buffer);
+
+        replace(buffer, 10, 10, "x");           // echo one txwo
+        check_words(buffer);
+
+        replace(buffer, 10, 11, " ");           // echo one t wo
+        check_words(buffer);
+
+        replace(buffer, 10, 11, "");            // echo one two
+        check_words(buffer);
+
+        replace(buffer, 21, 26, "3");           // copy 3 four
+        check_words(buffer);
+
+        replace(buffer, 13, 14, "|");           // two | copy
+        check_words(buffer);
+
+        replace(buffer, 9, 17, "");             // echo one py 3 four
+        check_words(buffer);
+
+        replace(buffer, 0, 0, " ");             // doskey-disabler space
+        check_words(buffer);
+    }
+
+    SECTION("Quotes across a delimiter")
+    {
+        buffer.insert("echo one & echo two & echo three");
+        check_words(buffer);
+
+        replace(buffer, 5, 5, "\"");            // echo "one & echo two & ...
+        check_words(buffer);
+
+        replace(buffer, 16, 16, "\"");          // echo "one & echo" two & ...
+        check_words(buffer);
+
+        replace(buffer, 5, 6, "");              // echo one & echo" two & ...
+        check_words(buffer);
+
+        replace(buffer, 15, 16, "");            // echo one & echo two & ...
+        check_words(buffer);
+
+        replace(buffer, 20, 20, "\"");          // echo two "& echo three
+        check_words(buffer);
+
+        buffer.set_cursor(buffer.get_length());
+        buffer.insert("\"");                    // echo two "& echo three"
+        check_words(buffer);
+    }
+
+    SECTION("Aliased first word")
+    {
+        buffer.insert("al one two & al three");
+        check_words(buffer);
+
+        replace(buffer, 2, 2, "x");             // alx one two & al three
+        check_words(buffer);
+
+        replace(buffer, 2, 3, "");              // al one two & al three
+        check_words(buffer);
+
+        replace(buffer, 1, 2, "");              // a one two & al three
+        check_words(buffer);
+
+        replace(buffer, 1, 1, "l");             // al one two & al three
+        check_words(buffer);
+
+        replace(buffer, 13, 13, "\"");          // al one two & "al three
+        check_words(buffer);
+
+        replace(buffer, 13, 14, "");            // al one two & al three
+        check_words(buffer);
+
+        replace(buffer, 14, 14, "&");           // al one two & a&l three
+        check_words(buffer);
+
+        replace(buffer, 14, 15, "");            // al one two & al three
+        check_words(buffer);
+    }
+
+    SECTION("Quote in an alias")
+    {
+        // The alias isn't tokenised but its quote still opens a quote for
+        // the command tokeniser.
+        alias_fixture quoted("q\"", "echo $*");
+
+        buffer.insert("q\" one & two");
+        check_words(buffer);
+
+        replace(buffer, 4, 4, "x");             // q" oxne & two
+        check_words(buffer);
+
+        buffer.set_cursor(buffer.get_length());
+        buffer.insert(" \" & three");           // q" oxne & two " & three
+        check_words(buffer);
+
+        replace(buffer, 1, 2, "");              // q oxne & two " & three
+        check_words(buffer);
+    }
+
+    SECTION("Cursor in the alias")
+    {
+        buffer.insert("al one & al two");
+
+        // Move the cursor around inside each alias word between collects, so
+        // the cache sees the cut short lookups before and after the edits.
+        for (unsigned int i : { 0, 1, 2, 9, 10, 11 })
+        {
+            std::vector<word> words;
+            buffer.set_cursor(i);
+            buffer.collect_words(words, collect_words_mode::stop_at_cursor);
+            check_words(buffer);
+        }
+
+        buffer.set_cursor(1);
+        buffer.insert("x");                     // axl one & al two
+        check_words(buffer);
+
+        buffer.set_cursor(1);
+        buffer.remove(1, 2);                    // al one & al two
+        check_words(buffer);
+
+        buffer.set_cursor(10);
+        buffer.insert(" ");                     // al one & a l two
+        check_words(buffer);
+    }
+
+    SECTION("Alias changes between lines")
+    {
+        buffer.insert("bl one & al two");
+        check_words(buffer);
+
+        {
+            alias_fixture added("bl", "echo $*");
+            buffer.begin_line();
+            check_words(buffer);
+        }
+
+        buffer.begin_line();
+        check_words(buffer);
+    }
+
+    buffer.reset();
+}
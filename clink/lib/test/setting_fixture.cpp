@@ -0,0 +1,33 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "setting_fixture.h"
+
+#include <core/settings.h>
+
+//------------------------------------------------------------------------------
+setting_fixture::setting_fixture(const char** values)
+{
+    for (; values[0] != nullptr; values += 2)
+    {
+        // CHECK rather than REQUIRE, as a throwing constructor wouldn't get
+        // to put back the settings it's already changed.
+        saved_setting saved;
+        saved.target = settings::find(values[0]);
+        CHECK(saved.target != nullptr);
+        if (saved.target == nullptr)
+            continue;
+
+        saved.target->get(saved.value);
+        CHECK(saved.target->set(values[1]));
+        m_saved.push_back(std::move(saved));
+    }
+}
+
+//------------------------------------------------------------------------------
+setting_fixture::~setting_fixture()
+{
+    for (auto i = m_saved.rbegin(), n = m_saved.rend(); i != n; ++i)
+        i->target->set(i->value.c_str());
+}
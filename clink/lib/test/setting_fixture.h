@@ -0,0 +1,29 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/str.h>
+
+#include <vector>
+
+class setting;
+
+//------------------------------------------------------------------------------
+// Sets settings from a nullptr-terminated list of name/value pairs, putting
+// back whatever they were before when it goes out of scope.
+class setting_fixture
+{
+public:
+                        setting_fixture(const char** values);
+                        ~setting_fixture();
+
+private:
+    struct saved_setting
+    {
+        setting*        target;
+        str_moveable    value;
+    };
+
+    std::vector<saved_setting> m_saved;
+};
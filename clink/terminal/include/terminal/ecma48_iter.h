@@ -17,6 +17,7 @@ inline int clink_wcwidth(char32_t c)
 
 //------------------------------------------------------------------------------
 unsigned int cell_count(const char*);
+void clear_cell_count_cache();
 enum ecma48_state_enum;
 
 //------------------------------------------------------------------------------
@@ -144,16 +145,11 @@ public:
     const ecma48_code&  next();
 
 private:
+    void                next_chars();
     bool                next_c1();
-    bool                next_char(int c);
-    bool                next_char_str(int c);
-    bool                next_cmd_str(int c);
-    bool                next_csi_f(int c);
-    bool                next_csi_p(int c);
-    bool                next_esc(int c);
-    bool                next_esc_st(int c);
-    bool                next_unknown(int c);
+    bool                next_step(int c, const char* next);
     str_iter            m_iter;
+    const char*         m_end;
     ecma48_code&        m_code;
     ecma48_state&       m_state;
     int                 m_nested_cmd_str;
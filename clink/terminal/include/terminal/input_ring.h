@@ -0,0 +1,61 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/base.h>
+
+#include <atomic>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// A queue of input bytes with one producer (whatever reads the terminal) and
+// one consumer (the editor), which may be on different threads.  Rather than
+// drop input when full it grows, by chaining on a larger ring for the producer
+// to carry on in while the consumer drains the old one.  Bytes are only
+// dropped when a ring of max_size fills up.
+class input_ring
+    : public no_copy
+{
+public:
+    struct stats
+    {
+        unsigned int    capacity;       // Size of the ring being written to.
+        unsigned int    high_water;     // Most bytes ever pending at once.
+        unsigned int    grows;          // Times a larger ring was chained on.
+        unsigned int    drops;          // Bytes lost because max_size was hit.
+    };
+
+                        input_ring(unsigned int initial_size=64, unsigned int max_size=1 << 20);
+                        ~input_ring();
+
+    // Producer.
+    bool                push(unsigned char value);
+    unsigned int        push(const char* data, unsigned int length);
+
+    // Consumer.
+    bool                pop(unsigned char& out);
+    bool                unget(unsigned char value);
+    void                clear();
+
+    // Either; only a snapshot when the other side is busy.
+    bool                empty() const { return !count(); }
+    unsigned int        count() const;
+    void                get_stats(stats& out) const;
+
+private:
+    struct segment;
+    segment*            grow();
+    void                pushed(unsigned int count);
+    static segment*     new_segment(unsigned int size);
+    segment*            m_head;         // Consumer's.
+    segment*            m_tail;         // Producer's.
+    std::vector<unsigned char> m_unget; // Consumer's.
+    unsigned int        m_max_size;
+    std::atomic<unsigned int> m_pushed;
+    std::atomic<unsigned int> m_popped;
+    std::atomic<unsigned int> m_capacity;
+    std::atomic<unsigned int> m_high_water;
+    std::atomic<unsigned int> m_grows;
+    std::atomic<unsigned int> m_drops;
+};
@@ -13,4 +13,5 @@ public:
     virtual bool    is_bound(const char* seq, int len) = 0;
     virtual bool    translate(const char* seq, int len, str_base& out) { return false; }
     virtual void    set_keyseq_len(int len) {}
+    virtual bool    accepts_paste() { return false; }
 };
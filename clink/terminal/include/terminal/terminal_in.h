@@ -14,6 +14,7 @@ public:
         input_timeout,
         input_abort,
         input_terminal_resize,
+        input_paste,
     };
 
     virtual         ~terminal_in() = default;
@@ -21,5 +22,6 @@ public:
     virtual void    end() = 0;
     virtual void    select() = 0;
     virtual int     read() = 0;
+    virtual const char* read_paste() = 0; // text for the last input_paste.
     virtual key_tester* set_key_tester(key_tester* keys) = 0;
 };
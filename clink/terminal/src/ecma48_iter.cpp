@@ -8,9 +8,10 @@
 #include <core/str_tokeniser.h>
 
 #include <assert.h>
+#include <mutex>
 
 //------------------------------------------------------------------------------
-unsigned int cell_count(const char* in)
+static unsigned int measure_cells(const char* in)
 {
     unsigned int count = 0;
 
@@ -21,11 +22,127 @@ unsigned int cell_count(const char* in)
         if (code.get_type() != ecma48_code::type_chars)
             continue;
 
-        str_iter inner_iter(code.get_pointer(), code.get_length());
-        while (int c = inner_iter.next())
+        // Runs of characters don't contain C0 controls so every ASCII byte in
+        // one is a single cell.
+        const char* ptr = code.get_pointer();
+        const char* end = ptr + code.get_length();
+        while (ptr < end)
+        {
+            if ((unsigned char)*ptr < 0x80)
+            {
+                ++count;
+                ++ptr;
+                continue;
+            }
+
+            str_iter inner_iter(ptr, int(end - ptr));
+            int c = inner_iter.next();
+            if (!c)
+                break;
+
             count += clink_wcwidth(c);
+            ptr = inner_iter.get_pointer();
+        }
+    }
+
+    return count;
+}
+
+//------------------------------------------------------------------------------
+// Remembers the widths of recently measured strings that contain escape codes.
+class cell_count_cache
+{
+public:
+    bool                find(const char* in, unsigned int hash, unsigned int& cells);
+    void                store(const char* in, unsigned int hash, unsigned int cells);
+    void                clear();
+
+private:
+    struct entry
+    {
+        str_moveable    text;
+        unsigned int    hash = 0;
+        unsigned int    cells = 0;
+    };
+
+    static const int    entry_count = 64;
+    entry               m_entries[entry_count];
+    std::mutex          m_mutex;
+};
+
+//------------------------------------------------------------------------------
+bool cell_count_cache::find(const char* in, unsigned int hash, unsigned int& cells)
+{
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return false;
+
+    const entry& entry = m_entries[hash % entry_count];
+    if (entry.hash != hash || strcmp(entry.text.c_str(), in) != 0)
+        return false;
+
+    cells = entry.cells;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void cell_count_cache::store(const char* in, unsigned int hash, unsigned int cells)
+{
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+
+    entry& entry = m_entries[hash % entry_count];
+    entry.text = in;
+    entry.hash = hash;
+    entry.cells = cells;
+}
+
+//------------------------------------------------------------------------------
+void cell_count_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (entry& entry : m_entries)
+    {
+        entry.text.clear();
+        entry.hash = 0;
     }
+}
+
+static cell_count_cache s_cell_count_cache;
 
+//------------------------------------------------------------------------------
+void clear_cell_count_cache()
+{
+    s_cell_count_cache.clear();
+}
+
+//------------------------------------------------------------------------------
+unsigned int cell_count(const char* in)
+{
+    // Printable ASCII is one cell per byte and is by far the most common.
+    const char* ptr = in;
+    while (unsigned((unsigned char)*ptr - 0x20) < 0x60)
+        ++ptr;
+
+    if (!*ptr)
+        return unsigned(ptr - in);
+
+    // Other text is quick enough to measure. Escape codes aren't, and strings
+    // with them (prompts mostly) tend to get measured over and over.
+    if (strchr(ptr, 0x1b) == nullptr)
+        return unsigned(ptr - in) + measure_cells(ptr);
+
+    unsigned int hash = 0x811c9dc5;
+    for (const char* c = in; *c; ++c)
+        hash = (hash ^ (unsigned char)*c) * 0x01000193;
+
+    unsigned int count;
+    if (s_cell_count_cache.find(in, hash, count))
+        return count;
+
+    count = unsigned(ptr - in) + measure_cells(ptr);
+    s_cell_count_cache.store(in, hash, count);
     return count;
 }
 
@@ -73,8 +190,92 @@ enum ecma48_state_enum
     ecma48_state_csi_f,
     ecma48_state_cmd_str,
     ecma48_state_char_str,
+    ecma48_state_count,
 };
 
+//------------------------------------------------------------------------------
+// Characters are grouped into the classes that the states below care about.
+enum ecma48_class : unsigned char
+{
+    cls_c0,     // 0x00-0x1f, less the ones below
+    cls_bel,    // 0x07
+    cls_fe,     // 0x08-0x0d
+    cls_esc,    // 0x1b
+    cls_int,    // 0x20-0x2f, intermediate bytes
+    cls_par,    // 0x30-0x3f, parameter bytes
+    cls_up,     // 0x40-0x5f, less ST
+    cls_st,     // 0x5c
+    cls_lo,     // 0x60-0x7e
+    cls_del,    // 0x7f
+    cls_c1,     // 0x80-0x9f, less ST
+    cls_c1st,   // 0x9c
+    cls_oth,    // 0xa0 and up
+    cls_count,
+};
+
+static const unsigned char g_char_classes[0xa0] = {
+    /* 00 */ cls_c0,  cls_c0,  cls_c0,  cls_c0,  cls_c0,  cls_c0,  cls_c0,  cls_bel,
+             cls_fe,  cls_fe,  cls_fe,  cls_fe,  cls_fe,  cls_fe,  cls_c0,  cls_c0,
+    /* 10 */ cls_c0,  cls_c0,  cls_c0,  cls_c0,  cls_c0,  cls_c0,  cls_c0,  cls_c0,
+             cls_c0,  cls_c0,  cls_c0,  cls_esc, cls_c0,  cls_c0,  cls_c0,  cls_c0,
+    /* 20 */ cls_int, cls_int, cls_int, cls_int, cls_int, cls_int, cls_int, cls_int,
+             cls_int, cls_int, cls_int, cls_int, cls_int, cls_int, cls_int, cls_int,
+    /* 30 */ cls_par, cls_par, cls_par, cls_par, cls_par, cls_par, cls_par, cls_par,
+             cls_par, cls_par, cls_par, cls_par, cls_par, cls_par, cls_par, cls_par,
+    /* 40 */ cls_up,  cls_up,  cls_up,  cls_up,  cls_up,  cls_up,  cls_up,  cls_up,
+             cls_up,  cls_up,  cls_up,  cls_up,  cls_up,  cls_up,  cls_up,  cls_up,
+    /* 50 */ cls_up,  cls_up,  cls_up,  cls_up,  cls_up,  cls_up,  cls_up,  cls_up,
+             cls_up,  cls_up,  cls_up,  cls_up,  cls_st,  cls_up,  cls_up,  cls_up,
+    /* 60 */ cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,
+             cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,
+    /* 70 */ cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,
+             cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_lo,  cls_del,
+    /* 80 */ cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,
+             cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,
+    /* 90 */ cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1,
+             cls_c1,  cls_c1,  cls_c1,  cls_c1,  cls_c1st, cls_c1, cls_c1,  cls_c1,
+};
+
+//------------------------------------------------------------------------------
+enum ecma48_action : unsigned char
+{
+    act_next,       // consume, move to the transition's state
+    act_stop,       // finish the code without consuming
+    act_done,       // consume, finish the code
+    act_reset,      // abandon the sequence, reconsider this character
+    act_c0,         // consume, finish as a C0 code
+    act_c1,         // consume, start a C1 code
+    act_icf,        // consume, finish as an independent control function
+    act_chars,      // consume, start a run of characters
+    act_cmd_esc,    // ESC in a command string; maybe nested, maybe ST
+    act_cmd_bel,    // BEL in a command string; Xterm uses it as a terminator
+};
+
+//------------------------------------------------------------------------------
+struct ecma48_transition
+{
+    unsigned char   action;
+    unsigned char   state;
+};
+
+#define X(a)        { act_##a, ecma48_state_unknown }
+#define N(s)        { act_next, ecma48_state_##s }
+
+static const ecma48_transition g_transitions[ecma48_state_count][cls_count] = {
+    /*                c0          bel           fe          esc         int         par         up          st          lo          del         c1          c1st        oth */
+    /* unknown */   { X(c0),      X(c0),        X(c0),      N(esc),     X(chars),   X(chars),   X(chars),   X(chars),   X(chars),   X(chars),   X(c1),      X(c1),      X(chars) },
+    /* char */      { X(stop),    X(stop),      X(stop),    X(stop),    N(char),    N(char),    N(char),    N(char),    N(char),    N(char),    N(char),    N(char),    N(char) },
+    /* esc */       { X(chars),   X(chars),     X(chars),   X(chars),   X(chars),   X(chars),   X(c1),      X(c1),      X(icf),     X(icf),     X(chars),   X(chars),   X(chars) },
+    /* esc_st */    { X(reset),   X(reset),     X(reset),   X(reset),   X(reset),   X(reset),   X(reset),   X(done),    X(reset),   X(reset),   X(reset),   X(reset),   X(reset) },
+    /* csi_p */     { X(reset),   X(reset),     X(reset),   X(reset),   N(csi_f),   N(csi_p),   X(done),    X(done),    X(done),    X(reset),   X(reset),   X(reset),   X(reset) },
+    /* csi_f */     { X(reset),   X(reset),     X(reset),   X(reset),   N(csi_f),   X(reset),   X(done),    X(done),    X(done),    X(reset),   X(reset),   X(reset),   X(reset) },
+    /* cmd_str */   { X(reset),   X(cmd_bel),   N(cmd_str), X(cmd_esc), N(cmd_str), N(cmd_str), N(cmd_str), N(cmd_str), N(cmd_str), X(reset),   X(reset),   X(done),    X(reset) },
+    /* char_str */  { N(char_str), N(char_str), N(char_str), N(esc_st), N(char_str), N(char_str), N(char_str), N(char_str), N(char_str), N(char_str), N(char_str), X(done), N(char_str) },
+};
+
+#undef N
+#undef X
+
 //------------------------------------------------------------------------------
 void ecma48_state::reset()
 {
@@ -261,6 +462,7 @@ bool ecma48_code::get_c1_str(str_base& out) const
 //------------------------------------------------------------------------------
 ecma48_iter::ecma48_iter(const char* s, ecma48_state& state, int len)
 : m_iter(s, len)
+, m_end((len >= 0) ? s + len : nullptr)
 , m_code(state.code)
 , m_state(state)
 , m_nested_cmd_str(0)
@@ -276,32 +478,35 @@ const ecma48_code& ecma48_iter::next()
     bool done = true;
     while (1)
     {
-        int c = m_iter.peek();
-        if (!c)
+        // A run of characters is everything up to the next control character
+        // so it is found in one go rather than a character at a time.
+        if (m_state.state == ecma48_state_char)
         {
-            if (m_state.state != ecma48_state_char)
-            {
-                m_code.m_length = 0;
-                return m_code;
-            }
-
+            next_chars();
             break;
         }
 
-        assert(m_nested_cmd_str == 0 || m_state.state == ecma48_state_cmd_str);
+        // Most escape sequences are ASCII so only decode when they're not.
+        const char* ptr = m_iter.get_pointer();
+        const char* next = ptr + 1;
+        int c = (m_end && ptr >= m_end) ? 0 : (unsigned char)*ptr;
+        if (c >= 0x80)
+        {
+            str_iter inner_iter(m_iter);
+            c = inner_iter.next();
+            next = inner_iter.get_pointer();
+        }
 
-        switch (m_state.state)
+        if (!c)
         {
-        case ecma48_state_char:     done = next_char(c);     break;
-        case ecma48_state_char_str: done = next_char_str(c); break;
-        case ecma48_state_cmd_str:  done = next_cmd_str(c);  break;
-        case ecma48_state_csi_f:    done = next_csi_f(c);    break;
-        case ecma48_state_csi_p:    done = next_csi_p(c);    break;
-        case ecma48_state_esc:      done = next_esc(c);      break;
-        case ecma48_state_esc_st:   done = next_esc_st(c);   break;
-        case ecma48_state_unknown:  done = next_unknown(c);  break;
+            m_code.m_length = 0;
+            return m_code;
         }
 
+        assert(m_nested_cmd_str == 0 || m_state.state == ecma48_state_cmd_str);
+
+        done = next_step(c, next);
+
         if (m_state.state != ecma48_state_char)
         {
             while (copy != m_iter.get_pointer())
@@ -332,194 +537,135 @@ const ecma48_code& ecma48_iter::next()
 }
 
 //------------------------------------------------------------------------------
-bool ecma48_iter::next_c1()
+bool ecma48_iter::next_step(int c, const char* next)
 {
-    // Convert c1 code to its 7-bit version.
-    m_code.m_code = (m_code.m_code & 0x1f) | 0x40;
+    int cls = (unsigned(c) < sizeof_array(g_char_classes)) ? g_char_classes[c] : cls_oth;
+    const ecma48_transition& transition = g_transitions[m_state.state][cls];
 
-    switch (m_code.get_code())
+    switch (transition.action)
     {
-        case 0x50: /* dcs */
-        case 0x5d: /* osc */
-        case 0x5e: /* pm  */
-        case 0x5f: /* apc */
-            m_state.state = ecma48_state_cmd_str;
-            return false;
+    case act_next:
+        m_iter.reset_pointer(next);
+        m_state.state = ecma48_state_enum(transition.state);
+        return false;
 
-        case 0x5b: /* csi */
-            m_state.state = ecma48_state_csi_p;
-            return false;
+    case act_stop:
+        return true;
 
-        case 0x58: /* sos */
-            m_state.state = ecma48_state_char_str;
-            return false;
-    }
+    case act_done:
+        m_iter.reset_pointer(next);
+        return true;
 
-    return true;
-}
+    case act_reset:
+        m_code.m_str = m_iter.get_pointer();
+        m_code.m_length = 0;
+        m_state.reset();
+        m_nested_cmd_str = 0;
+        return false;
 
-//------------------------------------------------------------------------------
-bool ecma48_iter::next_char(int c)
-{
-    if (in_range(c, 0x00, 0x1f))
-    {
-        m_code.m_type = ecma48_code::type_chars;
+    case act_c0:
+        m_iter.reset_pointer(next);
+        m_code.m_type = ecma48_code::type_c0;
+        m_code.m_code = c;
         return true;
-    }
 
-    m_iter.next();
-    return false;
-}
+    case act_c1:
+        m_iter.reset_pointer(next);
+        m_code.m_type = ecma48_code::type_c1;
+        m_code.m_code = c;
+        return next_c1();
 
-//------------------------------------------------------------------------------
-bool ecma48_iter::next_char_str(int c)
-{
-    m_iter.next();
+    case act_icf:
+        m_iter.reset_pointer(next);
+        m_code.m_type = ecma48_code::type_icf;
+        m_code.m_code = c;
+        return true;
 
-    if (c == 0x1b)
-    {
-        m_state.state = ecma48_state_esc_st;
+    case act_chars:
+        m_iter.reset_pointer(next);
+        m_code.m_type = ecma48_code::type_chars;
+        m_state.state = ecma48_state_char;
         return false;
-    }
 
-    return (c == 0x9c);
-}
-
-//------------------------------------------------------------------------------
-bool ecma48_iter::next_cmd_str(int c)
-{
-    if (c == 0x1b)
-    {
-        m_iter.next();
-        int d = m_iter.peek();
-        if (d == 0x5d)
-            m_nested_cmd_str++;
-        else if (d == 0x5c && m_nested_cmd_str > 0)
-            m_nested_cmd_str--;
-        else
-            m_state.state = ecma48_state_esc_st;
+    case act_cmd_esc:
+        {
+            m_iter.reset_pointer(next);
+            int d = m_iter.peek();
+            if (d == 0x5d)
+                m_nested_cmd_str++;
+            else if (d == 0x5c && m_nested_cmd_str > 0)
+                m_nested_cmd_str--;
+            else
+                m_state.state = ecma48_state_esc_st;
+        }
         return false;
-    }
-    else if (c == 0x9c || c == 0x07) // Xterm supports OSC terminated by BEL.
-    {
-        m_iter.next();
-        if (c == 0x07 && m_nested_cmd_str > 0)
+
+    case act_cmd_bel:
+        m_iter.reset_pointer(next);
+        if (m_nested_cmd_str > 0)
         {
             m_nested_cmd_str--;
             return false;
         }
         return true;
     }
-    else if (in_range(c, 0x08, 0x0d) || in_range(c, 0x20, 0x7e))
-    {
-        m_iter.next();
-        return false;
-    }
 
-    // Reset
-    m_code.m_str = m_iter.get_pointer();
-    m_code.m_length = 0;
-    m_state.reset();
-    return false;
+    return true;
 }
 
 //------------------------------------------------------------------------------
-bool ecma48_iter::next_csi_f(int c)
+void ecma48_iter::next_chars()
 {
-    if (in_range(c, 0x20, 0x2f))
+    // Only C0 controls end a run of characters. ASCII is skipped over a byte
+    // at a time and anything else is decoded, as malformed UTF-8 can decode to
+    // a control character.
+    const char* ptr = m_iter.get_pointer();
+    while (true)
     {
-        m_iter.next();
-        return false;
-    }
-    else if (in_range(c, 0x40, 0x7e))
-    {
-        m_iter.next();
-        return true;
-    }
+        if (m_end == nullptr)
+            while (unsigned((unsigned char)*ptr - 0x20) < 0x60)
+                ++ptr;
+        else
+            while (ptr < m_end && unsigned((unsigned char)*ptr - 0x20) < 0x60)
+                ++ptr;
 
-    // Reset
-    m_code.m_str = m_iter.get_pointer();
-    m_code.m_length = 0;
-    m_state.reset();
-    return false;
-}
+        if ((m_end && ptr >= m_end) || (unsigned char)*ptr < 0x80)
+            break;
+
+        m_iter.reset_pointer(ptr);
+        if (m_iter.peek() < 0x20)
+            break;
 
-//------------------------------------------------------------------------------
-bool ecma48_iter::next_csi_p(int c)
-{
-    if (in_range(c, 0x30, 0x3f))
-    {
         m_iter.next();
-        return false;
+        ptr = m_iter.get_pointer();
     }
 
-    m_state.state = ecma48_state_csi_f;
-    return next_csi_f(c);
+    m_iter.reset_pointer(ptr);
 }
 
 //------------------------------------------------------------------------------
-bool ecma48_iter::next_esc(int c)
+bool ecma48_iter::next_c1()
 {
-    m_iter.next();
-
-    if (in_range(c, 0x40, 0x5f))
-    {
-        m_code.m_type = ecma48_code::type_c1;
-        m_code.m_code = c;
-        return next_c1();
-    }
-    else if (in_range(c, 0x60, 0x7f))
-    {
-        m_code.m_type = ecma48_code::type_icf;
-        m_code.m_code = c;
-        return true;
-    }
-
-    m_state.state = ecma48_state_char;
-    return false;
-}
+    // Convert c1 code to its 7-bit version.
+    m_code.m_code = (m_code.m_code & 0x1f) | 0x40;
 
-//------------------------------------------------------------------------------
-bool ecma48_iter::next_esc_st(int c)
-{
-    if (c == 0x5c)
+    switch (m_code.get_code())
     {
-        m_iter.next();
-        assert(m_nested_cmd_str == 0);
-        return true;
-    }
-
-    m_code.m_str = m_iter.get_pointer();
-    m_code.m_length = 0;
-    m_state.reset();
-    m_nested_cmd_str = 0;
-    return false;
-}
+        case 0x50: /* dcs */
+        case 0x5d: /* osc */
+        case 0x5e: /* pm  */
+        case 0x5f: /* apc */
+            m_state.state = ecma48_state_cmd_str;
+            return false;
 
-//------------------------------------------------------------------------------
-bool ecma48_iter::next_unknown(int c)
-{
-    m_iter.next();
+        case 0x5b: /* csi */
+            m_state.state = ecma48_state_csi_p;
+            return false;
 
-    if (c == 0x1b)
-    {
-        m_state.state = ecma48_state_esc;
-        return false;
-    }
-    else if (in_range(c, 0x00, 0x1f))
-    {
-        m_code.m_type = ecma48_code::type_c0;
-        m_code.m_code = c;
-        return true;
-    }
-    else if (in_range(c, 0x80, 0x9f))
-    {
-        m_code.m_type = ecma48_code::type_c1;
-        m_code.m_code = c;
-        return next_c1();
+        case 0x58: /* sos */
+            m_state.state = ecma48_state_char_str;
+            return false;
     }
 
-    m_code.m_type = ecma48_code::type_chars;
-    m_state.state = ecma48_state_char;
-    return false;
+    return true;
 }
@@ -0,0 +1,285 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "input_ring.h"
+
+#include <assert.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+// Indices are free running and masked on use.  The producer owns 'write' and
+// 'next', the consumer owns 'read'.  Once 'next' is set the producer never
+// touches the segment again, so the consumer frees it when it's drained.
+struct input_ring::segment
+{
+    std::atomic<unsigned int>   read;
+    std::atomic<unsigned int>   write;
+    std::atomic<segment*>       next;
+    unsigned int                mask;
+    unsigned char               data[1];
+};
+
+
+
+//------------------------------------------------------------------------------
+input_ring::input_ring(unsigned int initial_size, unsigned int max_size)
+: m_max_size(max_size)
+, m_pushed(0)
+, m_popped(0)
+, m_high_water(0)
+, m_grows(0)
+, m_drops(0)
+{
+    // Sizes must be powers of two.
+    assert(initial_size && !(initial_size & (initial_size - 1)));
+    assert(max_size >= initial_size && !(max_size & (max_size - 1)));
+
+    m_head = m_tail = new_segment(initial_size);
+    m_capacity = initial_size;
+}
+
+//------------------------------------------------------------------------------
+input_ring::~input_ring()
+{
+    for (segment* seg = m_head; seg != nullptr;)
+    {
+        segment* next = seg->next.load(std::memory_order_relaxed);
+        free(seg);
+        seg = next;
+    }
+}
+
+//------------------------------------------------------------------------------
+input_ring::segment* input_ring::new_segment(unsigned int size)
+{
+    void* mem = malloc(sizeof(segment) + size - 1);
+    if (mem == nullptr)
+        return nullptr;
+
+    segment* seg = new (mem) segment;
+    seg->read.store(0, std::memory_order_relaxed);
+    seg->write.store(0, std::memory_order_relaxed);
+    seg->next.store(nullptr, std::memory_order_relaxed);
+    seg->mask = size - 1;
+    return seg;
+}
+
+//------------------------------------------------------------------------------
+input_ring::segment* input_ring::grow()
+{
+    // The tail's full, so everything in it is pending.
+    unsigned int size = m_tail->mask + 1;
+    if (size >= m_max_size)
+        return nullptr;
+
+    segment* seg = new_segment(size << 1);
+    if (seg == nullptr)
+        return nullptr;
+
+    m_tail->next.store(seg, std::memory_order_release);
+    m_tail = seg;
+
+    m_capacity.store(size << 1, std::memory_order_relaxed);
+    m_grows.fetch_add(1, std::memory_order_relaxed);
+    return seg;
+}
+
+//------------------------------------------------------------------------------
+void input_ring::pushed(unsigned int count)
+{
+    // Differences are signed as an unget() racing this can briefly make the
+    // consumer's count the larger.
+    unsigned int total = m_pushed.fetch_add(count, std::memory_order_relaxed) + count;
+    int pending = int(total - m_popped.load(std::memory_order_relaxed));
+    if (pending > int(m_high_water.load(std::memory_order_relaxed)))
+        m_high_water.store(pending, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+bool input_ring::push(unsigned char value)
+{
+    segment* seg = m_tail;
+    unsigned int write = seg->write.load(std::memory_order_relaxed);
+    if (write - seg->read.load(std::memory_order_acquire) > seg->mask)
+    {
+        if ((seg = grow()) == nullptr)
+        {
+            m_drops.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        write = 0;
+    }
+
+    // Counted before it's published so the consumer can't pop it first.
+    seg->data[write & seg->mask] = value;
+    pushed(1);
+    seg->write.store(write + 1, std::memory_order_release);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+unsigned int input_ring::push(const char* data, unsigned int length)
+{
+    unsigned int remaining = length;
+    while (remaining)
+    {
+        segment* seg = m_tail;
+        unsigned int write = seg->write.load(std::memory_order_relaxed);
+        unsigned int size = seg->mask + 1;
+        unsigned int space = size - (write - seg->read.load(std::memory_order_acquire));
+        if (!space)
+        {
+            if (grow() == nullptr)
+                break;
+            continue;
+        }
+
+        // Copy up to the end of the ring, and then any more from the start.
+        unsigned int n = min(space, remaining);
+        unsigned int offset = write & seg->mask;
+        unsigned int first = min(n, size - offset);
+        memcpy(seg->data + offset, data, first);
+        memcpy(seg->data, data + first, n - first);
+        pushed(n);
+        seg->write.store(write + n, std::memory_order_release);
+
+        data += n;
+        remaining -= n;
+    }
+
+    if (remaining)
+        m_drops.fetch_add(remaining, std::memory_order_relaxed);
+
+    return length - remaining;
+}
+
+//------------------------------------------------------------------------------
+bool input_ring::pop(unsigned char& out)
+{
+    if (!m_unget.empty())
+    {
+        out = m_unget.back();
+        m_unget.pop_back();
+        m_popped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    while (true)
+    {
+        segment* seg = m_head;
+        unsigned int read = seg->read.load(std::memory_order_relaxed);
+        if (read != seg->write.load(std::memory_order_acquire))
+        {
+            out = seg->data[read & seg->mask];
+            seg->read.store(read + 1, std::memory_order_release);
+            m_popped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        segment* next = seg->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+            return false;
+
+        // The producer may have written more before moving on to 'next'.
+        if (read != seg->write.load(std::memory_order_acquire))
+            continue;
+
+        m_head = next;
+        free(seg);
+    }
+}
+
+//------------------------------------------------------------------------------
+bool input_ring::unget(unsigned char value)
+{
+    // Writing in front of 'read' could race the producer wrapping around onto
+    // the same slot, so pushed back input is kept to one side.
+    if (count() >= m_max_size)
+    {
+        m_drops.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    m_unget.push_back(value);
+    m_pushed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void input_ring::clear()
+{
+    unsigned char c;
+    while (pop(c));
+}
+
+//------------------------------------------------------------------------------
+unsigned int input_ring::count() const
+{
+    unsigned int popped = m_popped.load(std::memory_order_relaxed);
+    int pending = int(m_pushed.load(std::memory_order_relaxed) - popped);
+    return (pending > 0) ? pending : 0;
+}
+
+//------------------------------------------------------------------------------
+void input_ring::get_stats(stats& out) const
+{
+    out.capacity = m_capacity.load(std::memory_order_relaxed);
+    out.high_water = m_high_water.load(std::memory_order_relaxed);
+    out.grows = m_grows.load(std::memory_order_relaxed);
+    out.drops = m_drops.load(std::memory_order_relaxed);
+}
+
+
+
+//------------------------------------------------------------------------------
+// For Readline's input buffer (see input.c).
+extern "C" {
+
+void* input_ring_create(unsigned int initial_size, unsigned int max_size)
+{
+    return new input_ring(initial_size, max_size);
+}
+
+void input_ring_destroy(void* ring)
+{
+    delete (input_ring*)ring;
+}
+
+int input_ring_push(void* ring, int value)
+{
+    return ((input_ring*)ring)->push((unsigned char)value);
+}
+
+int input_ring_pop(void* ring, int* out)
+{
+    unsigned char c;
+    if (!((input_ring*)ring)->pop(c))
+        return 0;
+
+    *out = c;
+    return 1;
+}
+
+int input_ring_unget(void* ring, int value)
+{
+    return ((input_ring*)ring)->unget((unsigned char)value);
+}
+
+unsigned int input_ring_count(void* ring)
+{
+    return ((input_ring*)ring)->count();
+}
+
+void input_ring_get_stats(void* ring, unsigned int* high_water, unsigned int* drops)
+{
+    input_ring::stats stats;
+    ((input_ring*)ring)->get_stats(stats);
+    *high_water = stats.high_water;
+    *drops = stats.drops;
+}
+
+} // extern "C"
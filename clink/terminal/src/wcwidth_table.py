@@ -0,0 +1,137 @@
+# Copyright (c) 2016 Martin Ridgers
+# License: http://opensource.org/licenses/MIT
+#
+# Generates wcwidth_table.h, the two-stage lookup table used by mk_wcwidth().
+#
+#   python wcwidth_table.py [ucd_dir] > wcwidth_table.h
+#
+# With a directory it reads EastAsianWidth.txt and DerivedGeneralCategory.txt
+# (from the UCD's extracted/ folder) so the table can follow the latest
+# Unicode release. Without one it uses the data built into Python.
+
+import re
+import sys
+import unicodedata
+
+WIDTH_ZERO = 0
+WIDTH_ONE = 1
+WIDTH_TWO = 2
+WIDTH_AMBIGUOUS = 3
+
+MAX_CODEPOINT = 0x110000
+
+#-------------------------------------------------------------------------------
+def load_ucd_file(path, default):
+    values = [default] * MAX_CODEPOINT
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+
+            codes, value = [x.strip() for x in line.split(";")[:2]]
+            first, _, last = codes.partition("..")
+            first = int(first, 16)
+            last = int(last, 16) if last else first
+            for c in range(first, last + 1):
+                values[c] = value
+    return values
+
+#-------------------------------------------------------------------------------
+def load_properties(ucd_dir):
+    if ucd_dir:
+        with open(ucd_dir + "/EastAsianWidth.txt", encoding="utf-8") as f:
+            version = re.search(r"-([\d.]+)\.txt", f.readline()).group(1)
+        eaw = load_ucd_file(ucd_dir + "/EastAsianWidth.txt", "N")
+        cat = load_ucd_file(ucd_dir + "/DerivedGeneralCategory.txt", "Cn")
+    else:
+        version = unicodedata.unidata_version
+        eaw = [unicodedata.east_asian_width(chr(c)) for c in range(MAX_CODEPOINT)]
+        cat = [unicodedata.category(chr(c)) for c in range(MAX_CODEPOINT)]
+
+    # Unassigned code points are neutral, except in the ideographic ranges
+    # where they default to wide. Python's own data doesn't follow this.
+    for c in range(MAX_CODEPOINT):
+        if cat[c] == "Cn":
+            eaw[c] = "N"
+    for first, last in ((0x3400, 0x4dbf), (0x4e00, 0x9fff), (0xf900, 0xfaff),
+                        (0x20000, 0x2fffd), (0x30000, 0x3fffd)):
+        for c in range(first, last + 1):
+            if cat[c] == "Cn":
+                eaw[c] = "W"
+
+    return version, eaw, cat
+
+#-------------------------------------------------------------------------------
+def get_width(c, eaw, cat):
+    if c == 0x00ad:                             # Soft hyphen.
+        return WIDTH_ONE
+    if cat in ("Mn", "Me", "Cf"):               # Combining and format chars.
+        return WIDTH_ZERO
+    if c == 0x200b:                             # Zero width space.
+        return WIDTH_ZERO
+    if 0x1160 <= c <= 0x11ff or 0xd7b0 <= c <= 0xd7ff:
+        return WIDTH_ZERO                       # Hangul medial vowels and final consonants.
+    if eaw in ("W", "F"):                       # Includes emoji presentation.
+        return WIDTH_TWO
+    if eaw == "A":
+        return WIDTH_AMBIGUOUS
+    return WIDTH_ONE
+
+#-------------------------------------------------------------------------------
+def build_stages(widths, shift):
+    size = 1 << shift
+    blocks = {}
+    stage1 = []
+    stage2 = []
+    for base in range(0, MAX_CODEPOINT, size):
+        block = tuple(widths[base:base + size])
+        index = blocks.get(block)
+        if index is None:
+            index = blocks[block] = len(blocks)
+            for i in range(0, size, 4):
+                stage2.append(block[i] | (block[i + 1] << 2) | (block[i + 2] << 4) | (block[i + 3] << 6))
+        stage1.append(index)
+    return stage1, stage2
+
+#-------------------------------------------------------------------------------
+def write_array(out, ctype, name, values):
+    out.write("static const %s %s[%d] = {\n" % (ctype, name, len(values)))
+    for i in range(0, len(values), 16):
+        out.write("    " + " ".join("0x%02x," % v for v in values[i:i + 16]) + "\n")
+    out.write("};\n")
+
+#-------------------------------------------------------------------------------
+def main():
+    version, eaw, cat = load_properties(sys.argv[1] if len(sys.argv) > 1 else None)
+    widths = [get_width(c, eaw[c], cat[c]) for c in range(MAX_CODEPOINT)]
+
+    # Pick the block size that gives the smallest tables while stage one's
+    # indices still fit in a byte.
+    best = None
+    for shift in range(4, 13):
+        stage1, stage2 = build_stages(widths, shift)
+        if max(stage1) > 0xff:
+            continue
+        size = len(stage1) + len(stage2)
+        if best is None or size < best[0]:
+            best = (size, shift, stage1, stage2)
+    size, shift, stage1, stage2 = best
+
+    out = sys.stdout
+    out.write("// Copyright (c) 2016 Martin Ridgers\n")
+    out.write("// License: http://opensource.org/licenses/MIT\n")
+    out.write("\n")
+    out.write("// Generated by wcwidth_table.py from Unicode %s. Do not edit.\n" % version)
+    out.write("\n")
+    out.write("#pragma once\n")
+    out.write("\n")
+    out.write("// Widths are two bits each; 0, 1, 2 or 3 for East Asian Ambiguous.\n")
+    out.write("static const unsigned int wcwidth_block_shift = %d;\n" % shift)
+    out.write("\n")
+    write_array(out, "unsigned char", "wcwidth_stage1", stage1)
+    out.write("\n")
+    write_array(out, "unsigned char", "wcwidth_stage2", stage2)
+
+if __name__ == "__main__":
+    main()
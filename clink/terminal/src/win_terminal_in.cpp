@@ -416,8 +416,15 @@ enum : unsigned char
     input_abort_byte    = 0xff,
     input_none_byte     = 0xfe,
     input_timeout_byte  = 0xfd,
+    input_paste_byte    = 0xfc,
 };
 
+//------------------------------------------------------------------------------
+// Pasting into the console arrives as a burst of synthesized key events.  Only
+// bursts at least this long are collected as a paste; anything shorter goes
+// through as ordinary keys.
+static const unsigned int paste_min_records = 32;
+
 
 
 //------------------------------------------------------------------------------
@@ -469,11 +476,14 @@ static bool adjust_cursor_on_resize(COORD prev_position)
 //------------------------------------------------------------------------------
 void win_terminal_in::begin()
 {
-    m_buffer_count = 0;
+    m_input.clear();
+    m_chord_len = 0;
     m_lead_surrogate = 0;
+    m_paste.clear();
     m_stdin = GetStdHandle(STD_INPUT_HANDLE);
     GetConsoleMode(m_stdin, &m_prev_mode);
     set_cursor_visibility(false);
+    reset_wcwidths();
 }
 
 //------------------------------------------------------------------------------
@@ -487,7 +497,7 @@ void win_terminal_in::end()
 //------------------------------------------------------------------------------
 void win_terminal_in::select()
 {
-    if (!m_buffer_count)
+    if (m_input.empty())
         read_console();
 }
 
@@ -501,19 +511,26 @@ int win_terminal_in::read()
         return terminal_in::input_terminal_resize;
     }
 
-    if (!m_buffer_count)
+    unsigned char c;
+    if (!m_input.pop(c))
         return terminal_in::input_none;
 
-    unsigned char c = pop();
     switch (c)
     {
     case input_none_byte:       return terminal_in::input_none;
     case input_timeout_byte:    return terminal_in::input_timeout;
     case input_abort_byte:      return terminal_in::input_abort;
+    case input_paste_byte:      return terminal_in::input_paste;
     default:                    return c;
     }
 }
 
+//------------------------------------------------------------------------------
+const char* win_terminal_in::read_paste()
+{
+    return m_paste.empty() ? "" : m_paste.data();
+}
+
 //------------------------------------------------------------------------------
 key_tester* win_terminal_in::set_key_tester(key_tester* keys)
 {
@@ -541,10 +558,13 @@ void win_terminal_in::read_console()
     if (!is_scroll_mode())
         SetConsoleCursorPosition(stdout_handle, csbi.dwCursorPosition);
 
+    // If what's queued looks like a paste, take it all in one go.
+    if (read_console_paste())
+        return;
+
     // Read input records sent from the terminal (aka conhost) until some
     // input has been buffered.
-    unsigned int buffer_count = m_buffer_count;
-    while (buffer_count == m_buffer_count)
+    while (m_input.empty())
     {
 #ifdef DEBUG
         DWORD modeIn;
@@ -557,8 +577,7 @@ void win_terminal_in::read_console()
         if (!ReadConsoleInputW(m_stdin, &record, 1, &count))
         {
             // Handle's probably invalid if ReadConsoleInput() failed.
-            m_buffer_count = 1;
-            m_buffer[0] = input_abort_byte;
+            m_input.push(input_abort_byte);
             return;
         }
 
@@ -580,6 +599,7 @@ void win_terminal_in::read_console()
 
                 if (key_event.bKeyDown)
                 {
+                    m_chord_len = 0;
                     process_input(key_event);
 
                     // If the processed input chord isn't bound, discard it.
@@ -587,44 +607,36 @@ void win_terminal_in::read_console()
                     // sequence show up as though it were typed input.  The
                     // approach here assumes no more than one key sequence per
                     // input record.
-                    if (m_keys)
+                    const int len = m_chord_len;
+                    if (m_keys && len > 0)
                     {
                         // If there are unprocessed queued keys, then we don't
                         // know what keymap will be active when this new input
                         // gets processed, so we can't accurately tell whether
                         // the key sequence is bound to anything.
-                        assert(buffer_count == 0);
+                        assert(m_input.empty());
+
+                        // Readline has a bug in rl_function_of_keyseq_len
+                        // that looks for nul termination even though it's
+                        // supposed to use a length instead.
+                        m_chord[len] = '\0';
 
-                        const int len = m_buffer_count - buffer_count;
-                        if (len > 0)
+                        str<32> new_chord;
+                        if (m_keys->translate(m_chord, len, new_chord))
+                        {
+                            m_chord_len = 0;
+                            for (unsigned int i = 0; i < new_chord.length(); ++i)
+                                push((unsigned int)new_chord.c_str()[i]);
+                        }
+                        else if (!m_keys->is_bound(m_chord, len))
                         {
-                            // m_buffer is circular, so copy the key sequence to
-                            // a separate sequential buffer.
-                            char chord[sizeof_array(m_buffer) + 1];
-                            static const unsigned int mask = sizeof_array(m_buffer) - 1;
-                            for (int i = 0; i < len; ++i)
-                                chord[i] = m_buffer[(m_buffer_head + i) & mask];
-
-                            // Readline has a bug in rl_function_of_keyseq_len
-                            // that looks for nul termination even though it's
-                            // supposed to use a length instead.
-                            chord[len] = '\0';
-
-                            str<32> new_chord;
-                            if (m_keys->translate(chord, len, new_chord))
-                            {
-                                m_buffer_count = buffer_count;
-                                for (unsigned int i = 0; i < new_chord.length(); ++i)
-                                    push((unsigned int)new_chord.c_str()[i]);
-                            }
-                            else if (!m_keys->is_bound(chord, len))
-                            {
-                                m_buffer_count = buffer_count;
-                            }
-
-                            m_keys->set_keyseq_len(m_buffer_count);
+                            m_chord_len = 0;
                         }
+
+                        m_keys->set_keyseq_len(m_chord_len);
                     }
+
+                    m_input.push(m_chord, m_chord_len);
                 }
             }
             break;
@@ -640,6 +652,128 @@ void win_terminal_in::read_console()
     }
 }
 
+//------------------------------------------------------------------------------
+// Returns the character a key event contributes to pasted text, 0 if the event
+// carries nothing (key ups, modifiers, Alt code digits), or -1 if the event is
+// a key that must go through key binding.
+static int get_paste_char(const KEY_EVENT_RECORD& key_event)
+{
+    int key_char = key_event.uChar.UnicodeChar;
+    int key_vk = key_event.wVirtualKeyCode;
+    int key_flags = key_event.dwControlKeyState;
+
+    // Alt codes arrive as the Alt key-up (see read_console()).
+    if (!key_event.bKeyDown)
+    {
+        if (key_vk != VK_MENU || !key_char)
+            return 0;
+
+        return (key_char < 0x20 || key_char == 0x7f) ? -1 : key_char;
+    }
+
+    if (!key_char)
+    {
+        switch (key_vk)
+        {
+        case VK_SHIFT:
+        case VK_CONTROL:
+        case VK_MENU:
+            return 0;
+        }
+
+        bool alt_code = (key_flags & ALT_PRESSED) && key_vk >= VK_NUMPAD0 && key_vk <= VK_NUMPAD9;
+        return alt_code ? 0 : -1;
+    }
+
+    if (key_char < 0x20 || key_char == 0x7f)
+        return -1;
+
+    // Alt-<char> is a chord, but AltGr (right Alt with Ctrl) types a character.
+    bool alt = !!(key_flags & ALT_PRESSED);
+    bool ctrl = !!(key_flags & CTRL_PRESSED);
+    if ((key_flags & LEFT_ALT_PRESSED) || alt != ctrl)
+        return -1;
+
+    return key_char;
+}
+
+//------------------------------------------------------------------------------
+bool win_terminal_in::read_console_paste()
+{
+    assert(m_input.empty());
+
+    DWORD pending;
+    if (!m_keys || !GetNumberOfConsoleInputEvents(m_stdin, &pending) || pending < paste_min_records)
+        return false;
+
+    // Only bypass key binding when the editor would self-insert every
+    // character anyway.
+    if (!m_keys->accepts_paste())
+        return false;
+
+    std::vector<INPUT_RECORD> records(min<DWORD>(pending, 4096));
+    std::vector<wchar_t> chars;
+    if (m_lead_surrogate)
+        chars.push_back(m_lead_surrogate);
+
+    bool first = true;
+    while (true)
+    {
+        DWORD count;
+        if (!PeekConsoleInputW(m_stdin, records.data(), DWORD(records.size()), &count) || !count)
+            break;
+
+        DWORD used = 0;
+        for (; used < count; ++used)
+        {
+            const INPUT_RECORD& record = records[used];
+            int c = (record.EventType == KEY_EVENT) ? get_paste_char(record.Event.KeyEvent) : -1;
+            if (c < 0)
+                break;
+            if (c > 0)
+                chars.push_back(wchar_t(c));
+        }
+
+        // A short run is just typing; leave it to be read as keys.
+        if (first && used < paste_min_records)
+            return false;
+
+        first = false;
+        if (!used)
+            break;
+
+        bool more = (used == count);
+        ReadConsoleInputW(m_stdin, records.data(), used, &count);
+        if (!more)
+            break;
+    }
+
+    if (first)
+        return false;
+
+    // Keep the lead of a split surrogate pair for whatever's read next.
+    m_lead_surrogate = 0;
+    if (!chars.empty() && is_lead_surrogate(chars.back()))
+    {
+        m_lead_surrogate = chars.back();
+        chars.pop_back();
+    }
+
+    if (chars.empty())
+        return false;
+
+    wstr_iter measure(chars.data(), int(chars.size()));
+    int length = to_utf8(nullptr, 0, measure);
+    m_paste.resize(length + 1);
+
+    wstr_iter iter(chars.data(), int(chars.size()));
+    to_utf8(m_paste.data(), length + 1, iter);
+    m_paste[length] = '\0';
+
+    m_input.push(input_paste_byte);
+    return true;
+}
+
 //------------------------------------------------------------------------------
 extern "C" int rl_editing_mode;
 void win_terminal_in::process_input(KEY_EVENT_RECORD const& record)
@@ -704,9 +838,9 @@ void win_terminal_in::process_input(KEY_EVENT_RECORD const& record)
 
     // Special treatment for variations of tab and space. Do this before
     // clearing AltGr flags, otherwise ctrl-space gets converted into space.
-    if (key_vk == VK_TAB && (key_char == 0x09 || !key_char) && !m_buffer_count)
+    if (key_vk == VK_TAB && (key_char == 0x09 || !key_char) && m_input.empty())
         return push(terminfo::ktab[terminfo::keymod_index(key_flags)]);
-    if (key_vk == VK_SPACE && (key_char == 0x20 || !key_char) && !m_buffer_count)
+    if (key_vk == VK_SPACE && (key_char == 0x20 || !key_char) && m_input.empty())
         return push(terminfo::kspc[terminfo::keymod_index(key_flags)]);
 
     // If the input was formed using AltGr or LeftAlt-LeftCtrl then things get
@@ -723,7 +857,7 @@ void win_terminal_in::process_input(KEY_EVENT_RECORD const& record)
     }
 
     // Special case for ctrl-shift-I (to behave like shift-tab aka. back-tab).
-    if (key_char == '\t' && !m_buffer_count && (key_flags & SHIFT_PRESSED) && !g_differentiate_keys.get())
+    if (key_char == '\t' && m_input.empty() && (key_flags & SHIFT_PRESSED) && !g_differentiate_keys.get())
         return push(terminfo::kcbt);
 
     // Function keys (kf1-kf48 from xterm+pcf2)
@@ -882,40 +1016,30 @@ void win_terminal_in::process_input(KEY_EVENT_RECORD const& record)
 //------------------------------------------------------------------------------
 void win_terminal_in::push(const char* seq)
 {
-    static const unsigned int mask = sizeof_array(m_buffer) - 1;
+    static const unsigned int capacity = sizeof_array(m_chord) - 1;
 
     assert(!m_lead_surrogate);
     m_lead_surrogate = 0;
 
-    int index = m_buffer_head + m_buffer_count;
-    for (; m_buffer_count <= mask && *seq; ++m_buffer_count, ++index, ++seq)
-    {
-        assert(m_buffer_count < sizeof_array(m_buffer));
-        if (m_buffer_count < sizeof_array(m_buffer))
-            m_buffer[index & mask] = *seq;
-        else
-            return;
-    }
+    for (; m_chord_len < capacity && *seq; ++m_chord_len, ++seq)
+        m_chord[m_chord_len] = *seq;
+
+    assert(!*seq);
 }
 
 //------------------------------------------------------------------------------
 void win_terminal_in::push(unsigned int value)
 {
-    static const unsigned int mask = sizeof_array(m_buffer) - 1;
-
-    int index = m_buffer_head + m_buffer_count;
+    static const unsigned int capacity = sizeof_array(m_chord) - 1;
 
     if (value < 0x80)
     {
         assert(!m_lead_surrogate);
         m_lead_surrogate = 0;
 
-        assert(m_buffer_count < sizeof_array(m_buffer));
-        if (m_buffer_count < sizeof_array(m_buffer))
-        {
-            m_buffer[index & mask] = value;
-            ++m_buffer_count;
-        }
+        assert(m_chord_len < capacity);
+        if (m_chord_len < capacity)
+            m_chord[m_chord_len++] = value;
         return;
     }
 
@@ -935,29 +1059,12 @@ void win_terminal_in::push(unsigned int value)
     wc[len++] = wchar_t(value);
     wc[len] = 0;
 
-    char utf8[mask + 1];
+    char utf8[16];
     unsigned int n = to_utf8(utf8, sizeof_array(utf8), wc);
-    for (unsigned int i = 0; i < n; ++i, ++index)
+    for (unsigned int i = 0; i < n; ++i)
     {
-        assert(m_buffer_count < sizeof_array(m_buffer));
-        if (m_buffer_count < sizeof_array(m_buffer))
-        {
-            m_buffer[index & mask] = utf8[i];
-            m_buffer_count++;
-        }
+        assert(m_chord_len < capacity);
+        if (m_chord_len < capacity)
+            m_chord[m_chord_len++] = utf8[i];
     }
 }
-
-//------------------------------------------------------------------------------
-unsigned char win_terminal_in::pop()
-{
-    if (!m_buffer_count)
-        return input_none_byte;
-
-    unsigned char value = m_buffer[m_buffer_head];
-
-    --m_buffer_count;
-    m_buffer_head = (m_buffer_head + 1) & (sizeof_array(m_buffer) - 1);
-
-    return value;
-}
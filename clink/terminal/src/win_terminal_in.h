@@ -3,8 +3,11 @@
 
 #pragma once
 
+#include "input_ring.h"
 #include "terminal_in.h"
 
+#include <vector>
+
 class key_tester;
 
 //------------------------------------------------------------------------------
@@ -16,20 +19,22 @@ public:
     virtual void    end() override;
     virtual void    select() override;
     virtual int     read() override;
+    virtual const char* read_paste() override;
     virtual key_tester* set_key_tester(key_tester* keys) override;
 
 private:
     void            read_console();
+    bool            read_console_paste();
     void            process_input(const KEY_EVENT_RECORD& key_event);
     void            push(unsigned int value);
     void            push(const char* seq);
-    unsigned char   pop();
     key_tester*     m_keys;
     void*           m_stdin = nullptr;
     unsigned int    m_dimensions = 0;
     unsigned long   m_prev_mode = 0;
-    unsigned char   m_buffer_head = 0;
-    unsigned char   m_buffer_count = 0;
+    unsigned char   m_chord_len = 0;
     wchar_t         m_lead_surrogate = 0;
-    unsigned char   m_buffer[16]; // must be power of two.
+    char            m_chord[32]; // one key's sequence, nul terminated.
+    input_ring      m_input;
+    std::vector<char> m_paste;
 };
@@ -0,0 +1,97 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include <core/base.h>
+#include <core/str.h>
+#include <terminal/ecma48_iter.h>
+
+#include <chrono>
+#include <vector>
+
+//------------------------------------------------------------------------------
+TEST_CASE("cell_count")
+{
+    SECTION("ASCII")
+    {
+        REQUIRE(cell_count("") == 0);
+        REQUIRE(cell_count("abc 123") == 7);
+        REQUIRE(cell_count("~\x7f") == 2);
+    }
+
+    SECTION("Escape codes")
+    {
+        REQUIRE(cell_count("\x1b[1;32mabc\x1b[0m") == 3);
+        REQUIRE(cell_count("ab\x1b]0;title\x07" "cd") == 4);
+        REQUIRE(cell_count("\x1b[7m") == 0);
+    }
+
+    SECTION("Wide and zero width")
+    {
+        REQUIRE(cell_count("\xe4\xb8\x80\xe4\xba\x8c") == 4);       // CJK
+        REQUIRE(cell_count("e\xcc\x81") == 1);                      // combining acute
+        REQUIRE(cell_count("ab\xe4\xb8\x80\x1b[0m" "cd") == 6);
+    }
+
+    SECTION("Repeated")
+    {
+        // Measure enough distinct strings to reuse cache slots and make sure
+        // each string still gets its own width.
+        str<64> s;
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (int i = 0; i < 200; ++i)
+            {
+                s.format("\x1b[1m%d\xe4\xb8\x80", i);
+                unsigned int digits = (i < 10) ? 1 : (i < 100) ? 2 : 3;
+                REQUIRE(cell_count(s.c_str()) == digits + 2);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("cell_count benchmark", "[.benchmark]")
+{
+    static const int file_count = 100000;
+
+    static const char* const c_stems[] = {
+        "readme", "caf\xc3\xa9_menu", "\xe6\x96\x87\xe6\xa1\xa3", "build_output",
+        "na\xc3\xafve", "\xd0\xbe\xd1\x82\xd1\x87\xd1\x91\xd1\x82", "photo", "notes",
+    };
+
+    std::vector<str_moveable> names;
+    names.reserve(file_count);
+    for (int i = 0; i < file_count; ++i)
+    {
+        str<64> name;
+        const char* stem = c_stems[i % sizeof_array(c_stems)];
+        if (i % 4 == 0)
+            name.format("\x1b[1;34m%s_%d\x1b[0m", stem, i);
+        else
+            name.format("%s_%d.txt", stem, i);
+        names.emplace_back(name.c_str());
+    }
+
+    auto measure = [] (const char* label, const str_moveable* begin, const str_moveable* end, int passes)
+    {
+        unsigned int cells = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < passes; ++i)
+            for (const str_moveable* name = begin; name != end; ++name)
+                cells += cell_count(name->c_str());
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        int count = int(end - begin) * passes;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        printf("cell_count (%s): %d strings in %.2f ms, %.1f ns each (%u cells)\n",
+            label, count, ns / 1e6, double(ns) / count, cells);
+    };
+
+    measure("file names", names.data(), names.data() + names.size(), 1);
+
+    // A prompt is measured each time the line is redrawn.
+    str_moveable prompt("\x1b[1;32mc:\\projects\\clink\x1b[0m \x1b[33m(master)\x1b[0m\n\xce\xbb ");
+    measure("prompt", &prompt, &prompt + 1, file_count);
+}
@@ -6,7 +6,9 @@
 #include <core/base.h>
 #include <terminal/ecma48_iter.h>
 
+#include <chrono>
 #include <new>
+#include <string>
 
 static ecma48_state g_state;
 
@@ -446,3 +448,61 @@ TEST_CASE("ecma48 osc envvar")
         REQUIRE(code->get_length() == 2);
     }
 }
+
+//------------------------------------------------------------------------------
+TEST_CASE("ecma48 esc chars")
+{
+    const ecma48_code* code;
+
+    ecma48_iter iter("\x1b\x01" "ab\x1b[1mcd", g_state);
+
+    code = &iter.next();
+    REQUIRE(*code);
+    REQUIRE(code->get_type() == ecma48_code::type_chars);
+    REQUIRE(code->get_length() == 4);
+
+    code = &iter.next();
+    REQUIRE(*code);
+    REQUIRE(code->get_type() == ecma48_code::type_c1);
+    REQUIRE(code->get_code() == ecma48_code::c1_csi);
+
+    code = &iter.next();
+    REQUIRE(*code);
+    REQUIRE(code->get_type() == ecma48_code::type_chars);
+    REQUIRE(code->get_length() == 2);
+
+    REQUIRE(!iter.next());
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("ecma48 benchmark", "[.benchmark]")
+{
+    std::string plain;
+    std::string sgr;
+    while (plain.length() < 1 << 20)
+    {
+        plain += "The quick brown fox jumps over the lazy dog. \xe2\x94\x80\xe2\x94\x80 ";
+        sgr += "\x1b[1;32mfile.txt\x1b[0m \x1b[38;5;208mdir\x1b[0m\\ \x1b[7m~\x1b[27m ";
+    }
+
+    for (const std::string* input : { &plain, &sgr })
+    {
+        static const int passes = 50;
+        unsigned int codes = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < passes; ++i)
+        {
+            ecma48_state state;
+            ecma48_iter iter(input->c_str(), state);
+            while (iter.next())
+                ++codes;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        double mb = double(input->length()) * passes / (1024 * 1024);
+        printf("%s: %.1f MB/s (%u codes)\n", (input == &plain) ? "plain" : "sgr",
+            mb / seconds, codes);
+    }
+}
@@ -0,0 +1,143 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include <terminal/input_ring.h>
+
+#include <thread>
+
+//------------------------------------------------------------------------------
+TEST_CASE("input_ring")
+{
+    input_ring ring(4, 64);
+    input_ring::stats stats;
+    unsigned char c;
+
+    SECTION("Order")
+    {
+        REQUIRE(ring.empty());
+        REQUIRE(!ring.pop(c));
+
+        // Round and round without growing.
+        for (int i = 0; i < 10; ++i)
+        {
+            REQUIRE(ring.push('a' + i));
+            REQUIRE(ring.push('A' + i));
+            REQUIRE(ring.push('0' + i));
+            REQUIRE(ring.count() == 3);
+
+            REQUIRE(ring.pop(c));
+            REQUIRE(c == 'a' + i);
+            REQUIRE(ring.pop(c));
+            REQUIRE(c == 'A' + i);
+            REQUIRE(ring.pop(c));
+            REQUIRE(c == '0' + i);
+        }
+
+        REQUIRE(!ring.pop(c));
+
+        ring.get_stats(stats);
+        REQUIRE(stats.capacity == 4);
+        REQUIRE(stats.grows == 0);
+        REQUIRE(stats.high_water == 3);
+    }
+
+    SECTION("Grow")
+    {
+        REQUIRE(ring.push("0123456789", 10) == 10);
+        REQUIRE(ring.push('x'));
+        REQUIRE(ring.count() == 11);
+
+        ring.get_stats(stats);
+        REQUIRE(stats.capacity == 8);
+        REQUIRE(stats.grows == 1);
+        REQUIRE(stats.high_water == 11);
+        REQUIRE(stats.drops == 0);
+
+        for (const char* expected = "0123456789x"; *expected; ++expected)
+        {
+            REQUIRE(ring.pop(c));
+            REQUIRE(c == *expected);
+        }
+
+        REQUIRE(ring.empty());
+    }
+
+    SECTION("Drops")
+    {
+        char data[64];
+        for (int i = 0; i < sizeof_array(data); ++i)
+            data[i] = char(i);
+
+        // Rings of 4, 8, 16, and 32, and then 4 into a ring of max_size.
+        REQUIRE(ring.push(data, 64) == 64);
+        REQUIRE(ring.push(data, 64) == 60);
+        REQUIRE(!ring.push('x'));
+        REQUIRE(ring.count() == 124);
+
+        ring.get_stats(stats);
+        REQUIRE(stats.capacity == 64);
+        REQUIRE(stats.drops == 5);
+
+        // Draining makes room again.
+        ring.clear();
+        REQUIRE(ring.empty());
+        REQUIRE(ring.push('y'));
+        REQUIRE(ring.pop(c));
+        REQUIRE(c == 'y');
+    }
+
+    SECTION("Unget")
+    {
+        ring.push("abc", 3);
+        REQUIRE(ring.pop(c));
+        REQUIRE(ring.unget('2'));
+        REQUIRE(ring.unget('1'));
+        REQUIRE(ring.count() == 4);
+
+        for (const char* expected = "12bc"; *expected; ++expected)
+        {
+            REQUIRE(ring.pop(c));
+            REQUIRE(c == *expected);
+        }
+
+        REQUIRE(ring.empty());
+    }
+
+    SECTION("Threads")
+    {
+        // A reader thread filling the ring faster than it's drained.  Nothing
+        // is popped until a backlog has built up, so it always has to grow.
+        static const unsigned int total = 1 << 20;
+        static const unsigned int backlog = 64;
+        input_ring threaded(16, 1 << 24);
+        std::thread producer([&] () {
+            for (unsigned int i = 0; i < total; ++i)
+                threaded.push((unsigned char)(i * 7));
+        });
+
+        while (threaded.count() < backlog)
+            std::this_thread::yield();
+
+        unsigned int received = 0;
+        bool ordered = true;
+        while (received < total)
+        {
+            if (!threaded.pop(c))
+                continue;
+
+            ordered &= (c == (unsigned char)(received * 7));
+            ++received;
+        }
+
+        producer.join();
+        REQUIRE(ordered);
+        REQUIRE(threaded.empty());
+
+        threaded.get_stats(stats);
+        REQUIRE(stats.drops == 0);
+        REQUIRE(stats.high_water >= backlog);
+        REQUIRE(stats.grows >= 2);
+    }
+}
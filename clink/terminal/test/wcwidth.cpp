@@ -0,0 +1,93 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include <core/base.h>
+#include <core/settings.h>
+
+#include <chrono>
+
+extern "C" int mk_wcwidth(char32_t);
+extern "C" void reset_wcwidths();
+
+//------------------------------------------------------------------------------
+TEST_CASE("wcwidth")
+{
+    SECTION("Controls")
+    {
+        REQUIRE(mk_wcwidth(0) == 0);
+        REQUIRE(mk_wcwidth(0x07) == -1);
+        REQUIRE(mk_wcwidth(0x7f) == -1);
+        REQUIRE(mk_wcwidth(0x9b) == -1);
+    }
+
+    SECTION("Narrow")
+    {
+        REQUIRE(mk_wcwidth('a') == 1);
+        REQUIRE(mk_wcwidth(0x00e9) == 1);                   // e acute
+        REQUIRE(mk_wcwidth(0x00ad) == 1);                   // soft hyphen
+        REQUIRE(mk_wcwidth(0x0436) == 1);                   // Cyrillic zhe
+    }
+
+    SECTION("Zero width")
+    {
+        REQUIRE(mk_wcwidth(0x0301) == 0);                   // combining acute
+        REQUIRE(mk_wcwidth(0x200b) == 0);                   // zero width space
+        REQUIRE(mk_wcwidth(0x200d) == 0);                   // zero width joiner
+        REQUIRE(mk_wcwidth(0xfe0f) == 0);                   // variation selector 16
+        REQUIRE(mk_wcwidth(0x1160) == 0);                   // Hangul medial vowel
+    }
+
+    SECTION("Wide")
+    {
+        REQUIRE(mk_wcwidth(0x4e00) == 2);                   // CJK
+        REQUIRE(mk_wcwidth(0xac00) == 2);                   // Hangul syllable
+        REQUIRE(mk_wcwidth(0xff21) == 2);                   // fullwidth A
+        REQUIRE(mk_wcwidth(0x20000) == 2);                  // CJK extension B
+        REQUIRE(mk_wcwidth(0x1f600) == 2);                  // emoji
+        REQUIRE(mk_wcwidth(0x1f680) == 2);                  // emoji
+    }
+
+    SECTION("Ambiguous")
+    {
+        REQUIRE(mk_wcwidth(0x00a1) == 1);
+        REQUIRE(mk_wcwidth(0x2460) == 1);
+
+        setting* ambiguous = settings::find("terminal.east_asian_ambiguous");
+        REQUIRE(ambiguous != nullptr);
+
+        REQUIRE(ambiguous->set("wide"));
+        reset_wcwidths();
+        REQUIRE(mk_wcwidth(0x00a1) == 2);
+        REQUIRE(mk_wcwidth(0x2460) == 2);
+        REQUIRE(mk_wcwidth('a') == 1);
+
+        REQUIRE(ambiguous->set("narrow"));
+        reset_wcwidths();
+        REQUIRE(mk_wcwidth(0x2460) == 1);
+
+        REQUIRE(ambiguous->set("auto"));
+        reset_wcwidths();
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("wcwidth benchmark", "[.benchmark]")
+{
+    static const char32_t c_chars[] = {
+        'a', 0x00e9, 0x0301, 0x0436, 0x2460, 0x4e00, 0xac00, 0x1f600,
+    };
+
+    static const int call_count = 10000000;
+
+    int cells = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < call_count; ++i)
+        cells += mk_wcwidth(c_chars[i % sizeof_array(c_chars)] + (i & 0x0f));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    printf("wcwidth: %d calls in %.2f ms, %.2f ns each (%d cells)\n",
+        call_count, ns / 1e6, double(ns) / call_count, cells);
+}
@@ -117,3 +117,57 @@ project("readline")
     excludes("readline/readline/support/wcwidth.c") -- better impl provided in clink_terminal
     -- todo: release this as gpl
     -- todo: it looks like keyboard handling is still broken somehow, ctrl+keypress and tab and completion don't work
+
+
+
+--------------------------------------------------------------------------------
+newoption {
+    trigger     = "ucd",
+    value       = "DIR",
+    description = "Unicode Character Database to build wcwidth_table.h and the case folding tables from"
+}
+
+--------------------------------------------------------------------------------
+newaction {
+    trigger = "wcwidth",
+    description = "Regenerates clink/terminal/src/wcwidth_table.h",
+    execute = function()
+        local src = path.translate("clink/terminal/src/")
+        local cmd = "python "..src.."wcwidth_table.py"
+        if _OPTIONS["ucd"] then
+            cmd = cmd.." \""..path.getabsolute(_OPTIONS["ucd"]).."\""
+        end
+        cmd = cmd.." > "..src.."wcwidth_table.h"
+
+        print(cmd)
+        if not os.execute(cmd) then
+            error("Failed to generate wcwidth_table.h")
+        end
+    end
+}
+
+--------------------------------------------------------------------------------
+newaction {
+    trigger = "casefold",
+    description = "Regenerates clink/core/src/str_case_fold.cpp and its test data",
+    execute = function()
+        local src = path.translate("clink/core/src/")
+        local test = path.translate("clink/core/test/")
+        local cmd = "python "..src.."str_case_fold.py"
+        local ucd = ""
+        if _OPTIONS["ucd"] then
+            ucd = " \""..path.getabsolute(_OPTIONS["ucd"]).."\""
+        end
+
+        local outputs = {
+            { cmd..ucd.." > "..src.."str_case_fold.cpp", "str_case_fold.cpp" },
+            { cmd.." --test"..ucd.." > "..test.."str_case_fold_data.h", "str_case_fold_data.h" },
+        }
+        for _, output in ipairs(outputs) do
+            print(output[1])
+            if not os.execute(output[1]) then
+                error("Failed to generate "..output[2])
+            end
+        end
+    end
+}
@@ -30,6 +30,15 @@ int     hooked_fstat(int, struct hooked_stat*);
 int     mk_wcwidth(char32_t);
 int     mk_wcswidth(const char32_t *, size_t);
 
+// Readline's input buffer; see clink/terminal/src/input_ring.cpp.
+void*           input_ring_create(unsigned int initial_size, unsigned int max_size);
+void            input_ring_destroy(void* ring);
+int             input_ring_push(void* ring, int value);
+int             input_ring_pop(void* ring, int* out);
+int             input_ring_unget(void* ring, int value);
+unsigned int    input_ring_count(void* ring);
+void            input_ring_get_stats(void* ring, unsigned int* high_water, unsigned int* drops);
+
 #if defined(__MINGW32__)
 #   undef fwrite
 #   undef fprintf
@@ -54,6 +54,7 @@ extern int errno;
 #endif
 
 #include "display_matches.h"
+#include "output_builder.h"
 
 #ifdef HAVE_LSTAT
 #  define LSTAT lstat
@@ -83,71 +84,171 @@ const char *_rl_filtered_color = NULL;
 
 
 //------------------------------------------------------------------------------
-static char* tmpbuf_allocated = NULL;
-static char* tmpbuf_ptr = NULL;
-static int tmpbuf_length = 0;
-static int tmpbuf_capacity = 0;
-static const char* const _normal_color = "\x1b[m";
-static const int _normal_color_len = 3;
-static const int desc_sep_padding = 4;
+// The color and stat character of a typed match only depend on its match type
+// and extension, so they're worked out once per listing rather than once per
+// match.  Typed matches therefore never need their full path expanded or any
+// file system calls.
+#define MATCH_STYLE_SLOTS       256     // Must be a power of 2.
+#define MATCH_STYLE_EXT_MAX     16
+
+struct match_style
+{
+    unsigned char   used;
+    unsigned char   match_type;
+    unsigned char   color_known;
+    char            ext[MATCH_STYLE_EXT_MAX];
+    int             stat_char;          // -1 until known.
+    const char*     color;              // NULL if the match isn't colored.
+    int             color_len;
+};
+
+static struct match_style s_match_styles[MATCH_STYLE_SLOTS];
+static int s_match_style_count = 0;
+static bool s_match_styles_usable = false;
 
 //------------------------------------------------------------------------------
-static void reset_tmpbuf (void)
+static void reset_match_styles(void)
 {
-    tmpbuf_ptr = tmpbuf_allocated;
-    tmpbuf_length = 0;
+#if defined(COLOR_SUPPORT)
+    COLOR_EXT_TYPE *ext;
+    int i;
+#endif
+
+    if (s_match_style_count)
+        memset(s_match_styles, 0, sizeof(s_match_styles));
+    s_match_style_count = 0;
+
+    // A stat hook can change the name being styled, so it has to see every
+    // match.
+    s_match_styles_usable = (rl_completion_matches_include_type && !rl_filename_stat_hook);
+
+#if defined(COLOR_SUPPORT)
+    // Styles can only be keyed by extension if every colored suffix is a
+    // simple ".ext" (LS_COLORS allows e.g. "*.tar.gz" or "*~").
+    for (ext = _rl_color_ext_list; ext && s_match_styles_usable; ext = ext->next)
+    {
+        if (ext->ext.len < 2 || ext->ext.string[0] != '.')
+            s_match_styles_usable = false;
+        for (i = 1; i < ext->ext.len && s_match_styles_usable; i++)
+            if (ext->ext.string[i] == '.' || rl_is_path_separator(ext->ext.string[i]))
+                s_match_styles_usable = false;
+    }
+#endif
 }
 
 //------------------------------------------------------------------------------
-static void grow_tmpbuf (int needsize)
+// Returns the style for NAME, or NULL if it has to be worked out per match.
+static struct match_style* find_match_style(const char *name, unsigned char match_type)
 {
-    int oldsize = tmpbuf_capacity;
-    int newsize;
-    char* newbuf;
-
-    if (!oldsize)
-        oldsize = 30;
-    newsize = oldsize;
-    while (newsize < needsize)
-        newsize *= 2;
-
-    tmpbuf_allocated = (char*)xrealloc(tmpbuf_allocated, newsize);
-    tmpbuf_ptr = tmpbuf_allocated + tmpbuf_length;
+    struct match_style *style;
+    const char *ext, *s;
+    unsigned int hash, i;
+    size_t len;
+
+    if (!s_match_styles_usable || !match_type)
+        return NULL;
+
+    s = rl_last_path_separator(name);
+    ext = strrchr(s ? s + 1 : name, '.');
+    if (!ext)
+        ext = "";
+
+    len = strlen(ext);
+    if (len >= MATCH_STYLE_EXT_MAX)
+        return NULL;
+
+    hash = match_type;
+    for (s = ext; *s; s++)
+        hash = hash * 31 + (unsigned char)*s;
+
+    for (i = hash & (MATCH_STYLE_SLOTS - 1);; i = (i + 1) & (MATCH_STYLE_SLOTS - 1))
+    {
+        style = &s_match_styles[i];
+        if (!style->used)
+            break;
+        if (style->match_type == match_type && strcmp(style->ext, ext) == 0)
+            return style;
+    }
+
+    // Keep the table at most half full; past that, styles are worked out per
+    // match.
+    if (s_match_style_count >= MATCH_STYLE_SLOTS / 2)
+        return NULL;
+
+    s_match_style_count++;
+    style->used = 1;
+    style->match_type = match_type;
+    style->stat_char = -1;
+    memcpy(style->ext, ext, len + 1);
+    return style;
 }
 
+#if defined (VISIBLE_STATS)
 //------------------------------------------------------------------------------
-static void append_tmpbuf_char(char c)
+static int get_stat_char(char *filename, unsigned char match_type)
 {
-    if (tmpbuf_length + 1 > tmpbuf_capacity)
-        grow_tmpbuf(tmpbuf_length + 1);
+    struct match_style *style;
 
-    *tmpbuf_ptr = c;
-    tmpbuf_ptr++;
-    tmpbuf_length++;
+    if ((style = find_match_style(filename, match_type)) == NULL)
+        return stat_char(filename, match_type);
+
+    if (style->stat_char < 0)
+        style->stat_char = stat_char(filename, match_type);
+    return style->stat_char;
+}
+#endif
+
+
+
+//------------------------------------------------------------------------------
+static const char* const _normal_color = "\x1b[m";
+static const int _normal_color_len = 3;
+static const int desc_sep_padding = 4;
+
+//------------------------------------------------------------------------------
+static void append_tmpbuf_char(char c)
+{
+    ob_append_char(&_rl_display_output, c);
 }
 
 //------------------------------------------------------------------------------
 static void append_tmpbuf_string(const char* s, int len)
 {
-    if (len < 0)
-        len = strlen(s);
+    ob_append(&_rl_display_output, s, len);
+}
 
-    if (tmpbuf_length + len > tmpbuf_capacity)
-        grow_tmpbuf(tmpbuf_length + len);
+//------------------------------------------------------------------------------
+static void flush_tmpbuf(void)
+{
+    ob_flush(&_rl_display_output, rl_outstream);
+}
 
-    memcpy(tmpbuf_ptr, s, len);
-    tmpbuf_ptr += len;
-    tmpbuf_length += len;
+//------------------------------------------------------------------------------
+static void append_tmpbuf_crlf(void)
+{
+#if defined (NEW_TTY_DRIVER) || defined (__MINT__)
+    flush_tmpbuf();
+    rl_crlf();
+#else
+    // Same as rl_crlf(), but without a write of its own.
+    append_tmpbuf_char('\n');
+#endif
 }
 
 //------------------------------------------------------------------------------
-static void flush_tmpbuf(void)
+// Rows are written a screenful at a time.
+static int get_rows_per_flush(void)
 {
-    if (tmpbuf_length)
-    {
-        fwrite(tmpbuf_allocated, tmpbuf_length, 1, rl_outstream);
-        reset_tmpbuf();
-    }
+    return (_rl_screenheight > 1) ? _rl_screenheight - 1 : 1;
+}
+
+//------------------------------------------------------------------------------
+// Sizes the buffer up front for a screenful of rows of COLS visible columns
+// with LIMIT matches per row, each of which may carry a few color sequences.
+static void reserve_tmpbuf(int count, int cols, int limit)
+{
+    int rows = min(count, get_rows_per_flush());
+    ob_reserve(&_rl_display_output, rows * (cols + 2 + limit * 32));
 }
 
 
@@ -201,8 +302,8 @@ static void append_prefix_color(void)
     }
 }
 
-// Returns whether any color sequence was printed.
-static bool append_match_color_indicator(const char *f, unsigned char match_type)
+// Sets *COLOR to the color sequence for a match, or NULL if it isn't colored.
+static void choose_match_color(const char *f, unsigned char match_type, const char **color, int *color_len)
 {
     enum indicator_no colored_filetype;
     COLOR_EXT_TYPE *ext; // Color extension.
@@ -348,13 +449,9 @@ static bool append_match_color_indicator(const char *f, unsigned char match_type
         if (override_color)
         {
             free(filename); // NULL or savestring return value.
-            // Need to reset so not dealing with attribute combinations.
-            if (is_colored(C_NORM))
-                append_default_color();
-            append_color_indicator(C_LEFT);
-            append_tmpbuf_string(override_color, -1);
-            append_color_indicator(C_RIGHT);
-            return 0;
+            *color = override_color;
+            *color_len = strlen(override_color);
+            return;
         }
     }
 
@@ -377,21 +474,44 @@ static bool append_match_color_indicator(const char *f, unsigned char match_type
 
     {
         const struct bin_str *const s = ext ? &(ext->seq) : &_rl_color_indicator[colored_filetype];
-        if (s->string != NULL)
+        *color = s->string;
+        *color_len = s->len;
+    }
+}
+
+// Returns 0 if a color sequence was printed, or 1 if not.
+static bool append_match_color_indicator(const char *f, unsigned char match_type)
+{
+    struct match_style *style;
+    const char *color;
+    int color_len;
+
+    if ((style = find_match_style(f, match_type)) != NULL)
+    {
+        if (!style->color_known)
         {
-            // Need to reset so not dealing with attribute combinations.
-            if (is_colored(C_NORM))
-                append_default_color();
-            append_color_indicator(C_LEFT);
-            append_tmpbuf_string(s->string, s->len);
-            append_color_indicator(C_RIGHT);
-            return 0;
+            choose_match_color(f, match_type, &style->color, &style->color_len);
+            style->color_known = 1;
         }
-        else
-            return 1;
+        color = style->color;
+        color_len = style->color_len;
     }
+    else
+        choose_match_color(f, match_type, &color, &color_len);
+
+    if (color == NULL)
+        return 1;
+
+    // Need to reset so not dealing with attribute combinations.
+    if (is_colored(C_NORM))
+        append_default_color();
+    append_color_indicator(C_LEFT);
+    append_tmpbuf_string(color, color_len);
+    append_color_indicator(C_RIGHT);
+    return 0;
 }
 
+
 static void prep_non_filename_text(void)
 {
     if (_rl_color_indicator[C_END].string != NULL)
@@ -602,10 +722,29 @@ static int append_filename(char* to_print, char* full_pathname, int prefix_bytes
 #endif
         _rl_complete_mark_directories))
     {
+        s = 0;
+        if (match_type && s_match_styles_usable)
+        {
+            // Typed matches are styled from their type and extension, which
+            // to_print already has, so don't bother expanding the full path.
+#if defined (VISIBLE_STATS)
+            if (rl_visible_stats)
+                extension_char = get_stat_char(to_print, match_type);
+            else
+#endif
+            if (_rl_complete_mark_directories &&
+                (IS_MATCH_TYPE_NONE(match_type) ? path_isdir(to_print) : IS_MATCH_TYPE_DIR(match_type)))
+                extension_char = rl_preferred_path_separator;
+
+#if defined(COLOR_SUPPORT)
+            if (_rl_colored_stats)
+                printed_len = fnappend(to_print, prefix_bytes, to_print, match_type);
+#endif
+        }
         // If to_print != full_pathname, to_print is the basename of the path
         // passed.  In this case, we try to expand the directory name before
         // checking for the stat character.
-        if (to_print != full_pathname)
+        else if (to_print != full_pathname)
         {
             // Terminate the directory name.
             c = to_print[-1];
@@ -655,7 +794,7 @@ static int append_filename(char* to_print, char* full_pathname, int prefix_bytes
 
 #if defined (VISIBLE_STATS)
             if (rl_visible_stats)
-                extension_char = stat_char(new_full_pathname, match_type);
+                extension_char = get_stat_char(new_full_pathname, match_type);
             else
 #endif
             if (_rl_complete_mark_directories)
@@ -686,7 +825,7 @@ static int append_filename(char* to_print, char* full_pathname, int prefix_bytes
             s = tilde_expand(full_pathname);
 #if defined(VISIBLE_STATS)
             if (rl_visible_stats)
-                extension_char = stat_char(s, match_type);
+                extension_char = get_stat_char(s, match_type);
             else
 #endif
             if (_rl_complete_mark_directories &&
@@ -715,9 +854,14 @@ static int append_filename(char* to_print, char* full_pathname, int prefix_bytes
 #if defined(COLOR_SUPPORT)
             if (_rl_colored_stats && extension_char == rl_preferred_path_separator)
             {
-                s = tilde_expand(full_pathname);
-                append_colored_stat_start(s, match_type);
-                xfree(s);
+                if (match_type && s_match_styles_usable)
+                    append_colored_stat_start(to_print, match_type);
+                else
+                {
+                    s = tilde_expand(full_pathname);
+                    append_colored_stat_start(s, match_type);
+                    xfree(s);
+                }
             }
 #endif
             append_tmpbuf_char(extension_char);
@@ -833,7 +977,9 @@ static int display_match_list_internal(char **matches, int len, int max, bool on
     // just do the inner printing loop.
     //     0 < len <= limit  implies  count = 1.
 
-    rl_crlf();
+    reserve_tmpbuf(count, cols, limit);
+    ob_clear(&_rl_display_output);
+    append_tmpbuf_crlf();
 
     if (_rl_print_completions_horizontally == 0)
     {
@@ -851,7 +997,6 @@ static int display_match_list_internal(char **matches, int len, int max, bool on
     lines = 0;
     for (i = 0; i < count; i++)
     {
-        reset_tmpbuf();
         for (j = 0, l = 1 + i * major_stride; j < limit; j++)
         {
             if (l > len || matches[l] == 0)
@@ -871,15 +1016,19 @@ static int display_match_list_internal(char **matches, int len, int max, bool on
             append_color_indicator(C_CLR_TO_EOL);
         }
 #endif
-        flush_tmpbuf();
-        rl_crlf();
+        append_tmpbuf_crlf();
 #if defined(SIGWINCH)
         if (RL_SIG_RECEIVED() && RL_SIGWINCH_RECEIVED() == 0)
 #else
         if (RL_SIG_RECEIVED())
 #endif
+        {
+            flush_tmpbuf();
             return 0;
+        }
         lines++;
+        if ((i + 1) % get_rows_per_flush() == 0)
+            flush_tmpbuf();
         if (_rl_page_completions && lines >= (_rl_screenheight - 1) && i < count)
         {
             lines = _rl_internal_pager(lines);
@@ -887,6 +1036,7 @@ static int display_match_list_internal(char **matches, int len, int max, bool on
                 return 0;
         }
     }
+    flush_tmpbuf();
 
     return 0;
 }
@@ -929,7 +1079,9 @@ static int display_filtered_match_list_internal(match_display_filter_entry **mat
     // just do the inner printing loop.
     //     0 < len <= limit  implies  count = 1.
 
-    rl_crlf();
+    reserve_tmpbuf(count, cols, limit);
+    ob_clear(&_rl_display_output);
+    append_tmpbuf_crlf();
 
     if (_rl_print_completions_horizontally == 0)
     {
@@ -953,7 +1105,6 @@ static int display_filtered_match_list_internal(match_display_filter_entry **mat
     lines = 0;
     for (i = 0; i < count; i++)
     {
-        reset_tmpbuf();
         for (j = 0, l = 1 + i * major_stride; j < limit; j++)
         {
             if (l > len || matches[l] == 0)
@@ -981,15 +1132,19 @@ static int display_filtered_match_list_internal(match_display_filter_entry **mat
         }
         append_default_color();
         append_color_indicator(C_CLR_TO_EOL);
-        flush_tmpbuf();
-        rl_crlf();
+        append_tmpbuf_crlf();
 #if defined(SIGWINCH)
         if (RL_SIG_RECEIVED() && RL_SIGWINCH_RECEIVED() == 0)
 #else
         if (RL_SIG_RECEIVED())
 #endif
+        {
+            flush_tmpbuf();
             return 0;
+        }
         lines++;
+        if ((i + 1) % get_rows_per_flush() == 0)
+            flush_tmpbuf();
         if (_rl_page_completions && lines >= (_rl_screenheight - 1) && i < count)
         {
             lines = _rl_internal_pager(lines);
@@ -997,6 +1152,7 @@ static int display_filtered_match_list_internal(match_display_filter_entry **mat
                 return 0;
         }
     }
+    flush_tmpbuf();
 
     return 1;
 }
@@ -1038,6 +1194,9 @@ void display_matches(char** matches)
     char *temp;
     int vis_stat;
 
+    ob_reset_counters(&_rl_display_output);
+    reset_match_styles();
+
     // If there is a display filter, give it a chance to modify MATCHES.
     if (rl_match_display_filter_func)
     {
@@ -1092,11 +1251,11 @@ done_filtered:
     if (matches[1] == 0)
     {
         temp = printable_part(matches[0]);
-        rl_crlf();
-        reset_tmpbuf();
+        ob_clear(&_rl_display_output);
+        append_tmpbuf_crlf();
         append_filename(temp, matches[0], 0);
-        fwrite(tmpbuf_allocated, tmpbuf_length, 1, rl_outstream);
-        rl_crlf();
+        append_tmpbuf_crlf();
+        flush_tmpbuf();
 
         goto done;
     }
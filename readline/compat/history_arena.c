@@ -0,0 +1,254 @@
+/*
+
+    An arena for history entries and their strings.  Loading a large history
+    allocates a struct, a line and a timestamp per entry, and clearing it frees
+    them all again one at a time.  The arena hands out memory from large chunks
+    instead, and only counts how many allocations in each chunk are still live.
+    Freeing is a decrement, and a chunk goes back to the heap when its count
+    reaches zero.
+
+*/
+
+#define READLINE_LIBRARY
+
+#if defined (HAVE_CONFIG_H)
+#  include <config.h>
+#endif
+
+#if defined (HAVE_STDLIB_H)
+#  include <stdlib.h>
+#else
+#  include "readline/ansi_stdlib.h"
+#endif /* HAVE_STDLIB_H */
+
+#include <string.h>
+
+#include "readline/xmalloc.h"
+
+#include "history_arena.h"
+
+#define ARENA_ALIGN             sizeof(void*)
+#define ARENA_ROUND(x)          (((x) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+#define MIN_CHUNK_SIZE          (64 * 1024)
+#define MAX_CHUNK_SIZE          (1024 * 1024)
+#define MIN_COMPACT_DEAD        4096
+
+//------------------------------------------------------------------------------
+struct arena_chunk
+{
+    size_t          size;       // Bytes available after the header.
+    size_t          used;
+    unsigned int    allocs;     // Allocations made from this chunk.
+    unsigned int    live;       // Allocations not yet freed.
+};
+
+#define CHUNK_HEADER_SIZE       ARENA_ROUND(sizeof(struct arena_chunk))
+#define CHUNK_DATA(c)           ((char*)(c) + CHUNK_HEADER_SIZE)
+
+//------------------------------------------------------------------------------
+int history_use_arena = 0;
+
+static struct arena_chunk** s_chunks = NULL;    // Sorted by address.
+static int s_chunk_count = 0;
+static int s_chunk_capacity = 0;
+static struct arena_chunk* s_current = NULL;
+static size_t s_next_chunk_size = MIN_CHUNK_SIZE;
+static unsigned long s_chunk_allocs = 0;        // Sum of allocs in s_chunks.
+static unsigned long s_live = 0;
+static unsigned long s_total_allocs = 0;
+static unsigned long s_total_chunk_allocs = 0;
+static unsigned long s_compactions = 0;
+
+
+
+//------------------------------------------------------------------------------
+// Returns the index of the last chunk that starts at or before P, or -1.
+static int find_chunk_index (const void* p)
+{
+    int lo = 0;
+    int hi = s_chunk_count;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if ((const char*)s_chunks[mid] <= (const char*)p)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo - 1;
+}
+
+//------------------------------------------------------------------------------
+static struct arena_chunk* find_chunk (const void* p)
+{
+    struct arena_chunk* chunk;
+    const char* data;
+    int i;
+
+    if ((i = find_chunk_index(p)) < 0)
+        return NULL;
+
+    chunk = s_chunks[i];
+    data = CHUNK_DATA(chunk);
+    if ((const char*)p < data || (const char*)p >= data + chunk->size)
+        return NULL;
+
+    return chunk;
+}
+
+//------------------------------------------------------------------------------
+static struct arena_chunk* new_chunk (size_t size)
+{
+    struct arena_chunk* chunk;
+    int i;
+
+    chunk = (struct arena_chunk*)xmalloc(CHUNK_HEADER_SIZE + size);
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->allocs = 0;
+    chunk->live = 0;
+
+    if (s_chunk_count == s_chunk_capacity)
+    {
+        s_chunk_capacity = s_chunk_capacity ? s_chunk_capacity * 2 : 16;
+        s_chunks = (struct arena_chunk**)xrealloc(s_chunks, s_chunk_capacity * sizeof(*s_chunks));
+    }
+
+    i = find_chunk_index(chunk) + 1;
+    memmove(s_chunks + i + 1, s_chunks + i, (s_chunk_count - i) * sizeof(*s_chunks));
+    s_chunks[i] = chunk;
+    s_chunk_count++;
+
+    s_total_chunk_allocs++;
+    return chunk;
+}
+
+//------------------------------------------------------------------------------
+static void release_chunk (struct arena_chunk* chunk)
+{
+    int i = find_chunk_index(chunk);
+
+    memmove(s_chunks + i, s_chunks + i + 1, (s_chunk_count - i - 1) * sizeof(*s_chunks));
+    s_chunk_count--;
+    s_chunk_allocs -= chunk->allocs;
+
+    if (chunk == s_current)
+        s_current = NULL;
+
+    free(chunk);
+}
+
+
+
+//------------------------------------------------------------------------------
+void* _hs_arena_alloc (size_t size)
+{
+    void* p;
+
+    if (!history_use_arena)
+        return xmalloc(size);
+
+    size = ARENA_ROUND(size ? size : 1);
+
+    // Large allocations would waste much of a chunk, so leave them to the heap.
+    if (size > MIN_CHUNK_SIZE / 4)
+        return xmalloc(size);
+
+    if (!s_current || s_current->used + size > s_current->size)
+    {
+        s_current = new_chunk(s_next_chunk_size);
+        if (s_next_chunk_size < MAX_CHUNK_SIZE)
+            s_next_chunk_size *= 2;
+    }
+
+    p = CHUNK_DATA(s_current) + s_current->used;
+    s_current->used += size;
+    s_current->allocs++;
+    s_current->live++;
+    s_chunk_allocs++;
+    s_live++;
+    s_total_allocs++;
+    return p;
+}
+
+//------------------------------------------------------------------------------
+char* _hs_arena_savestring (const char* s)
+{
+    size_t len = strlen(s) + 1;
+    return (char*)memcpy(_hs_arena_alloc(len), s, len);
+}
+
+//------------------------------------------------------------------------------
+void _hs_arena_free (void* p)
+{
+    struct arena_chunk* chunk;
+
+    if (!p)
+        return;
+
+    if (!(chunk = find_chunk(p)))
+    {
+        free(p);
+        return;
+    }
+
+    chunk->live--;
+    s_live--;
+    if (chunk->live)
+        return;
+
+    // The chunk being allocated from can simply start again.
+    if (chunk == s_current)
+    {
+        s_chunk_allocs -= chunk->allocs;
+        chunk->allocs = 0;
+        chunk->used = 0;
+        return;
+    }
+
+    release_chunk(chunk);
+}
+
+//------------------------------------------------------------------------------
+int _hs_arena_owns (const void* p)
+{
+    return (p && find_chunk(p) != NULL);
+}
+
+//------------------------------------------------------------------------------
+int _hs_arena_should_compact (void)
+{
+    unsigned long dead = s_chunk_allocs - s_live;
+    return (history_use_arena && dead > MIN_COMPACT_DEAD && dead > s_live);
+}
+
+//------------------------------------------------------------------------------
+void _hs_arena_begin_compact (void)
+{
+    // Allocations only come from the current chunk, so forgetting it is enough
+    // to make sure the existing chunks only empty from here on.
+    if (s_current && !s_current->live)
+        release_chunk(s_current);
+    s_current = NULL;
+    s_next_chunk_size = MIN_CHUNK_SIZE;
+    s_compactions++;
+}
+
+//------------------------------------------------------------------------------
+void history_get_arena_stats (history_arena_stats* stats)
+{
+    int i;
+
+    memset(stats, 0, sizeof(*stats));
+    for (i = 0; i < s_chunk_count; i++)
+    {
+        stats->reserved += s_chunks[i]->size;
+        stats->used += s_chunks[i]->used;
+    }
+
+    stats->chunks = s_chunk_count;
+    stats->live = s_live;
+    stats->allocs = s_total_allocs;
+    stats->chunk_allocs = s_total_chunk_allocs;
+    stats->compactions = s_compactions;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <readline/rlstdc.h>
+
+// When non-zero, history entries and their strings are carved from large
+// chunks of memory rather than allocated one at a time.  A chunk is returned
+// to the heap once everything in it has been freed.
+READLINE_API int history_use_arena;
+
+struct history_arena_stats
+{
+    unsigned int    chunks;         // Chunks currently allocated.
+    size_t          reserved;       // Bytes held by those chunks.
+    size_t          used;           // Bytes handed out from those chunks.
+    unsigned long   live;           // Allocations not yet freed.
+    unsigned long   allocs;         // Total allocations served by the arena.
+    unsigned long   chunk_allocs;   // Total chunks allocated from the heap.
+    unsigned long   compactions;    // Times the history was moved to new chunks.
+};
+typedef struct history_arena_stats history_arena_stats;
+
+READLINE_API void history_get_arena_stats (history_arena_stats* stats);
+
+// Memory for history entries.  _hs_arena_free() accepts memory from either the
+// arena or the heap, so it's safe to use on any history entry or its strings.
+void* _hs_arena_alloc (size_t size);
+char* _hs_arena_savestring (const char* s);
+void _hs_arena_free (void* p);
+int _hs_arena_owns (const void* p);
+
+// Compacting moves live entries into fresh chunks so that sparse chunks can be
+// returned to the heap.  _hs_arena_begin_compact() stops allocations from the
+// existing chunks.
+int _hs_arena_should_compact (void);
+void _hs_arena_begin_compact (void);
@@ -0,0 +1,422 @@
+/*
+
+    A trigram index of the history lines, so that searching a long history
+    only visits the lines that contain every trigram of the search string.
+    Each history entry gets a sequence number, and each trigram has an
+    ascending list of the sequence numbers of the lines that contain it.
+    Sequence numbers stay the same when entries before them are removed, so
+    removing entries only needs to update the list of live sequence numbers.
+
+*/
+
+#define READLINE_LIBRARY
+
+#if defined (HAVE_CONFIG_H)
+#  include <config.h>
+#endif
+
+#if defined (HAVE_STDLIB_H)
+#  include <stdlib.h>
+#else
+#  include "readline/ansi_stdlib.h"
+#endif /* HAVE_STDLIB_H */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "readline/history.h"
+#include "readline/xmalloc.h"
+
+#include "history_index.h"
+
+extern int _rl_search_case_fold;
+
+//------------------------------------------------------------------------------
+struct trigram_slot
+{
+    unsigned int    key;        // Zero means the slot is empty.
+    int             count;
+    int             size;
+    int*            seqs;       // Ascending sequence numbers.
+};
+
+//------------------------------------------------------------------------------
+int history_search_indexed = 0;
+
+static struct trigram_slot* s_slots = NULL;
+static unsigned int s_slot_bits = 0;
+static unsigned int s_slot_used = 0;
+static int* s_seqs = NULL;      // Sequence number of each history entry.
+static int s_seq_count = 0;
+static int s_seq_capacity = 0;
+static int s_next_seq = 0;
+static int s_stale = 0;         // Sequence numbers removed since compacting.
+static int s_valid = 0;
+
+// Lines with non-ASCII characters, which may match ASCII search text when
+// searches ignore case (e.g. KELVIN SIGN folds to 'k').
+static struct trigram_slot s_wide_slot = { 0 };
+static struct trigram_slot s_empty_slot = { 0 };
+
+
+
+//------------------------------------------------------------------------------
+static unsigned int fold_byte (unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+//------------------------------------------------------------------------------
+static unsigned int make_key (const char* s)
+{
+    return ((fold_byte(s[0]) << 16) | (fold_byte(s[1]) << 8) | fold_byte(s[2]));
+}
+
+//------------------------------------------------------------------------------
+static unsigned int hash_key (unsigned int key)
+{
+    return (key * 0x9e3779b1u) >> (32 - s_slot_bits);
+}
+
+//------------------------------------------------------------------------------
+static struct trigram_slot* find_slot (unsigned int key)
+{
+    unsigned int mask, i;
+
+    if (!s_slots)
+        return NULL;
+
+    mask = (1u << s_slot_bits) - 1;
+    for (i = hash_key(key); s_slots[i].key; i = (i + 1) & mask)
+        if (s_slots[i].key == key)
+            return &s_slots[i];
+
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+static void grow_slots (void)
+{
+    struct trigram_slot* old_slots = s_slots;
+    unsigned int old_count = s_slots ? (1u << s_slot_bits) : 0;
+    unsigned int mask, i, j;
+
+    s_slot_bits = s_slots ? s_slot_bits + 1 : 12;
+    s_slots = (struct trigram_slot*)xmalloc(sizeof(*s_slots) << s_slot_bits);
+    memset(s_slots, 0, sizeof(*s_slots) << s_slot_bits);
+
+    mask = (1u << s_slot_bits) - 1;
+    for (i = 0; i < old_count; i++)
+    {
+        if (!old_slots[i].key)
+            continue;
+
+        for (j = hash_key(old_slots[i].key); s_slots[j].key; j = (j + 1) & mask)
+            ;
+        s_slots[j] = old_slots[i];
+    }
+
+    free(old_slots);
+}
+
+//------------------------------------------------------------------------------
+static struct trigram_slot* add_slot (unsigned int key)
+{
+    struct trigram_slot* slot;
+    unsigned int mask, i;
+
+    if ((slot = find_slot(key)) != NULL)
+        return slot;
+
+    // Keep the table at most half full.
+    if (!s_slots || (s_slot_used + 1) * 2 > (1u << s_slot_bits))
+        grow_slots();
+
+    mask = (1u << s_slot_bits) - 1;
+    for (i = hash_key(key); s_slots[i].key; i = (i + 1) & mask)
+        ;
+
+    s_slot_used++;
+    s_slots[i].key = key;
+    return &s_slots[i];
+}
+
+//------------------------------------------------------------------------------
+static int lower_bound (const int* seqs, int count, int seq)
+{
+    int lo = 0;
+    int hi = count;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (seqs[mid] < seq)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+//------------------------------------------------------------------------------
+static void add_seq_to_slot (struct trigram_slot* slot, int seq)
+{
+    int i = slot->count;
+
+    // Lines are almost always indexed in order, so this is usually an append.
+    if (i && slot->seqs[i - 1] >= seq)
+    {
+        i = lower_bound(slot->seqs, slot->count, seq);
+        if (slot->seqs[i] == seq)
+            return;
+    }
+
+    if (slot->count == slot->size)
+    {
+        slot->size = slot->size ? slot->size * 2 : 4;
+        slot->seqs = (int*)xrealloc(slot->seqs, slot->size * sizeof(*slot->seqs));
+    }
+
+    memmove(slot->seqs + i + 1, slot->seqs + i, (slot->count - i) * sizeof(*slot->seqs));
+    slot->seqs[i] = seq;
+    slot->count++;
+}
+
+//------------------------------------------------------------------------------
+static void index_line (const char* line, int seq)
+{
+    const char* walk;
+
+    if (!line)
+        return;
+
+    for (walk = line; walk[0] && walk[1] && walk[2]; walk++)
+        add_seq_to_slot(add_slot(make_key(walk)), seq);
+
+    for (walk = line; *walk; walk++)
+        if ((unsigned char)*walk >= 0x80)
+        {
+            add_seq_to_slot(&s_wide_slot, seq);
+            break;
+        }
+}
+
+//------------------------------------------------------------------------------
+static int find_seq (int seq)
+{
+    int i = lower_bound(s_seqs, s_seq_count, seq);
+    return (i < s_seq_count && s_seqs[i] == seq) ? i : -1;
+}
+
+//------------------------------------------------------------------------------
+static void append_seq (int seq)
+{
+    if (s_seq_count == s_seq_capacity)
+    {
+        s_seq_capacity = s_seq_capacity ? s_seq_capacity * 2 : 1024;
+        s_seqs = (int*)xrealloc(s_seqs, s_seq_capacity * sizeof(*s_seqs));
+    }
+
+    s_seqs[s_seq_count++] = seq;
+}
+
+//------------------------------------------------------------------------------
+static void compact (void)
+{
+    unsigned int count = s_slots ? (1u << s_slot_bits) : 0;
+    unsigned int i;
+    int j, k;
+
+    for (i = 0; i < count; i++)
+    {
+        struct trigram_slot* slot = &s_slots[i];
+        for (j = k = 0; j < slot->count; j++)
+            if (find_seq(slot->seqs[j]) >= 0)
+                slot->seqs[k++] = slot->seqs[j];
+        slot->count = k;
+    }
+
+    for (j = k = 0; j < s_wide_slot.count; j++)
+        if (find_seq(s_wide_slot.seqs[j]) >= 0)
+            s_wide_slot.seqs[k++] = s_wide_slot.seqs[j];
+    s_wide_slot.count = k;
+
+    s_stale = 0;
+}
+
+//------------------------------------------------------------------------------
+static void rebuild (void)
+{
+    HIST_ENTRY** list = history_list();
+    unsigned int count = s_slots ? (1u << s_slot_bits) : 0;
+    unsigned int i;
+    int j;
+
+    // Keep the allocations; the new index will be much the same shape.
+    for (i = 0; i < count; i++)
+        s_slots[i].count = 0;
+    s_wide_slot.count = 0;
+
+    s_seq_count = 0;
+    s_next_seq = 0;
+    s_stale = 0;
+    for (j = 0; j < history_length; j++)
+    {
+        append_seq(s_next_seq);
+        index_line(list[j] ? list[j]->line : NULL, s_next_seq);
+        s_next_seq++;
+    }
+
+    s_valid = 1;
+}
+
+//------------------------------------------------------------------------------
+// Returns the index of the first live line in SLOT from POS onwards in
+// DIRECTION, or -1 or history_length if there is none.
+static int next_in_slot (const struct trigram_slot* slot, int pos, int direction)
+{
+    int k, i;
+
+    k = lower_bound(slot->seqs, slot->count, s_seqs[pos]);
+    if (direction < 0)
+    {
+        if (k < slot->count && slot->seqs[k] == s_seqs[pos])
+            return pos;
+
+        while (--k >= 0)
+            if ((i = find_seq(slot->seqs[k])) >= 0)
+                return i;
+
+        return -1;
+    }
+    else
+    {
+        for (; k < slot->count; k++)
+            if ((i = find_seq(slot->seqs[k])) >= 0)
+                return i;
+
+        return history_length;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Picks the trigram of STRING with the fewest lines.  Returns NULL and sets
+// *NONE if some trigram isn't in any line, or returns NULL if STRING has no
+// trigrams the index can use.
+static struct trigram_slot* pick_slot (const char* string, int* none)
+{
+    struct trigram_slot* best = NULL;
+    const char* s;
+
+    *none = 0;
+    if (!string[0] || !string[1])
+        return NULL;
+
+    for (s = string; s[2]; s++)
+    {
+        struct trigram_slot* slot;
+
+        // Only ASCII is folded in the index, so other characters can't be
+        // relied on when searches ignore case.
+        if (_rl_search_case_fold &&
+            ((unsigned char)(s[0] | s[1] | s[2]) & 0x80))
+            continue;
+
+        slot = find_slot(make_key(s));
+        if (!slot || !slot->count)
+        {
+            *none = 1;
+            return NULL;
+        }
+
+        if (!best || slot->count < best->count)
+            best = slot;
+    }
+
+    return best;
+}
+
+
+
+//------------------------------------------------------------------------------
+void _hs_index_add (const char* line)
+{
+    if (!s_valid)
+        return;
+
+    append_seq(s_next_seq);
+    index_line(line, s_next_seq);
+    s_next_seq++;
+}
+
+//------------------------------------------------------------------------------
+void _hs_index_update (int which, const char* line)
+{
+    if (!s_valid)
+        return;
+
+    // The old line's trigrams are left behind; they only cost a little time
+    // checking a line that turns out not to match.
+    if (which >= 0 && which < s_seq_count)
+        index_line(line, s_seqs[which]);
+    else
+        s_valid = 0;
+}
+
+//------------------------------------------------------------------------------
+void _hs_index_remove (int first, int last)
+{
+    int n;
+
+    if (!s_valid)
+        return;
+
+    if (first < 0 || last >= s_seq_count || first > last)
+    {
+        s_valid = 0;
+        return;
+    }
+
+    n = last - first + 1;
+    memmove(s_seqs + first, s_seqs + last + 1, (s_seq_count - last - 1) * sizeof(*s_seqs));
+    s_seq_count -= n;
+
+    // Removed sequence numbers are skipped by searches, and are purged from
+    // the trigram lists once there are enough of them to be worth it.
+    s_stale += n;
+    if (s_stale > 1024 && s_stale > s_seq_count)
+        compact();
+}
+
+//------------------------------------------------------------------------------
+void _hs_index_invalidate (void)
+{
+    s_valid = 0;
+}
+
+//------------------------------------------------------------------------------
+int _hs_index_next (const char* string, int pos, int direction)
+{
+    struct trigram_slot* slot;
+    int none, i;
+
+    if (!history_search_indexed || !string || pos < 0 || pos >= history_length)
+        return pos;
+
+    if (!s_valid || s_seq_count != history_length)
+        rebuild();
+
+    slot = pick_slot(string, &none);
+    if (none)
+        slot = &s_empty_slot;
+    else if (!slot)
+        return pos;
+
+    i = next_in_slot(slot, pos, direction);
+    if (_rl_search_case_fold)
+    {
+        int j = next_in_slot(&s_wide_slot, pos, direction);
+        i = (direction < 0) ? ((i > j) ? i : j) : ((i < j) ? i : j);
+    }
+
+    return i;
+}
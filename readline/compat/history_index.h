@@ -0,0 +1,19 @@
+#pragma once
+
+#include <readline/rlstdc.h>
+
+// When non-zero, history searches consult a trigram index of the history lines
+// so they only visit lines that can contain the search string.
+READLINE_API int history_search_indexed;
+
+// Keeps the index in step with the history list.  These are no-ops while the
+// index isn't in use.
+void _hs_index_add (const char* line);
+void _hs_index_update (int which, const char* line);
+void _hs_index_remove (int first, int last);
+void _hs_index_invalidate (void);
+
+// Returns the first history index from POS onwards in DIRECTION whose line may
+// contain STRING, or -1 or history_length if there is none.  Returns POS when
+// the index can't narrow the search, so every line must be checked.
+int _hs_index_next (const char* string, int pos, int direction);
@@ -0,0 +1,95 @@
+/*
+
+    Buffered output for listing matches.  Writes to rl_outstream go through
+    hooks that convert and write to the console, so each write has a fixed
+    cost.  Building a screenful of output before writing it keeps the number
+    of writes small.
+
+*/
+
+#define READLINE_LIBRARY
+
+#if defined (HAVE_CONFIG_H)
+#  include <config.h>
+#endif
+
+#if defined (HAVE_STDLIB_H)
+#  include <stdlib.h>
+#else
+#  include "readline/ansi_stdlib.h"
+#endif /* HAVE_STDLIB_H */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "readline/xmalloc.h"
+
+#include "output_builder.h"
+
+//------------------------------------------------------------------------------
+output_builder _rl_display_output = { 0 };
+
+
+
+//------------------------------------------------------------------------------
+void ob_reserve(output_builder* ob, int size)
+{
+    int capacity;
+
+    if (size <= ob->capacity)
+        return;
+
+    capacity = ob->capacity ? ob->capacity : 64;
+    while (capacity < size)
+        capacity *= 2;
+
+    ob->buffer = (char*)xrealloc(ob->buffer, capacity);
+    ob->capacity = capacity;
+}
+
+//------------------------------------------------------------------------------
+void ob_append(output_builder* ob, const char* s, int len)
+{
+    if (len < 0)
+        len = strlen(s);
+
+    if (ob->length + len > ob->capacity)
+        ob_reserve(ob, ob->length + len);
+
+    memcpy(ob->buffer + ob->length, s, len);
+    ob->length += len;
+}
+
+//------------------------------------------------------------------------------
+void ob_append_char(output_builder* ob, char c)
+{
+    if (ob->length + 1 > ob->capacity)
+        ob_reserve(ob, ob->length + 1);
+
+    ob->buffer[ob->length++] = c;
+}
+
+//------------------------------------------------------------------------------
+void ob_clear(output_builder* ob)
+{
+    ob->length = 0;
+}
+
+//------------------------------------------------------------------------------
+void ob_flush(output_builder* ob, FILE* stream)
+{
+    if (!ob->length)
+        return;
+
+    fwrite(ob->buffer, ob->length, 1, stream);
+    ob->bytes_written += ob->length;
+    ob->write_calls++;
+    ob->length = 0;
+}
+
+//------------------------------------------------------------------------------
+void ob_reset_counters(output_builder* ob)
+{
+    ob->bytes_written = 0;
+    ob->write_calls = 0;
+}
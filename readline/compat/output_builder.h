@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdio.h>
+#include <readline/rlstdc.h>
+
+// Collects output in a growable buffer so it can be written to a stream in one
+// call.  A zero-initialized output_builder is empty and ready to use.
+struct output_builder
+{
+    char*           buffer;
+    int             length;
+    int             capacity;
+    unsigned int    bytes_written;  // Total bytes flushed to a stream.
+    unsigned int    write_calls;    // Total writes made to a stream.
+};
+typedef struct output_builder output_builder;
+
+READLINE_API void ob_reserve(output_builder* ob, int size);
+READLINE_API void ob_append(output_builder* ob, const char* s, int len);
+READLINE_API void ob_append_char(output_builder* ob, char c);
+READLINE_API void ob_clear(output_builder* ob);
+READLINE_API void ob_flush(output_builder* ob, FILE* stream);
+READLINE_API void ob_reset_counters(output_builder* ob);
+
+// Shared by the match list and the pager, so a listing and its pager prompts
+// are written through the same buffer.  display_matches() resets the counters,
+// so afterwards they describe the most recent listing.
+READLINE_API output_builder _rl_display_output;
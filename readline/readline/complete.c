@@ -73,6 +73,10 @@ extern int errno;
 #include "xmalloc.h"
 #include "rlprivate.h"
 
+/* begin_clink_change */
+#include "compat/output_builder.h"
+/* end_clink_change */
+
 #if defined (COLOR_SUPPORT)
 #  include "colors.h"
 #endif
@@ -120,6 +124,10 @@ rl_postprocess_lcd_func_t *rl_postprocess_lcd_func = (rl_postprocess_lcd_func_t
 /* If non-zero, then this is the address of a function to call that determines
    whether a file extension is executable. */
 rl_iccpfunc_t *rl_is_exec_func = (rl_iccpfunc_t *)NULL;
+/* If non-zero, then this is the address of a function to call to free an
+   individual match string.  This lets the host hand out match strings from
+   its own storage instead of allocating each one separately. */
+rl_vcpfunc_t *rl_free_match_func = (rl_vcpfunc_t *)NULL;
 /* end_clink_change */
 
 #if defined (VISIBLE_STATS) || defined (COLOR_SUPPORT)
@@ -805,13 +813,17 @@ _rl_internal_pager (int lines)
   int i;
 
 /* begin_clink_change */
+  /* Write out any rows of the match list that are still buffered. */
+  ob_flush (&_rl_display_output, rl_outstream);
   if (_rl_pager_color)
     _rl_print_pager_color ();
-/* end_clink_change */
-  fprintf (rl_outstream, "--More--");
-/* begin_clink_change */
+  ob_append (&_rl_display_output, "--More--", -1);
   if (_rl_pager_color)
-    fprintf (rl_outstream, "\x1b[m");
+    ob_append (&_rl_display_output, "\x1b[m", -1);
+  ob_flush (&_rl_display_output, rl_outstream);
+  //fprintf (rl_outstream, "--More--");
+  //if (_rl_pager_color)
+  //  fprintf (rl_outstream, "\x1b[m");
 /* end_clink_change */
   fflush (rl_outstream);
   i = get_y_or_n (1);
@@ -1108,6 +1120,14 @@ fnwidth (const char *string)
 	  width += 2;
 	  pos++;
 	}
+/* begin_clink_change */
+      /* Printable ASCII is one column; skip converting it. */
+      else if ((unsigned char)string[pos] >= ' ' && (unsigned char)string[pos] < RUBOUT)
+	{
+	  width++;
+	  pos++;
+	}
+/* end_clink_change */
       else
 	{
 #if defined (HANDLE_MULTIBYTE)
@@ -1829,7 +1849,10 @@ remove_duplicate_matches (char **matches)
       if (match_type_strcmp (matches[i], matches[i + 1], past_flag, 0/*casefold*/, 1/*dedupe*/) == 0)
 /* end_clink_change */
 	{
-	  xfree (matches[i]);
+/* begin_clink_change */
+	  //xfree (matches[i]);
+	  _rl_free_match (matches[i]);
+/* end_clink_change */
 	  matches[i] = (char *)&dead_slot;
 	}
       else
@@ -1847,7 +1870,10 @@ remove_duplicate_matches (char **matches)
   temp_array[j] = (char *)NULL;
 
   if (matches[0] != (char *)&dead_slot)
-    xfree (matches[0]);
+/* begin_clink_change */
+    //xfree (matches[0]);
+    _rl_free_match (matches[0]);
+/* end_clink_change */
 
   /* Place the lowest common denominator back in [0]. */
   temp_array[0] = lowest_common;
@@ -1860,7 +1886,10 @@ remove_duplicate_matches (char **matches)
   if (j == 2 && match_type_strcmp (temp_array[0], temp_array[1], past_flag, 0/*casefold*/, 1/*dedupe*/) == 0)
 /* end_clink_change */
     {
-      xfree (temp_array[1]);
+/* begin_clink_change */
+      //xfree (temp_array[1]);
+      _rl_free_match (temp_array[1]);
+/* end_clink_change */
       temp_array[1] = (char *)NULL;
     }
   return (temp_array);
@@ -2134,7 +2163,11 @@ postprocess_matches (char ***matchesp, int matching_filenames)
 	    {
 	      t = matches[0];
 	      compute_lcd_of_matches (matches, i - 1, t);
-	      FREE (t);
+/* begin_clink_change */
+	      //FREE (t);
+	      if (t)
+		_rl_free_match (t);
+/* end_clink_change */
 	    }
 	}
     }
@@ -2807,6 +2840,17 @@ insert_all_matches (char **matches, int point, char *qc)
   rl_end_undo_group ();
 }
 
+/* begin_clink_change */
+void
+_rl_free_match (char *match)
+{
+  if (rl_free_match_func)
+    (*rl_free_match_func) (match);
+  else
+    xfree (match);
+}
+/* end_clink_change */
+
 void
 _rl_free_match_list (char **matches)
 {
@@ -2816,7 +2860,10 @@ _rl_free_match_list (char **matches)
     return;
 
   for (i = 0; matches[i]; i++)
-    xfree (matches[i]);
+/* begin_clink_change */
+    //xfree (matches[i]);
+    _rl_free_match (matches[i]);
+/* end_clink_change */
   xfree (matches);
 }
 
@@ -3750,7 +3797,10 @@ rl_old_menu_complete (int count, int invoking_key)
  */
       if (matches && matches[0] && matches[1] && !matches[2])
 	{
-	  xfree (matches[0]);
+/* begin_clink_change */
+	  //xfree (matches[0]);
+	  _rl_free_match (matches[0]);
+/* end_clink_change */
 	  matches[0] = matches[1];
 	  matches[1] = NULL;
 	}
@@ -141,6 +141,10 @@ int history_lines_written_to_file = 0;
    for more extensive tests. */
 #define HIST_TIMESTAMP_START(s)		(*(s) == history_comment_char && isdigit ((unsigned char)(s)[1]) )
 
+/* begin_clink_change */
+static char *history_find_entry PARAMS((char *, char *, int, int *, char **, int *));
+/* end_clink_change */
+
 static char *history_backupfile PARAMS((const char *));
 static char *history_tempfile PARAMS((const char *));
 static int histfile_backup PARAMS((const char *, const char *));
@@ -252,6 +256,62 @@ history_tempfile (const char *filename)
   return ret;
 }
   
+/* begin_clink_change */
+/* Walk the lines in BUFFER the same way read_history_range() does and count
+   the entries it would add, in *ENTRIES.  If STOP_AT is not negative, stop at
+   the start of entry STOP_AT and return the line it starts on, its timestamp
+   line (if any) in *TS, and the number of lines before it in *LINES. */
+static char *
+history_find_entry (char *buffer, char *bufend, int stop_at, int *entries, char **ts, int *lines)
+{
+  char *line_start, *line_end, *last_ts;
+  int current_line, count, len;
+
+  count = current_line = 0;
+  last_ts = (char *)NULL;
+  for (line_start = buffer; line_start < bufend; line_start = line_end + 1)
+    {
+      line_end = (char *)memchr (line_start, '\n', bufend - line_start);
+      if (line_end == 0)
+	break;
+
+      len = line_end - line_start;
+      if (len && line_start[len - 1] == '\r')
+	len--;
+
+      if (len)
+	{
+	  if (HIST_TIMESTAMP_START (line_start) == 0)
+	    {
+	      /* Lines without a timestamp may continue the previous entry. */
+	      if (last_ts != NULL || (history_length == 0 && count == 0) || !history_multiline_entries)
+		{
+		  if (count == stop_at)
+		    {
+		      *entries = count;
+		      *ts = last_ts;
+		      *lines = current_line;
+		      return (line_start);
+		    }
+		  count++;
+		}
+	      last_ts = (char *)NULL;
+	    }
+	  else
+	    {
+	      last_ts = line_start;
+	      current_line--;
+	    }
+	}
+
+      current_line++;
+    }
+
+  *entries = count;
+  return ((char *)NULL);
+}
+/* end_clink_change */
+
 /* Add the contents of FILENAME to the history list, a line at a time.
    If FILENAME is NULL, then read from ~/.history.  Returns 0 if
    successful, or errno if not. */
@@ -272,6 +332,10 @@ read_history_range (const char *filename, int from, int to)
   register char *line_start, *line_end, *p;
   char *input, *buffer, *bufend, *last_ts;
   int file, current_line, chars_read, has_timestamps, reset_comment_char;
+/* begin_clink_change */
+  int read_all, entries, skip_lines;
+  char *skip_ts;
+/* end_clink_change */
   struct stat finfo;
   size_t file_size;
 #if defined (EFBIG)
@@ -284,6 +348,9 @@ read_history_range (const char *filename, int from, int to)
 
   history_lines_read_from_file = 0;
 
+/* begin_clink_change */
+  read_all = (from == 0 && to < 0);
+/* end_clink_change */
   buffer = last_ts = (char *)NULL;
   input = history_filename (filename);
   file = input ? open (input, O_RDONLY|O_BINARY, 0666) : -1;
@@ -404,6 +471,36 @@ read_history_range (const char *filename, int from, int to)
 	  }
       }
 
+/* begin_clink_change */
+  /* When the history is stifled only the newest history_max_entries entries
+     survive, so skip straight to the first of them instead of adding and
+     then discarding all the older ones.  The skipped entries still count
+     towards history_base, as if they had been added and discarded. */
+  if (read_all && history_is_stifled () && history_max_entries > 0)
+    {
+      history_find_entry (buffer, bufend, -1, &entries, &skip_ts, &skip_lines);
+      if (entries > history_max_entries)
+	{
+	  entries -= history_max_entries;
+	  line_start = history_find_entry (buffer, bufend, entries, &entries, &skip_ts, &skip_lines);
+	  current_line = skip_lines;
+	  history_base += entries;
+
+	  /* The main loop NUL terminates lines as it goes, so do the same for
+	     the skipped timestamp line. */
+	  last_ts = skip_ts;
+	  if (last_ts)
+	    {
+	      p = (char *)memchr (last_ts, '\n', bufend - last_ts);
+	      if (p > last_ts && p[-1] == '\r')
+		p[-1] = '\0';
+	      else
+		*p = '\0';
+	    }
+	}
+    }
+/* end_clink_change */
+
   /* If there are lines left to gobble, then gobble them now. */
   for (line_end = line_start; line_end < bufend; line_end++)
     if (*line_end == '\n')
@@ -50,6 +50,11 @@
 
 #include "xmalloc.h"
 
+/* begin_clink_change */
+#include "compat/history_arena.h"
+#include "compat/history_index.h"
+/* end_clink_change */
+
 #if !defined (errno)
 extern int errno;
 #endif
@@ -63,6 +68,11 @@ extern int errno;
 #define DEFAULT_HISTORY_GROW_SIZE 50
 
 static char *hist_inittime PARAMS((void));
+/* begin_clink_change */
+static void history_rebase PARAMS((int));
+static void history_compact_arena PARAMS((void));
+static HIST_ENTRY *history_detach_entry PARAMS((HIST_ENTRY *));
+/* end_clink_change */
 
 /* **************************************************************** */
 /*								    */
@@ -80,6 +90,16 @@ static int history_stifled;
 /* The current number of slots allocated to the input_history. */
 static int history_size;
 
+/* begin_clink_change */
+/* The allocation that THE_HISTORY points into.  When the history is stifled
+   and full, add_history() drops the oldest entry by moving THE_HISTORY one
+   slot further into the buffer instead of moving every entry down a slot.
+   The entries only move back to the start of the buffer when they reach
+   its end, so adding an entry takes constant time on average.
+   HISTORY_SIZE is always the number of slots from THE_HISTORY onwards. */
+static HIST_ENTRY **history_buffer = (HIST_ENTRY **)NULL;
+/* end_clink_change */
+
 /* If HISTORY_STIFLED is non-zero, then this is the maximum number of
    entries to remember. */
 int history_max_entries;
@@ -102,6 +122,11 @@ history_get_history_state (void)
   HISTORY_STATE *state;
 
   state = (HISTORY_STATE *)xmalloc (sizeof (HISTORY_STATE));
+/* begin_clink_change */
+  /* Callers may free or reallocate the entries, so hand out the start of
+     the allocation. */
+  history_rebase (0);
+/* end_clink_change */
   state->entries = the_history;
   state->offset = history_offset;
   state->length = history_length;
@@ -118,9 +143,15 @@ void
 history_set_history_state (HISTORY_STATE *state)
 {
   the_history = state->entries;
+/* begin_clink_change */
+  history_buffer = the_history;
+/* end_clink_change */
   history_offset = state->offset;
   history_length = state->length;
   history_size = state->size;
+/* begin_clink_change */
+  _hs_index_invalidate ();
+/* end_clink_change */
   if (state->flags & HS_STIFLED)
     history_stifled = 1;
 }
@@ -223,7 +254,10 @@ alloc_history_entry (char *string, char *ts)
 
   temp = (HIST_ENTRY *)xmalloc (sizeof (HIST_ENTRY));
 
-  temp->line = string ? savestring (string) : string;
+/* begin_clink_change */
+  temp->line = string ? _hs_arena_savestring (string) : string;
+  //temp->line = string ? savestring (string) : string;
+/* end_clink_change */
   temp->data = (char *)NULL;
   temp->timestamp = ts;
 
@@ -260,12 +294,47 @@ hist_inittime (void)
 #else
   sprintf (ts, "X%lu", (unsigned long) t);
 #endif
-  ret = savestring (ts);
+/* begin_clink_change */
+  ret = _hs_arena_savestring (ts);
+  //ret = savestring (ts);
+/* end_clink_change */
   ret[0] = history_comment_char;
 
   return ret;
 }
 
+/* begin_clink_change */
+/* Move the first HISTORY_LENGTH slots of the history list back to the start
+   of HISTORY_BUFFER, NULL terminate them, and make sure there is room for at
+   least SLACK more entries after them. */
+static void
+history_rebase (int slack)
+{
+  int offset, needed;
+
+  if (the_history == 0)
+    return;
+
+  offset = the_history - history_buffer;
+  if (offset)
+    {
+      memmove (history_buffer, the_history, history_length * sizeof (HIST_ENTRY *));
+      the_history = history_buffer;
+      history_size += offset;
+      the_history[history_length] = (HIST_ENTRY *)NULL;
+    }
+
+  needed = history_length + slack + 1;
+  if (history_size < needed)
+    {
+      history_buffer = (HIST_ENTRY **)
+	xrealloc (history_buffer, needed * sizeof (HIST_ENTRY *));
+      the_history = history_buffer;
+      history_size = needed;
+    }
+}
+/* end_clink_change */
+
 /* Place STRING at the end of the history list.  The data field
    is  set to NULL. */
 void
@@ -287,12 +356,23 @@ add_history (const char *string)
       if (the_history[0])
 	(void) free_history_entry (the_history[0]);
 
-      /* Copy the rest of the entries, moving down one slot.  Copy includes
-	 trailing NULL.  */
-      memmove (the_history, the_history + 1, history_length * sizeof (HIST_ENTRY *));
+/* begin_clink_change */
+      /* Drop the first slot by starting the list one slot later.  If that
+	 leaves no room for the trailing NULL then move the entries back to
+	 the start of the buffer, with enough room to do this HISTORY_LENGTH
+	 more times before they need to move again. */
+      the_history++;
+      history_size--;
+      if (history_size < history_length + 1)
+	history_rebase (history_length);
+      //memmove (the_history, the_history + 1, history_length * sizeof (HIST_ENTRY *));
+/* end_clink_change */
 
       new_length = history_length;
       history_base++;
+/* begin_clink_change */
+      _hs_index_remove (0, 0);
+/* end_clink_change */
     }
   else
     {
@@ -305,15 +385,27 @@ add_history (const char *string)
 	  else
 	    history_size = DEFAULT_HISTORY_INITIAL_SIZE;
 	  the_history = (HIST_ENTRY **)xmalloc (history_size * sizeof (HIST_ENTRY *));
+/* begin_clink_change */
+	  history_buffer = the_history;
+/* end_clink_change */
 	  new_length = 1;
 	}
       else
 	{
+/* begin_clink_change */
+	  if (history_length == (history_size - 1))
+	    history_rebase (0);
+/* end_clink_change */
 	  if (history_length == (history_size - 1))
 	    {
 	      history_size += DEFAULT_HISTORY_GROW_SIZE;
-	      the_history = (HIST_ENTRY **)
-		xrealloc (the_history, history_size * sizeof (HIST_ENTRY *));
+/* begin_clink_change */
+	      history_buffer = (HIST_ENTRY **)
+		xrealloc (history_buffer, history_size * sizeof (HIST_ENTRY *));
+	      the_history = history_buffer;
+	      //the_history = (HIST_ENTRY **)
+	      //  xrealloc (the_history, history_size * sizeof (HIST_ENTRY *));
+/* end_clink_change */
 	    }
 	  new_length = history_length + 1;
 	}
@@ -324,6 +416,9 @@ add_history (const char *string)
   the_history[new_length] = (HIST_ENTRY *)NULL;
   the_history[new_length - 1] = temp;
   history_length = new_length;
+/* begin_clink_change */
+  _hs_index_add (temp->line);
+/* end_clink_change */
 }
 
 /* Change the time stamp of the most recent history entry to STRING. */
@@ -335,8 +430,12 @@ add_history_time (const char *string)
   if (string == 0 || history_length < 1)
     return;
   hs = the_history[history_length - 1];
-  FREE (hs->timestamp);
-  hs->timestamp = savestring (string);
+/* begin_clink_change */
+  _hs_arena_free (hs->timestamp);
+  hs->timestamp = _hs_arena_savestring (string);
+  //FREE (hs->timestamp);
+  //hs->timestamp = savestring (string);
+/* end_clink_change */
 }
 
 /* Free HIST and return the data so the calling application can free it
@@ -348,10 +447,16 @@ free_history_entry (HIST_ENTRY *hist)
 
   if (hist == 0)
     return ((histdata_t) 0);
-  FREE (hist->line);
-  FREE (hist->timestamp);
+/* begin_clink_change */
+  _hs_arena_free (hist->line);
+  _hs_arena_free (hist->timestamp);
   x = hist->data;
-  xfree (hist);
+  _hs_arena_free (hist);
+  //FREE (hist->line);
+  //FREE (hist->timestamp);
+  //x = hist->data;
+  //xfree (hist);
+/* end_clink_change */
   return (x);
 }
 
@@ -366,7 +471,10 @@ copy_history_entry (HIST_ENTRY *hist)
 
   ret = alloc_history_entry (hist->line, (char *)NULL);
 
-  ts = hist->timestamp ? savestring (hist->timestamp) : hist->timestamp;
+/* begin_clink_change */
+  ts = hist->timestamp ? _hs_arena_savestring (hist->timestamp) : hist->timestamp;
+  //ts = hist->timestamp ? savestring (hist->timestamp) : hist->timestamp;
+/* end_clink_change */
   ret->timestamp = ts;
 
   ret->data = hist->data;
@@ -388,12 +496,21 @@ replace_history_entry (int which, const char *line, histdata_t data)
   temp = (HIST_ENTRY *)xmalloc (sizeof (HIST_ENTRY));
   old_value = the_history[which];
 
-  temp->line = savestring (line);
+/* begin_clink_change */
+  temp->line = _hs_arena_savestring (line);
   temp->data = data;
-  temp->timestamp = savestring (old_value->timestamp);
+  temp->timestamp = _hs_arena_savestring (old_value->timestamp);
+  //temp->line = savestring (line);
+  //temp->data = data;
+  //temp->timestamp = savestring (old_value->timestamp);
+/* end_clink_change */
   the_history[which] = temp;
+/* begin_clink_change */
+  _hs_index_update (which, temp->line);
 
-  return (old_value);
+  return (history_detach_entry (old_value));
+  //return (old_value);
+/* end_clink_change */
 }
 
 /* Append LINE to the history line at offset WHICH, adding a newline to the
@@ -420,12 +537,25 @@ _hs_append_history_line (int which, const char *line)
     newlen = minlen;
   /* Assume that realloc returns the same pointer and doesn't try a new
      alloc/copy if the new size is the same as the one last passed. */
+/* begin_clink_change */
+  /* Lines in the arena can't be reallocated, so move them to the heap. */
+  if (_hs_arena_owns (hent->line))
+    {
+      newline = xmalloc (newlen);
+      memcpy (newline, hent->line, curlen + 1);
+      _hs_arena_free (hent->line);
+    }
+  else
+/* end_clink_change */
   newline = realloc (hent->line, newlen);
   if (newline)
     {
       hent->line = newline;
       hent->line[curlen++] = '\n';
       strcpy (hent->line + curlen, line);
+/* begin_clink_change */
+      _hs_index_update (which, hent->line);
+/* end_clink_change */
     }
 }
 
@@ -503,8 +633,12 @@ remove_history (int which)
 #endif
 
   history_length--;
+/* begin_clink_change */
+  _hs_index_remove (which, which);
 
-  return (return_value);
+  return (history_detach_entry (return_value));
+  //return (return_value);
+/* end_clink_change */
 }
 
 HIST_ENTRY **
@@ -529,7 +663,10 @@ remove_history_range (int first, int last)
 
   /* Return all the deleted entries in a list */
   for (i = first ; i <= last; i++)
-    return_value[i - first] = the_history[i];
+/* begin_clink_change */
+    return_value[i - first] = history_detach_entry (the_history[i]);
+    //return_value[i - first] = the_history[i];
+/* end_clink_change */
   return_value[i - first] = (HIST_ENTRY *)NULL;
 
   /* Copy the rest of the entries, moving down NENTRIES slots.  Copy includes
@@ -539,10 +676,67 @@ remove_history_range (int first, int last)
   memmove (start, end, (history_length - last) * sizeof (HIST_ENTRY *));
 
   history_length -= nentries;
+/* begin_clink_change */
+  _hs_index_remove (first, last);
+  if (_hs_arena_should_compact ())
+    history_compact_arena ();
+/* end_clink_change */
 
   return (return_value);
 }
 
+/* begin_clink_change */
+/* Move the lines and timestamps of the entries in the history list to fresh
+   arena chunks, so chunks left mostly empty by removed entries can go back to
+   the heap.  The entries themselves stay where they are, so pointers to them
+   held by the application are still valid afterwards. */
+static void
+history_compact_arena (void)
+{
+  HIST_ENTRY *hent;
+  char *old_value;
+  register int i;
+
+  _hs_arena_begin_compact ();
+
+  for (i = 0; i < history_length; i++)
+    {
+      hent = the_history[i];
+      if (_hs_arena_owns (old_value = hent->line))
+	{
+	  hent->line = _hs_arena_savestring (old_value);
+	  _hs_arena_free (old_value);
+	}
+      if (_hs_arena_owns (old_value = hent->timestamp))
+	{
+	  hent->timestamp = _hs_arena_savestring (old_value);
+	  _hs_arena_free (old_value);
+	}
+    }
+}
+
+/* Entries handed back to the application may be freed with free() rather
+   than free_history_entry(), so move their strings out of the arena. */
+static HIST_ENTRY *
+history_detach_entry (HIST_ENTRY *hent)
+{
+  char *old_value;
+
+  if (_hs_arena_owns (old_value = hent->line))
+    {
+      hent->line = savestring (old_value);
+      _hs_arena_free (old_value);
+    }
+  if (_hs_arena_owns (old_value = hent->timestamp))
+    {
+      hent->timestamp = savestring (old_value);
+      _hs_arena_free (old_value);
+    }
+
+  return hent;
+}
+/* end_clink_change */
+
 /* Stifle the history list, remembering only MAX number of lines. */
 void
 stifle_history (int max)
@@ -557,6 +751,9 @@ stifle_history (int max)
       /* This loses because we cannot free the data. */
       for (i = 0, j = history_length - max; i < j; i++)
 	free_history_entry (the_history[i]);
+/* begin_clink_change */
+      _hs_index_remove (0, j - 1);
+/* end_clink_change */
 
       history_base = i;
       for (j = 0, i = history_length - max; j < max; i++, j++)
@@ -604,4 +801,7 @@ clear_history (void)
 
   history_offset = history_length = 0;
   history_base = 1;		/* reset history base to default */
+/* begin_clink_change */
+  _hs_index_invalidate ();
+/* end_clink_change */
 }
@@ -47,6 +47,10 @@
 #include "histlib.h"
 #include "xmalloc.h"
 
+/* begin_clink_change */
+#include "compat/history_index.h"
+/* end_clink_change */
+
 /* begin_clink_change */
 extern int find_streqn (const char *a, const char *b, int n);
 #undef STREQN
@@ -105,6 +109,12 @@ history_search_internal (const char *string, int direction, int flags)
     {
       /* Search each line in the history list for STRING. */
 
+/* begin_clink_change */
+      /* Skip lines that the index says can't contain STRING. */
+      if (patsearch == 0)
+	i = _hs_index_next (string, i, direction);
+/* end_clink_change */
+
       /* At limit for direction? */
       if ((reverse && i < 0) || (!reverse && i == history_length))
 	return (-1);
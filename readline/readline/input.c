@@ -138,11 +138,28 @@ win32_isatty (int fd)
 /*								    */
 /* **************************************************************** */
 
-static int pop_index, push_index;
-static unsigned char ibuffer[512];
-static int ibuffer_len = sizeof (ibuffer) - 1;
+/* begin_clink_change
+ * The buffer's a ring from clink_terminal that grows rather than dropping
+ * stuffed input once 511 characters are queued.
+ */
+//static int pop_index, push_index;
+//static unsigned char ibuffer[512];
+//static int ibuffer_len = sizeof (ibuffer) - 1;
+//
+//#define any_typein (push_index != pop_index)
+static void *ibuffer;
+static int ibuffer_len = 1 << 20;
+
+static void *
+get_ibuffer (void)
+{
+  if (ibuffer == 0)
+    ibuffer = input_ring_create (512, ibuffer_len);
+  return ibuffer;
+}
 
-#define any_typein (push_index != pop_index)
+#define any_typein (input_ring_count (get_ibuffer ()) != 0)
+/* end_clink_change */
 
 int
 _rl_any_typein (void)
@@ -153,7 +170,10 @@ _rl_any_typein (void)
 int
 _rl_pushed_input_available (void)
 {
-  return (push_index != pop_index);
+/* begin_clink_change */
+  //return (push_index != pop_index);
+  return any_typein;
+/* end_clink_change */
 }
 
 /* Return the amount of space available in the buffer for stuffing
@@ -161,10 +181,13 @@ _rl_pushed_input_available (void)
 static int
 ibuffer_space (void)
 {
-  if (pop_index > push_index)
-    return (pop_index - push_index - 1);
-  else
-    return (ibuffer_len - (push_index - pop_index));
+/* begin_clink_change */
+  //if (pop_index > push_index)
+  //  return (pop_index - push_index - 1);
+  //else
+  //  return (ibuffer_len - (push_index - pop_index));
+  return (ibuffer_len - (int)input_ring_count (get_ibuffer ()));
+/* end_clink_change */
 }
 
 /* Get a key from the buffer of characters to be read.
@@ -173,18 +196,17 @@ ibuffer_space (void)
 static int
 rl_get_char (int *key)
 {
-  if (push_index == pop_index)
-    return (0);
-
-  *key = ibuffer[pop_index++];
-#if 0
-  if (pop_index >= ibuffer_len)
-#else
-  if (pop_index > ibuffer_len)
-#endif
-    pop_index = 0;
-
-  return (1);
+/* begin_clink_change */
+  //if (push_index == pop_index)
+  //  return (0);
+  //
+  //*key = ibuffer[pop_index++];
+  //if (pop_index > ibuffer_len)
+  //  pop_index = 0;
+  //
+  //return (1);
+  return input_ring_pop (get_ibuffer (), key);
+/* end_clink_change */
 }
 
 /* Stuff KEY into the *front* of the input buffer.
@@ -193,15 +215,18 @@ rl_get_char (int *key)
 int
 _rl_unget_char (int key)
 {
-  if (ibuffer_space ())
-    {
-      pop_index--;
-      if (pop_index < 0)
-	pop_index = ibuffer_len;
-      ibuffer[pop_index] = key;
-      return (1);
-    }
-  return (0);
+/* begin_clink_change */
+  //if (ibuffer_space ())
+  //  {
+  //    pop_index--;
+  //    if (pop_index < 0)
+  //	pop_index = ibuffer_len;
+  //    ibuffer[pop_index] = key;
+  //    return (1);
+  //  }
+  //return (0);
+  return input_ring_unget (get_ibuffer (), key);
+/* end_clink_change */
 }
 
 /* If a character is available to be read, then read it and stuff it into
@@ -409,7 +434,12 @@ _rl_insert_typein (int c)
   char *string;
 
   i = key = 0;
-  string = (char *)xmalloc (ibuffer_len + 1);
+/* begin_clink_change
+ * The buffer can be far larger now; only allocate for what's queued.
+ */
+  //string = (char *)xmalloc (ibuffer_len + 1);
+  string = (char *)xmalloc (input_ring_count (get_ibuffer ()) + 2);
+/* end_clink_change */
   string[i++] = (char) c;
 
   while ((t = rl_get_char (&key)) &&
@@ -430,8 +460,13 @@ _rl_insert_typein (int c)
 int
 rl_stuff_char (int key)
 {
+/* begin_clink_change */
+  //if (ibuffer_space () == 0)
+  //  return 0;
+  /* Pushing onto the full ring fails, but counts the dropped key. */
   if (ibuffer_space () == 0)
-    return 0;
+    return input_ring_push (get_ibuffer (), key);
+/* end_clink_change */
 
   if (key == EOF)
     {
@@ -439,16 +474,23 @@ rl_stuff_char (int key)
       rl_pending_input = EOF;
       RL_SETSTATE (RL_STATE_INPUTPENDING);
     }
-  ibuffer[push_index++] = key;
-#if 0
-  if (push_index >= ibuffer_len)
-#else
-  if (push_index > ibuffer_len)
-#endif
-    push_index = 0;
+/* begin_clink_change */
+  //ibuffer[push_index++] = key;
+  //if (push_index > ibuffer_len)
+  //  push_index = 0;
+  //
+  //return 1;
+  return input_ring_push (get_ibuffer (), key);
+/* end_clink_change */
+}
 
-  return 1;
+/* begin_clink_change */
+void
+rl_get_input_stats (unsigned int *high_water, unsigned int *drops)
+{
+  input_ring_get_stats (get_ibuffer (), high_water, drops);
 }
+/* end_clink_change */
 
 /* Make C be the next command to be executed. */
 int
@@ -54,6 +54,10 @@
 #include "rlprivate.h"
 #include "xmalloc.h"
 
+/* begin_clink_change */
+#include "compat/history_index.h"
+/* end_clink_change */
+
 /* Variables exported to other files in the readline library. */
 char *_rl_isearch_terminators = (char *)NULL;
 
@@ -769,6 +773,13 @@ opcode_dispatch:
 	  /* Move to the next line. */
 	  cxt->history_pos += cxt->direction;
 
+/* begin_clink_change */
+	  /* Skip history lines that the index says can't match.  The last
+	     line is the current input line, which isn't in the history. */
+	  if (cxt->history_pos >= 0 && cxt->history_pos < cxt->hlen - 1)
+	    cxt->history_pos = _hs_index_next (cxt->search_string, cxt->history_pos, cxt->direction);
+/* end_clink_change */
+
 	  /* At limit for direction? */
 	  if ((cxt->sflags & SF_REVERSE) ? (cxt->history_pos < 0) : (cxt->history_pos == cxt->hlen))
 	    {
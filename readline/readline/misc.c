@@ -54,6 +54,10 @@
 #include "rlshell.h"
 #include "xmalloc.h"
 
+/* begin_clink_change */
+#include "compat/history_arena.h"
+/* end_clink_change */
+
 static int rl_digit_loop PARAMS((void));
 static void _rl_history_set_point PARAMS((void));
 
@@ -332,10 +336,16 @@ _rl_free_history_entry (HIST_ENTRY *entry)
   if (entry == 0)
     return;
 
-  FREE (entry->line);
-  FREE (entry->timestamp);
-
-  xfree (entry);
+/* begin_clink_change */
+  _hs_arena_free (entry->line);
+  _hs_arena_free (entry->timestamp);
+
+  _hs_arena_free (entry);
+  //FREE (entry->line);
+  //FREE (entry->timestamp);
+  //
+  //xfree (entry);
+/* end_clink_change */
 }
 
 /* Perhaps put back the current line if it has changed. */
@@ -349,9 +359,12 @@ rl_maybe_replace_line (void)
   if (temp && ((UNDO_LIST *)(temp->data) != rl_undo_list))
     {
       temp = replace_history_entry (where_history (), rl_line_buffer, (histdata_t)rl_undo_list);
-      xfree (temp->line);
-      FREE (temp->timestamp);
-      xfree (temp);
+/* begin_clink_change */
+      _rl_free_history_entry (temp);
+      //xfree (temp->line);
+      //FREE (temp->timestamp);
+      //xfree (temp);
+/* end_clink_change */
     }
   return 0;
 }
@@ -470,7 +483,10 @@ _rl_revert_previous_lines (void)
 	    rl_do_undo ();
 	  /* And copy the reverted line back to the history entry, preserving
 	     the timestamp. */
-	  FREE (entry->line);
+/* begin_clink_change */
+	  _hs_arena_free (entry->line);
+	  //FREE (entry->line);
+/* end_clink_change */
 	  entry->line = savestring (rl_line_buffer);
 	}
       entry = previous_history ();
@@ -468,6 +468,11 @@ READLINE_API rl_voidfunc_t *_rl_visual_bell_func;
 READLINE_API char *rl_get_termcap PARAMS((const char *));
 
 /* Functions for character input. */
+/* begin_clink_change */
+/* The most keys ever queued in the input buffer at once, and how many keys
+   were dropped because it was full. */
+READLINE_API void rl_get_input_stats PARAMS((unsigned int *, unsigned int *));
+/* end_clink_change */
 READLINE_API int rl_stuff_char PARAMS((int));
 READLINE_API int rl_execute_next PARAMS((int));
 READLINE_API int rl_clear_pending_input PARAMS((void));
@@ -885,6 +890,11 @@ READLINE_API rl_qsort_match_list_func_t *rl_qsort_match_list_func;
 /* If non-zero, then this is the address of a function to call that determines
    whether a file extension is executable. */
 READLINE_API rl_iccpfunc_t *rl_is_exec_func;
+/* If non-zero, then this is the address of a function to call to free an
+   individual match string.  This lets the host hand out match strings from
+   its own storage; anything that discards match strings must free them via
+   _rl_free_match so the host can reclaim them. */
+READLINE_API rl_vcpfunc_t *rl_free_match_func;
 /* end_clink_change */
 
 /* Non-zero means that the results of the matches are to be treated
@@ -272,6 +272,9 @@ READLINE_API char *_rl_untranslate_macro_value PARAMS((char *, int));
 /* complete.c */
 READLINE_API void _rl_reset_completion_state PARAMS((void));
 READLINE_API char _rl_find_completion_word PARAMS((int *, int *));
+/* begin_clink_change */
+READLINE_API void _rl_free_match PARAMS((char *));
+/* end_clink_change */
 READLINE_API void _rl_free_match_list PARAMS((char **));
 /* begin_clink_change */
 READLINE_API int stat_from_match_type PARAMS((unsigned char, const char*, struct stat*));
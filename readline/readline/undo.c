@@ -49,6 +49,10 @@
 #include "rlprivate.h"
 #include "xmalloc.h"
 
+/* begin_clink_change */
+#include "compat/history_arena.h"
+/* end_clink_change */
+
 extern void _hs_replace_history_data PARAMS((int, histdata_t *, histdata_t *));
 
 extern HIST_ENTRY *_rl_saved_line_for_history;
@@ -235,9 +239,14 @@ rl_do_undo (void)
       if (cur && cur->data && (UNDO_LIST *)cur->data == release)
 	{
 	  temp = replace_history_entry (where_history (), rl_line_buffer, (histdata_t)rl_undo_list);
-	  xfree (temp->line);
-	  FREE (temp->timestamp);
-	  xfree (temp);
+/* begin_clink_change */
+	  _hs_arena_free (temp->line);
+	  _hs_arena_free (temp->timestamp);
+	  _hs_arena_free (temp);
+	  //xfree (temp->line);
+	  //FREE (temp->timestamp);
+	  //xfree (temp);
+/* end_clink_change */
 	}
 
       /* Make sure there aren't any history entries with that undo list */